@@ -0,0 +1,1927 @@
+#define BENCHMARK_IMPLEMENTATION
+#include "benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "extra.h"
+#include "types.h"
+#include "array.h"
+#include "strvec.h"
+#include "string_view.h"
+#include "intern.h"
+#include "number.h"
+#include "hash.h"
+#include "multi_pattern.h"
+#include "string_builder.h"
+#include "fmt.h"
+#include "string_operations.h"
+#include "line_index.h"
+#include "csv.h"
+#include "json.h"
+#include "glob_pattern.h"
+#include "encoding.h"
+#include "hashmap.h"
+#include "concurrent_map.h"
+#include "system.h"
+
+#ifdef _SDX_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/*
+ * Benchmarks for the sdx libraries, sizes can be changed with -D
+ * at compile time. A single benchmark can be run by passing its
+ * name, "./bench intern".
+ */
+
+static uint64 bench_rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64 bench_rand(void)
+{
+	bench_rng_state ^= bench_rng_state << 13;
+	bench_rng_state ^= bench_rng_state >> 7;
+	bench_rng_state ^= bench_rng_state << 17;
+	return bench_rng_state;
+}
+
+static double bench_rand_unit(void)
+{
+	return (bench_rand() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void bench_report(const char *name, hr_clock *time, double items, double bytes)
+{
+	printf("%-40s %8.3f s  %8.2f ns/item", name, time->wt, time->wt * 1e9 / items);
+	if (bytes > 0)
+		printf("  %8.2f MiB/s", bytes / (1024.0 * 1024.0) / time->wt);
+	printf("\n");
+}
+
+#ifndef BENCH_INTERN_TOKENS
+#define BENCH_INTERN_TOKENS 10000000
+#endif
+
+#ifndef BENCH_INTERN_VOCABULARY
+#define BENCH_INTERN_VOCABULARY 200000
+#endif
+
+// Interning hostnames, header names and paths. The token stream is
+// heavily skewed (u^4) so a small part of the vocabulary makes up
+// most of the tokens like it does in real logs.
+void bench_intern(void)
+{
+	static const char *formats[] = {
+		"host%u.eu-west.example.com",
+		"X-Header-%u",
+		"/var/lib/service/%u/data.bin",
+	};
+
+	printf("-------------------------------------------\n");
+	printf("intern: %d tokens, %d distinct strings\n", BENCH_INTERN_TOKENS, BENCH_INTERN_VOCABULARY);
+
+	struct strvec vocabulary;
+	strvec_init(&vocabulary);
+	char buf[64];
+	for (unsigned i = 0; i < BENCH_INTERN_VOCABULARY; i++) {
+		int len = snprintf(buf, sizeof(buf), formats[i % ARRAY_SIZE(formats)], i);
+		strvec_push_len(&vocabulary, buf, len);
+	}
+
+	uint32 *tokens = malloc(BENCH_INTERN_TOKENS * sizeof(uint32));
+	size_t raw_bytes = 0;
+	for (size_t i = 0; i < BENCH_INTERN_TOKENS; i++) {
+		double u = bench_rand_unit();
+		tokens[i] = (uint32)(u * u * u * u * BENCH_INTERN_VOCABULARY);
+		// what it costs to keep every token as its own malloc'ed string
+		raw_bytes += strvec_get_sv(&vocabulary, tokens[i]).len + 1 + sizeof(char*);
+	}
+
+	struct intern in;
+	intern_init(&in);
+
+	hr_clock time;
+	uint64 checksum = 0;
+	start_clock(&time);
+	for (size_t i = 0; i < BENCH_INTERN_TOKENS; i++)
+		checksum += intern(&in, strvec_get_sv(&vocabulary, tokens[i]));
+	end_clock(&time);
+	do_not_optimize_away(&checksum);
+
+	bench_report("intern", &time, BENCH_INTERN_TOKENS, 0);
+
+	size_t interned_bytes = intern_memory(&in) + BENCH_INTERN_TOKENS * sizeof(uint32);
+	printf("distinct: %zu\n", intern_count(&in));
+	printf("raw strings: %.2f MiB, interned (table + id per token): %.2f MiB, saved %.1f%%\n",
+	       raw_bytes / (1024.0 * 1024.0), interned_bytes / (1024.0 * 1024.0),
+	       100.0 * (1.0 - (double)interned_bytes / raw_bytes));
+
+	intern_free(&in);
+	free(tokens);
+	strvec_delete_struct(&vocabulary);
+}
+
+#ifndef BENCH_SORT_KEYS
+#define BENCH_SORT_KEYS 5000000
+#endif
+
+static int bench_cstr_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char**)a, *(char**)b);
+}
+
+// Log keys that share long prefixes, sorted with strvec_sort()
+// against the usual char* array + qsort + strcmp.
+void bench_sort(void)
+{
+	printf("-------------------------------------------\n");
+	printf("sort: %d keys\n", BENCH_SORT_KEYS);
+
+	struct strvec vec;
+	strvec_init(&vec);
+	char buf[96];
+	for (size_t i = 0; i < BENCH_SORT_KEYS; i++) {
+		int len = snprintf(buf, sizeof(buf), "service-%02u/api/v1/users/%u/events/%u",
+				   (unsigned)(bench_rand() % 32), (unsigned)(bench_rand() % 100000),
+				   (unsigned)(bench_rand() % 1000));
+		strvec_push_len(&vec, buf, len);
+	}
+
+	char **ptrs = malloc(BENCH_SORT_KEYS * sizeof(char*));
+	for (size_t i = 0; i < BENCH_SORT_KEYS; i++)
+		ptrs[i] = strvec_get(&vec, i);
+
+	hr_clock time;
+	start_clock(&time);
+	qsort(ptrs, BENCH_SORT_KEYS, sizeof(char*), bench_cstr_cmp);
+	end_clock(&time);
+	bench_report("qsort + strcmp", &time, BENCH_SORT_KEYS, 0);
+
+	start_clock(&time);
+	strvec_sort(&vec);
+	end_clock(&time);
+	bench_report("strvec_sort", &time, BENCH_SORT_KEYS, 0);
+
+	for (size_t i = 0; i < BENCH_SORT_KEYS; i++) {
+		if (strcmp(ptrs[i], strvec_get(&vec, i)) != 0) {
+			printf("strvec_sort order differs at %zu\n", i);
+			break;
+		}
+	}
+
+	uint64 found = 0;
+	size_t lookups = BENCH_SORT_KEYS / 10;
+	start_clock(&time);
+	for (size_t i = 0; i < lookups; i++)
+		found += strvec_bsearch(&vec, sv_from_cstr(ptrs[(i * 7919) % BENCH_SORT_KEYS])) >= 0;
+	end_clock(&time);
+	do_not_optimize_away(&found);
+	bench_report("strvec_bsearch", &time, lookups, 0);
+
+	free(ptrs);
+	strvec_delete_struct(&vec);
+}
+
+#ifndef BENCH_MAP_WORDS
+#define BENCH_MAP_WORDS 2000000
+#endif
+
+// Loading a dictionary by pushing every word against strvec_map()
+void bench_map(void)
+{
+	printf("-------------------------------------------\n");
+	printf("map: %d words\n", BENCH_MAP_WORDS);
+
+	struct strvec vec;
+	strvec_init(&vec);
+	char buf[64];
+	for (size_t i = 0; i < BENCH_MAP_WORDS; i++) {
+		int len = snprintf(buf, sizeof(buf), "word%llu", (unsigned long long)bench_rand());
+		strvec_push_len(&vec, buf, len);
+	}
+	strvec_save(&vec, "bench_strvec.bin");
+
+	hr_clock time;
+	struct strvec pushed;
+	start_clock(&time);
+	strvec_init(&pushed);
+	for (size_t i = 0; i < BENCH_MAP_WORDS; i++)
+		strvec_push(&pushed, strvec_get(&vec, i));
+	end_clock(&time);
+	bench_report("strvec_push every word", &time, BENCH_MAP_WORDS, 0);
+
+	struct strvec mapped;
+	start_clock(&time);
+	strvec_map(&mapped, "bench_strvec.bin");
+	end_clock(&time);
+	bench_report("strvec_map", &time, BENCH_MAP_WORDS, 0);
+
+	strvec_delete_struct(&mapped);
+	strvec_delete_struct(&pushed);
+	strvec_delete_struct(&vec);
+	remove("bench_strvec.bin");
+}
+
+#ifndef BENCH_FC_PATHS
+#define BENCH_FC_PATHS 2000000
+#endif
+
+// Memory and access speed of a front coded strvec on path like keys
+void bench_front_coding(void)
+{
+	static const char *dirs[] = { "usr/share/doc", "usr/lib/x86_64-linux-gnu", "home/user/projects", "var/log/nginx" };
+
+	printf("-------------------------------------------\n");
+	printf("front coding: %d paths\n", BENCH_FC_PATHS);
+
+	struct strvec vec;
+	strvec_init(&vec);
+	char buf[128];
+	for (size_t i = 0; i < BENCH_FC_PATHS; i++) {
+		int len = snprintf(buf, sizeof(buf), "/%s/package-%u/src/module%u/file%u.c",
+				   dirs[bench_rand() % ARRAY_SIZE(dirs)], (unsigned)(bench_rand() % 5000),
+				   (unsigned)(bench_rand() % 20), (unsigned)(bench_rand() % 100));
+		strvec_push_len(&vec, buf, len);
+	}
+	strvec_sort(&vec);
+
+	struct strvec_fc fc;
+	strvec_fc_build(&fc, &vec, 0);
+	size_t plain = vec.data_size + vec.offsets.index * sizeof(struct strvec_entry);
+	printf("strvec: %.2f MiB, front coded: %.2f MiB, %.2fx smaller\n",
+	       plain / (1024.0 * 1024.0), strvec_fc_memory(&fc) / (1024.0 * 1024.0),
+	       (double)plain / strvec_fc_memory(&fc));
+
+	hr_clock time;
+	uint64 total = 0;
+	start_clock(&time);
+	for (size_t i = 0; i < fc.count; i++)
+		total += strvec_fc_get(&fc, (i * 7919) % fc.count, buf, sizeof(buf));
+	end_clock(&time);
+	bench_report("strvec_fc_get random", &time, fc.count, 0);
+
+	struct strvec_fc_iter it;
+	string_view cur;
+	uint64 bytes = 0;
+	start_clock(&time);
+	strvec_fc_iter_init(&it, &fc, 0);
+	while (strvec_fc_next(&it, &cur))
+		bytes += cur.len;
+	end_clock(&time);
+	strvec_fc_iter_free(&it);
+	bench_report("strvec_fc_next sequential", &time, fc.count, bytes);
+	do_not_optimize_away(&total);
+
+	strvec_fc_free(&fc);
+	strvec_delete_struct(&vec);
+}
+
+#ifndef BENCH_SPLIT_SIZE
+#define BENCH_SPLIT_SIZE (1024UL * 1024 * 1024)
+#endif
+
+// CSV like text, 8 fields per line
+static char *bench_make_text(size_t size)
+{
+	char *text = malloc(size);
+	size_t i = 0;
+	while (i < size) {
+		for (int field = 0; field < 8 && i < size; field++) {
+			size_t len = 2 + bench_rand() % 14;
+			for (size_t j = 0; j < len && i < size; j++)
+				text[i++] = 'a' + bench_rand() % 26;
+			if (i < size)
+				text[i++] = field == 7 ? '\n' : ',';
+		}
+	}
+	return text;
+}
+
+static size_t bench_split_bytewise(string_view sv, char delim)
+{
+	size_t count = 0;
+	while (sv.len > 0) {
+		size_t i = 0;
+		while (i < sv.len && sv.data[i] != delim)
+			i++;
+		count++;
+		sv.data += i < sv.len ? i + 1 : i;
+		sv.len -= i < sv.len ? i + 1 : i;
+	}
+	return count;
+}
+
+static size_t bench_split_sv(string_view sv, char delim)
+{
+	size_t count = 0;
+	while (sv.len > 0) {
+		string_view token = sv_chop_by_delim(&sv, delim);
+		do_not_optimize_away(&token);
+		count++;
+	}
+	return count;
+}
+
+void bench_split(void)
+{
+	printf("-------------------------------------------\n");
+	printf("split: %.0f MiB\n", BENCH_SPLIT_SIZE / (1024.0 * 1024.0));
+
+	char *text = bench_make_text(BENCH_SPLIT_SIZE);
+	string_view sv = sv_from_parts(text, BENCH_SPLIT_SIZE);
+	const char delims[] = { '\n', ',' };
+	const char *names[] = { "newline", "comma" };
+
+	for (int d = 0; d < 2; d++) {
+		hr_clock time;
+		char name[64];
+
+		start_clock(&time);
+		size_t count = bench_split_bytewise(sv, delims[d]);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "bytewise loop, %s", names[d]);
+		bench_report(name, &time, count, BENCH_SPLIT_SIZE);
+
+		start_clock(&time);
+		size_t count_sv = bench_split_sv(sv, delims[d]);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "sv_chop_by_delim, %s", names[d]);
+		bench_report(name, &time, count_sv, BENCH_SPLIT_SIZE);
+
+		if (count != count_sv)
+			printf("token count mismatch %zu != %zu\n", count, count_sv);
+
+		struct array tokens;
+		array_init(&tokens, sizeof(string_view), count + 64);
+		// Untimed run so the token storage is faulted in
+		sv_split_all(sv, delims[d], &tokens);
+		tokens.index = 0;
+
+		start_clock(&time);
+		sv_split_all(sv, delims[d], &tokens);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "sv_split_all, %s", names[d]);
+		bench_report(name, &time, tokens.index, BENCH_SPLIT_SIZE);
+		if (tokens.index != count)
+			printf("token count mismatch %zu != %zu\n", count, tokens.index);
+
+		tokens.index = 0;
+		start_clock(&time);
+		sv_split_all_parallel(sv, delims[d], &tokens, 0);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "sv_split_all_parallel, %s", names[d]);
+		bench_report(name, &time, tokens.index, BENCH_SPLIT_SIZE);
+		if (tokens.index != count)
+			printf("token count mismatch %zu != %zu\n", count, tokens.index);
+
+		array_free(&tokens);
+	}
+
+	sv_charset cs = sv_charset_from_cstr(",\n");
+	struct array tokens;
+	array_init(&tokens, sizeof(string_view), BENCH_SPLIT_SIZE / 8);
+	memset(tokens.data, 0, tokens.cap);
+	hr_clock time;
+	start_clock(&time);
+	sv_split_all_any(sv, &cs, &tokens);
+	end_clock(&time);
+	bench_report("sv_split_all_any, comma or newline", &time, tokens.index, BENCH_SPLIT_SIZE);
+	array_free(&tokens);
+
+	free(text);
+}
+
+// The sliding window sv_trim_by_sv() used before sv_find()
+static size_t bench_find_window(string_view sv, string_view delim)
+{
+	string_view window = sv_from_parts(sv.data, delim.len);
+	size_t i = 0;
+	while (i + delim.len <= sv.len && !sv_eq(window, delim)) {
+		i++;
+		window.data++;
+	}
+	return i + delim.len <= sv.len ? i : sv.len;
+}
+
+static size_t bench_split_by_sv(string_view sv, string_view delim, size_t (*find)(string_view, string_view))
+{
+	size_t count = 0;
+	while (sv.len > 0) {
+		size_t i = find(sv, delim);
+		count++;
+		if (i == sv.len)
+			break;
+		sv.data += i + delim.len;
+		sv.len -= i + delim.len;
+	}
+	return count;
+}
+
+// Multipart like payload, headers separated from 64k bodies
+void bench_find(void)
+{
+	size_t size = BENCH_SPLIT_SIZE / 4;
+	printf("-------------------------------------------\n");
+	printf("find: %.0f MiB\n", size / (1024.0 * 1024.0));
+
+	char *text = bench_make_text(size);
+	for (size_t i = 0; i + 64 < size; i += 65536) {
+		memcpy(text + i, "--boundary\r\n", 12);
+		memcpy(text + i + 40, "\r\n\r\n", 4);
+	}
+
+	string_view sv = sv_from_parts(text, size);
+	const char *delims[] = { "\r\n\r\n", "--boundary", "--a-much-longer-boundary-than-32-bytes" };
+
+	for (size_t d = 0; d < ARRAY_SIZE(delims); d++) {
+		hr_clock time;
+		char name[96];
+		string_view delim = sv_from_cstr((char*)delims[d]);
+
+		start_clock(&time);
+		size_t count = bench_split_by_sv(sv, delim, bench_find_window);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "sliding sv_eq, %zu byte delim", delim.len);
+		bench_report(name, &time, count, size);
+
+		start_clock(&time);
+		size_t count_find = bench_split_by_sv(sv, delim, sv_find);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "sv_find, %zu byte delim", delim.len);
+		bench_report(name, &time, count_find, size);
+
+		if (count != count_find)
+			printf("token count mismatch %zu != %zu\n", count, count_find);
+	}
+
+	free(text);
+}
+
+#ifndef BENCH_NUMBER_COUNT
+#define BENCH_NUMBER_COUNT 10000000
+#endif
+
+// Comma separated numbers, NUL terminated so strto* can run on it too
+static char *bench_make_numbers(const char *format, int floats, size_t *size)
+{
+	char *text = malloc(BENCH_NUMBER_COUNT * 32 + 1);
+	size_t len = 0;
+	for (size_t i = 0; i < BENCH_NUMBER_COUNT; i++) {
+		if (floats)
+			len += sprintf(text + len, format, bench_rand_unit() * 1e6);
+		else
+			len += sprintf(text + len, format, (unsigned long long)(bench_rand() >> (bench_rand() % 64)));
+		text[len++] = ',';
+	}
+	text[len] = '\0';
+	*size = len;
+	return text;
+}
+
+void bench_number(void)
+{
+	printf("-------------------------------------------\n");
+	printf("number: %d numbers\n", BENCH_NUMBER_COUNT);
+
+	const char *formats[] = { "%llu", "%.3f", "%.17g" };
+	for (size_t f = 0; f < ARRAY_SIZE(formats); f++) {
+		int floats = f > 0;
+		size_t size;
+		char *text = bench_make_numbers(formats[f], floats, &size);
+		char name[64];
+		hr_clock time;
+		f64 sum_std = 0, sum_sv = 0;
+
+		start_clock(&time);
+		for (char *p = text; *p; p++)
+			sum_std += floats ? strtod(p, &p) : strtoull(p, &p, 10);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "%s, \"%s\"", floats ? "strtod" : "strtoull", formats[f]);
+		bench_report(name, &time, BENCH_NUMBER_COUNT, size);
+
+		start_clock(&time);
+		string_view sv = sv_from_parts(text, size);
+		while (sv.len > 0) {
+			size_t len;
+			if (floats) {
+				f64 value;
+				len = sv_to_f64(sv, &value);
+				sum_sv += value;
+			} else {
+				uint64 value;
+				len = sv_to_u64(sv, &value);
+				sum_sv += value;
+			}
+			sv.data += len + 1;
+			sv.len -= len + 1;
+		}
+		end_clock(&time);
+		snprintf(name, sizeof(name), "%s, \"%s\"", floats ? "sv_to_f64" : "sv_to_u64", formats[f]);
+		bench_report(name, &time, BENCH_NUMBER_COUNT, size);
+
+		if (sum_std != sum_sv)
+			printf("sum mismatch %f != %f\n", sum_std, sum_sv);
+		free(text);
+	}
+}
+
+#ifndef BENCH_HASH_BYTES
+#define BENCH_HASH_BYTES (1UL << 30)
+#endif
+
+// The FNV-1a intern.c used before hash.h
+static uint64 bench_fnv1a(const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	uint64 hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+void bench_hash(void)
+{
+	printf("-------------------------------------------\n");
+	printf("hash: %.0f MiB per key size\n", BENCH_HASH_BYTES / (1024.0 * 1024.0));
+
+	const size_t sizes[] = { 4, 8, 16, 32, 64, 128, 256, 1024, 4096, 65536, 1 << 20 };
+	size_t max = sizes[ARRAY_SIZE(sizes) - 1];
+	unsigned char *data = malloc(max + 64);
+	for (size_t i = 0; i < max + 64; i++)
+		data[i] = bench_rand();
+
+	for (size_t s = 0; s < ARRAY_SIZE(sizes); s++) {
+		size_t size = sizes[s];
+		size_t count = BENCH_HASH_BYTES / size;
+		uint64 sum = 0;
+		hr_clock time;
+		char name[64];
+
+		// The offset keeps the short keys from being hashed from one address
+		start_clock(&time);
+		for (size_t i = 0; i < count; i++)
+			sum += hash64(data + (i & 63), size, i);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "hash64, %zu bytes", size);
+		bench_report(name, &time, count, BENCH_HASH_BYTES);
+
+		if (size <= 4096) {
+			start_clock(&time);
+			for (size_t i = 0; i < count; i++)
+				sum += bench_fnv1a(data + (i & 63), size);
+			end_clock(&time);
+			snprintf(name, sizeof(name), "fnv1a, %zu bytes", size);
+			bench_report(name, &time, count, BENCH_HASH_BYTES);
+		}
+		do_not_optimize_away(&sum);
+	}
+
+	struct hash_state state;
+	hr_clock time;
+	hash_init(&state, 0);
+	start_clock(&time);
+	for (size_t done = 0; done < BENCH_HASH_BYTES; done += 4096)
+		hash_update(&state, data + (done & (max - 1)), 4096);
+	uint64 result = hash_final(&state);
+	end_clock(&time);
+	do_not_optimize_away(&result);
+	bench_report("hash_update, 4096 byte pieces", &time, BENCH_HASH_BYTES / 4096, BENCH_HASH_BYTES);
+
+	free(data);
+}
+
+void bench_utf8(void)
+{
+	size_t size = BENCH_SPLIT_SIZE / 4;
+	printf("-------------------------------------------\n");
+	printf("utf8: %.0f MiB\n", size / (1024.0 * 1024.0));
+
+	const char *ascii_text = bench_make_text(size);
+	char *mixed_text = malloc(size);
+	const char *pieces[] = { "word ", "h\xc3\xa9llo ", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xd0\xbc\xd0\xb8\xd1\x80 " };
+	size_t len = 0;
+	while (len < size) {
+		const char *piece = pieces[bench_rand() % ARRAY_SIZE(pieces)];
+		size_t n = strlen(piece);
+		if (len + n > size)
+			n = 0;
+		memcpy(mixed_text + len, piece, n);
+		len += n;
+		if (n == 0)
+			mixed_text[len++] = ' ';
+	}
+
+	const char *texts[] = { ascii_text, mixed_text };
+	const char *names[] = { "ascii", "mixed" };
+	for (int t = 0; t < 2; t++) {
+		string_view sv = sv_from_parts((char*)texts[t], size);
+		hr_clock time;
+		char name[64];
+
+		start_clock(&time);
+		string_view walk = sv;
+		int valid = 1;
+		while (walk.len > 0)
+			if (sv_utf8_next(&walk) < 0)
+				valid = 0;
+		end_clock(&time);
+		snprintf(name, sizeof(name), "sv_utf8_next loop, %s", names[t]);
+		bench_report(name, &time, size, size);
+
+		start_clock(&time);
+		int valid_simd = sv_utf8_validate(sv);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "sv_utf8_validate, %s", names[t]);
+		bench_report(name, &time, size, size);
+
+		start_clock(&time);
+		size_t count = sv_utf8_count(sv);
+		end_clock(&time);
+		do_not_optimize_away(&count);
+		snprintf(name, sizeof(name), "sv_utf8_count, %s", names[t]);
+		bench_report(name, &time, size, size);
+
+		if (valid != valid_simd || !valid)
+			printf("validation mismatch %d != %d\n", valid, valid_simd);
+	}
+
+	free((char*)ascii_text);
+	free(mixed_text);
+}
+
+#ifndef BENCH_MP_BASELINE_SIZE
+#define BENCH_MP_BASELINE_SIZE (16UL << 20)
+#endif
+
+static size_t bench_mp_find_each(struct strvec *patterns, string_view sv)
+{
+	size_t matches = 0;
+	for (size_t i = 0; i < strvec_count(patterns); i++) {
+		string_view pattern = strvec_get_sv(patterns, i);
+		string_view rest = sv;
+		size_t at;
+		while ((at = sv_find(rest, pattern)) < rest.len) {
+			matches++;
+			rest.data += at + 1;
+			rest.len -= at + 1;
+		}
+	}
+	return matches;
+}
+
+void bench_multi_pattern(void)
+{
+	printf("-------------------------------------------\n");
+	printf("multi_pattern: %.0f MiB, sv_find per pattern on %.0f MiB\n",
+	       BENCH_SPLIT_SIZE / (1024.0 * 1024.0), BENCH_MP_BASELINE_SIZE / (1024.0 * 1024.0));
+
+	char *text = bench_make_text(BENCH_SPLIT_SIZE);
+	string_view sv = sv_from_parts(text, BENCH_SPLIT_SIZE);
+	string_view slice = sv_from_parts(text, MIN(BENCH_MP_BASELINE_SIZE, BENCH_SPLIT_SIZE));
+	const size_t counts[] = { 10, 100, 1000 };
+
+	for (size_t c = 0; c < ARRAY_SIZE(counts); c++) {
+		struct strvec patterns;
+		struct mp_matcher matcher;
+		char name[64];
+		hr_clock time;
+
+		strvec_init(&patterns);
+		for (size_t i = 0; i < counts[c]; i++) {
+			char word[16];
+			size_t len = 4 + bench_rand() % 8;
+			for (size_t j = 0; j < len; j++)
+				word[j] = 'a' + bench_rand() % 26;
+			strvec_push_len(&patterns, word, len);
+			// some of them show up every few KiB
+			for (size_t at = bench_rand() % 65536; at + len < BENCH_SPLIT_SIZE; at += 65536 * counts[c] / 10)
+				memcpy(text + at, word, len);
+		}
+
+		start_clock(&time);
+		mp_build(&matcher, &patterns);
+		end_clock(&time);
+		printf("%zu patterns: %zu states, %zu classes, %zu KiB, built in %.3f ms\n", counts[c],
+		       matcher.state_count, matcher.class_count, mp_memory(&matcher) / 1024, time.wt * 1e3);
+
+		start_clock(&time);
+		size_t matches = mp_scan(&matcher, sv, NULL, NULL);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "mp_scan, %zu patterns", counts[c]);
+		bench_report(name, &time, BENCH_SPLIT_SIZE, BENCH_SPLIT_SIZE);
+
+		start_clock(&time);
+		size_t slice_matches = bench_mp_find_each(&patterns, slice);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "sv_find each, %zu patterns", counts[c]);
+		bench_report(name, &time, slice.len, slice.len);
+
+		if (mp_scan(&matcher, slice, NULL, NULL) != slice_matches)
+			printf("match count mismatch on the slice\n");
+		do_not_optimize_away(&matches);
+
+		mp_free(&matcher);
+		strvec_delete_struct(&patterns);
+	}
+
+	free(text);
+}
+
+#ifndef BENCH_SB_LINES
+#define BENCH_SB_LINES 5000000
+#endif
+
+void bench_string_builder(void)
+{
+	printf("-------------------------------------------\n");
+	printf("string_builder: %d lines\n", BENCH_SB_LINES);
+
+	// Build the same report with every method, one line per key
+	hr_clock time;
+	size_t total = 0;
+
+	start_clock(&time);
+	for (int i = 0; i < BENCH_SB_LINES; i++) {
+		char *line = xasprintf("key%d = %d, %s\n", i, i * 7, "value");
+		total += strlen(line);
+		free(line);
+	}
+	end_clock(&time);
+	bench_report("xasprintf per line", &time, BENCH_SB_LINES, total);
+
+	struct string_builder sb;
+	sb_init(&sb, 0);
+	total = 0;
+	start_clock(&time);
+	for (int i = 0; i < BENCH_SB_LINES; i++) {
+		sb_reset(&sb);
+		sb_appendf(&sb, "key%d = %d, %s\n", i, i * 7, "value");
+		total += sb.len;
+	}
+	end_clock(&time);
+	bench_report("sb_appendf, reused buffer", &time, BENCH_SB_LINES, total);
+
+	sb_reset(&sb);
+	start_clock(&time);
+	for (int i = 0; i < BENCH_SB_LINES; i++)
+		sb_appendf(&sb, "key%d = %d, %s\n", i, i * 7, "value");
+	end_clock(&time);
+	bench_report("sb_appendf, one string", &time, BENCH_SB_LINES, sb.len);
+
+	sb_reset(&sb);
+	start_clock(&time);
+	for (int i = 0; i < BENCH_SB_LINES; i++) {
+		sb_append_cstr(&sb, "key");
+		sb_append_i64(&sb, i);
+		sb_append(&sb, " = ", 3);
+		sb_append_i64(&sb, i * 7);
+		sb_append_sv(&sb, SV(", value\n"));
+	}
+	end_clock(&time);
+	bench_report("sb_append_*, one string", &time, BENCH_SB_LINES, sb.len);
+	sb_free(&sb);
+
+	struct arena ar;
+	arena_init(&ar);
+	sb_init_arena(&sb, &ar, 0);
+	start_clock(&time);
+	for (int i = 0; i < BENCH_SB_LINES; i++)
+		sb_appendf(&sb, "key%d = %d, %s\n", i, i * 7, "value");
+	end_clock(&time);
+	bench_report("sb_appendf, arena", &time, BENCH_SB_LINES, sb.len);
+	arena_free(&ar);
+}
+
+#ifndef BENCH_FMT_COUNT
+#define BENCH_FMT_COUNT 10000000
+#endif
+
+void bench_fmt(void)
+{
+	printf("-------------------------------------------\n");
+	printf("fmt: %d values\n", BENCH_FMT_COUNT);
+
+	// Uniform over the bit patterns, so most integers have 18-20
+	// digits, plus uniform over the digit counts
+	uint64 *ints = malloc(BENCH_FMT_COUNT * sizeof(uint64));
+	uint64 *short_ints = malloc(BENCH_FMT_COUNT * sizeof(uint64));
+	f64 *floats = malloc(BENCH_FMT_COUNT * sizeof(f64));
+	for (size_t i = 0; i < BENCH_FMT_COUNT; i++) {
+		ints[i] = bench_rand();
+		short_ints[i] = bench_rand() >> (bench_rand() % 64);
+		uint64 bits = bench_rand() & ~(0x7ffULL << 52);
+		bits |= (uint64)(1 + bench_rand() % 2046) << 52;
+		memcpy(&floats[i], &bits, sizeof(f64));
+	}
+
+	char buf[64];
+	size_t total;
+	hr_clock time;
+	struct {
+		const char *name;
+		uint64 *values;
+	} int_sets[] = { { "uniform bits", ints }, { "uniform length", short_ints } };
+
+	for (size_t s = 0; s < ARRAY_SIZE(int_sets); s++) {
+		uint64 *values = int_sets[s].values;
+		char name[64];
+
+		total = 0;
+		start_clock(&time);
+		for (size_t i = 0; i < BENCH_FMT_COUNT; i++)
+			total += snprintf(buf, sizeof(buf), "%llu", (unsigned long long)values[i]);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "snprintf %%llu, %s", int_sets[s].name);
+		bench_report(name, &time, BENCH_FMT_COUNT, total);
+
+		total = 0;
+		start_clock(&time);
+		for (size_t i = 0; i < BENCH_FMT_COUNT; i++)
+			total += fmt_u64(buf, values[i]);
+		end_clock(&time);
+		do_not_optimize_away(buf);
+		snprintf(name, sizeof(name), "fmt_u64, %s", int_sets[s].name);
+		bench_report(name, &time, BENCH_FMT_COUNT, total);
+
+		total = 0;
+		start_clock(&time);
+		for (size_t i = 0; i < BENCH_FMT_COUNT; i++)
+			total += snprintf(buf, sizeof(buf), "%llx", (unsigned long long)values[i]);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "snprintf %%llx, %s", int_sets[s].name);
+		bench_report(name, &time, BENCH_FMT_COUNT, total);
+
+		total = 0;
+		start_clock(&time);
+		for (size_t i = 0; i < BENCH_FMT_COUNT; i++)
+			total += fmt_hex64(buf, values[i]);
+		end_clock(&time);
+		do_not_optimize_away(buf);
+		snprintf(name, sizeof(name), "fmt_hex64, %s", int_sets[s].name);
+		bench_report(name, &time, BENCH_FMT_COUNT, total);
+	}
+
+	// %.17g is what snprintf needs to round trip, it is still
+	// longer than the shortest form
+	total = 0;
+	start_clock(&time);
+	for (size_t i = 0; i < BENCH_FMT_COUNT; i++)
+		total += snprintf(buf, sizeof(buf), "%.17g", floats[i]);
+	end_clock(&time);
+	bench_report("snprintf %.17g", &time, BENCH_FMT_COUNT, total);
+
+	total = 0;
+	start_clock(&time);
+	for (size_t i = 0; i < BENCH_FMT_COUNT; i++)
+		total += fmt_f64(buf, floats[i]);
+	end_clock(&time);
+	do_not_optimize_away(buf);
+	bench_report("fmt_f64", &time, BENCH_FMT_COUNT, total);
+
+	free(ints);
+	free(short_ints);
+	free(floats);
+}
+
+#ifndef BENCH_SKIP_SIZE
+#define BENCH_SKIP_SIZE (256UL << 20)
+#endif
+
+static int bench_is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void bench_skip(void)
+{
+	printf("-------------------------------------------\n");
+	printf("skip: %.0f MiB\n", BENCH_SKIP_SIZE / (1024.0 * 1024.0));
+
+	// Config like lines, indented keys with long values
+	char *text = malloc(BENCH_SKIP_SIZE);
+	size_t len = 0;
+	while (len < BENCH_SKIP_SIZE) {
+		size_t indent = bench_rand() % 9, word = 4 + bench_rand() % 60;
+		for (size_t i = 0; i < indent && len < BENCH_SKIP_SIZE; i++)
+			text[len++] = i % 4 == 3 ? '\t' : ' ';
+		for (size_t i = 0; i < word && len < BENCH_SKIP_SIZE; i++)
+			text[len++] = 'a' + bench_rand() % 26;
+		if (len < BENCH_SKIP_SIZE)
+			text[len++] = bench_rand() % 4 ? ' ' : '\n';
+	}
+	char *end = text + len;
+	size_t words = 0, lines = 0;
+	hr_clock time;
+
+	start_clock(&time);
+	for (char *p = text; p < end;) {
+		while (p < end && bench_is_space(*p))
+			p++;
+		if (p == end)
+			break;
+		while (p < end && !bench_is_space(*p))
+			p++;
+		words++;
+	}
+	end_clock(&time);
+	bench_report("words, byte loop", &time, words, len);
+
+	words = 0;
+	start_clock(&time);
+	for (char *p = so_skip_whitespace_bounded(text, end); p < end; words++)
+		p = so_skip_untill_next_word_bounded(p, end);
+	end_clock(&time);
+	bench_report("words, so_skip_*_bounded", &time, words, len);
+
+	start_clock(&time);
+	for (char *p = text; p < end; lines++) {
+		while (p < end && *p != '\n')
+			p++;
+		p += p < end;
+	}
+	end_clock(&time);
+	bench_report("lines, byte loop", &time, lines, len);
+
+	lines = 0;
+	start_clock(&time);
+	for (char *p = text; p < end; lines++)
+		p = so_skip_to_nextline_bounded(p, end);
+	end_clock(&time);
+	bench_report("lines, so_skip_to_nextline_bounded", &time, lines, len);
+
+	free(text);
+}
+
+#ifndef BENCH_LINE_QUERIES
+#define BENCH_LINE_QUERIES 1000000
+#endif
+
+void bench_line_index(void)
+{
+	size_t size = BENCH_SPLIT_SIZE / 2;
+	printf("-------------------------------------------\n");
+	printf("line_index: %.0f MiB, %d queries\n", size / (1024.0 * 1024.0), BENCH_LINE_QUERIES);
+
+	char *text = bench_make_text(size);
+	string_view sv = sv_from_parts(text, size);
+	struct line_index li;
+	hr_clock time;
+
+	size_t lines = 0;
+	start_clock(&time);
+	for (size_t i = 0; i < size; i++)
+		lines += text[i] == '\n';
+	end_clock(&time);
+	do_not_optimize_away(&lines);
+	bench_report("count newlines, byte loop", &time, lines, size);
+
+	start_clock(&time);
+	line_index_build(&li, sv, 0, 1);
+	end_clock(&time);
+	bench_report("line_index_build, 1 thread", &time, line_count(&li), size);
+	line_index_free(&li);
+
+	start_clock(&time);
+	line_index_build(&li, sv, 0, 0);
+	end_clock(&time);
+	bench_report("line_index_build, all cores", &time, line_count(&li), size);
+
+	// Walking to a line is what sv_next_line allows, so only go a
+	// short way into the buffer
+	size_t walk = line_count(&li) / 100;
+	start_clock(&time);
+	string_view rest = sv;
+	for (size_t i = 0; i < walk; i++)
+		rest = sv_next_line(rest);
+	end_clock(&time);
+	do_not_optimize_away(&rest);
+	bench_report("sv_next_line walk, per line", &time, walk, 0);
+
+	size_t total = 0;
+	start_clock(&time);
+	for (size_t i = 0; i < BENCH_LINE_QUERIES; i++)
+		total += line_at(&li, bench_rand() % line_count(&li)).len;
+	end_clock(&time);
+	do_not_optimize_away(&total);
+	bench_report("line_at, random lines", &time, BENCH_LINE_QUERIES, 0);
+
+	start_clock(&time);
+	for (size_t i = 0; i < BENCH_LINE_QUERIES; i++)
+		total += line_of_offset(&li, bench_rand() % size);
+	end_clock(&time);
+	do_not_optimize_away(&total);
+	bench_report("line_of_offset, random offsets", &time, BENCH_LINE_QUERIES, 0);
+
+	printf("index: %zu bytes for %zu lines\n", li.offsets.index * sizeof(uint64), line_count(&li));
+	line_index_free(&li);
+	free(text);
+}
+
+static int bench_csv_count(void *ctx, string_view *fields, size_t count)
+{
+	(void)fields;
+	*(size_t*)ctx += count;
+	return 0;
+}
+
+void bench_csv(void)
+{
+	size_t size = BENCH_SPLIT_SIZE / 2;
+	printf("-------------------------------------------\n");
+	printf("csv: %.0f MiB\n", size / (1024.0 * 1024.0));
+
+	// 8 fields per line, every 16th field quoted and some of those
+	// hold delimiters or doubled quotes
+	char *text = malloc(size);
+	size_t len = 0;
+	while (len + 256 < size) {
+		for (int field = 0; field < 8; field++) {
+			size_t n = 2 + bench_rand() % 14;
+			int quoted = bench_rand() % 16 == 0;
+			if (quoted)
+				text[len++] = '"';
+			for (size_t j = 0; j < n; j++)
+				text[len++] = 'a' + bench_rand() % 26;
+			if (quoted) {
+				uint64 kind = bench_rand() % 4;
+				if (kind == 0) {
+					text[len++] = ',';
+				} else if (kind == 1) {
+					text[len++] = '"';
+					text[len++] = '"';
+				}
+				text[len++] = '"';
+			}
+			text[len++] = field == 7 ? '\n' : ',';
+		}
+	}
+	string_view sv = sv_from_parts(text, len);
+	hr_clock time;
+
+	// What we had, gets quoted fields wrong
+	size_t fields = 0;
+	start_clock(&time);
+	string_view rest = sv;
+	while (rest.len > 0) {
+		string_view line = sv_chop_by_delim(&rest, '\n');
+		while (line.len > 0) {
+			sv_chop_by_delim(&line, ',');
+			fields++;
+		}
+	}
+	end_clock(&time);
+	bench_report("sv_chop_by_delim lines and fields", &time, fields, len);
+
+	struct csv_parser p;
+	fields = 0;
+	csv_init(&p, ',', bench_csv_count, &fields);
+	start_clock(&time);
+	csv_parse(&p, sv);
+	end_clock(&time);
+	csv_free(&p);
+	bench_report("csv_parse, callback", &time, fields, len);
+
+	fields = 0;
+	csv_init(&p, ',', bench_csv_count, &fields);
+	start_clock(&time);
+	for (size_t i = 0; i < len; i += 65536)
+		csv_feed(&p, sv_from_parts(text + i, MIN(65536, len - i)));
+	csv_finish(&p);
+	end_clock(&time);
+	csv_free(&p);
+	bench_report("csv_feed, 64 KiB chunks", &time, fields, len);
+
+	struct csv_table table;
+	start_clock(&time);
+	csv_parse_table(&table, sv, ',', 1);
+	end_clock(&time);
+	bench_report("csv_parse_table, 1 thread", &time, table.fields.index, len);
+	csv_table_free(&table);
+
+	start_clock(&time);
+	csv_parse_table(&table, sv, ',', 0);
+	end_clock(&time);
+	bench_report("csv_parse_table, all cores", &time, table.fields.index, len);
+	csv_table_free(&table);
+
+	free(text);
+}
+
+#ifndef BENCH_JSON_SIZE
+#define BENCH_JSON_SIZE (128 << 20)
+#endif
+
+// Baseline, the usual recursive descent parser that looks at every
+// byte once and writes the same node tape as json_parse
+struct bench_rd {
+	const char *data;
+	size_t p;
+	size_t len;
+	struct array nodes;
+};
+
+static void bench_rd_space(struct bench_rd *rd)
+{
+	while (rd->p < rd->len && (rd->data[rd->p] == ' ' || rd->data[rd->p] == '\n' ||
+				   rd->data[rd->p] == '\r' || rd->data[rd->p] == '\t'))
+		rd->p++;
+}
+
+static struct json_node *bench_rd_node(struct bench_rd *rd, uint32 type)
+{
+	struct json_node *node = array_alloc(&rd->nodes);
+	node->type = type;
+	node->offset = rd->p;
+	node->len = 0;
+	node->end = rd->nodes.index;
+	return node;
+}
+
+static int bench_rd_string(struct bench_rd *rd)
+{
+	rd->p++;
+	struct json_node *node = bench_rd_node(rd, JSON_STRING);
+	while (rd->p < rd->len && rd->data[rd->p] != '"') {
+		if (rd->data[rd->p] == '\\')
+			rd->p++;
+		rd->p++;
+	}
+	if (rd->p >= rd->len)
+		return 0;
+	node->len = rd->p - node->offset;
+	rd->p++;
+	return 1;
+}
+
+static int bench_rd_value(struct bench_rd *rd, int depth)
+{
+	bench_rd_space(rd);
+	if (rd->p >= rd->len || depth > JSON_MAX_DEPTH)
+		return 0;
+	char c = rd->data[rd->p];
+	if (c == '"')
+		return bench_rd_string(rd);
+	if (c != '{' && c != '[') {
+		struct json_node *node = bench_rd_node(rd, JSON_NUMBER);
+		while (rd->p < rd->len && strchr("0123456789+-.eEtruefalsn", rd->data[rd->p]))
+			rd->p++;
+		node->len = rd->p - node->offset;
+		return node->len > 0;
+	}
+
+	char close = c == '{' ? '}' : ']';
+	size_t index = rd->nodes.index, children = 0;
+	bench_rd_node(rd, c == '{' ? JSON_OBJECT : JSON_ARRAY);
+	rd->p++;
+	bench_rd_space(rd);
+	if (rd->p < rd->len && rd->data[rd->p] == close)
+		goto done;
+	for (;;) {
+		if (c == '{') {
+			bench_rd_space(rd);
+			if (rd->p >= rd->len || rd->data[rd->p] != '"' || !bench_rd_string(rd))
+				return 0;
+			bench_rd_space(rd);
+			if (rd->p >= rd->len || rd->data[rd->p++] != ':')
+				return 0;
+		}
+		if (!bench_rd_value(rd, depth + 1))
+			return 0;
+		children++;
+		bench_rd_space(rd);
+		if (rd->p >= rd->len)
+			return 0;
+		if (rd->data[rd->p] == close)
+			break;
+		if (rd->data[rd->p++] != ',')
+			return 0;
+	}
+done:
+	rd->p++;
+	struct json_node *node = array_get(&rd->nodes, index);
+	node->len = children;
+	node->end = rd->nodes.index;
+	return 1;
+}
+
+void bench_json(void)
+{
+	size_t size = BENCH_JSON_SIZE;
+	printf("-------------------------------------------\n");
+	printf("json: %.0f MiB\n", size / (1024.0 * 1024.0));
+
+	// Array of records with short strings, numbers, a nested array
+	// and now and then an escape
+	struct string_builder sb;
+	sb_init(&sb, size + 4096);
+	sb_append_cstr(&sb, "[\n");
+	for (uint64 id = 0; sb.len < size; id++) {
+		if (id > 0)
+			sb_append_cstr(&sb, ",\n");
+		sb_appendf(&sb, "  {\"id\": %llu, \"name\": \"user%llu%s\", \"score\": %llu.%02llu,"
+			   " \"active\": %s, \"tags\": [\"t%llu\", \"t%llu\"], \"parent\": null}",
+			   (unsigned long long)id, (unsigned long long)bench_rand() % 100000,
+			   bench_rand() % 8 == 0 ? "\\\"q\\\"" : "",
+			   (unsigned long long)bench_rand() % 1000, (unsigned long long)bench_rand() % 100,
+			   bench_rand() % 2 ? "true" : "false",
+			   (unsigned long long)bench_rand() % 50, (unsigned long long)bench_rand() % 50);
+	}
+	sb_append_cstr(&sb, "\n]\n");
+	string_view sv = sb_to_sv(&sb);
+	hr_clock time;
+
+	struct bench_rd rd = { sv.data, 0, sv.len, {0} };
+	array_init(&rd.nodes, sizeof(struct json_node), 0);
+	start_clock(&time);
+	int ok = bench_rd_value(&rd, 0);
+	end_clock(&time);
+	bench_report("recursive descent", &time, rd.nodes.index, sv.len);
+	do_not_optimize_away(&ok);
+	array_free(&rd.nodes);
+
+	struct arena arena;
+	struct json_doc doc;
+	arena_init(&arena);
+	start_clock(&time);
+	json_parse(&doc, &arena, sv);
+	end_clock(&time);
+	bench_report("json_parse", &time, doc.count, sv.len);
+
+	f64 sum = 0, score;
+	start_clock(&time);
+	struct json_iter it = json_iter(json_root(&doc));
+	json_value record;
+	size_t records = 0;
+	while (json_iter_next(&it, NULL, &record)) {
+		if (json_f64(json_get(record, SV("score")), &score))
+			sum += score;
+		records++;
+	}
+	end_clock(&time);
+	bench_report("json_get + json_f64 on every record", &time, records, sv.len);
+	do_not_optimize_away(&sum);
+
+	arena_free(&arena);
+	sb_free(&sb);
+}
+
+#ifndef BENCH_GLOB_PATTERNS
+#define BENCH_GLOB_PATTERNS 2000
+#endif
+
+#ifndef BENCH_GLOB_PATHS
+#define BENCH_GLOB_PATHS 20000
+#endif
+
+// Baseline, the usual backtracking matcher with '**' support
+static int bench_glob_naive(const char *p, const char *s)
+{
+	if (*p == '\0')
+		return *s == '\0';
+	if (*p == '*') {
+		int globstar = p[1] == '*';
+		p += globstar ? 2 : 1;
+		if (globstar && *p == '/' && bench_glob_naive(p + 1, s))
+			return 1;
+		for (;; s++) {
+			if (bench_glob_naive(p, s))
+				return 1;
+			if (*s == '\0' || (*s == '/' && !globstar))
+				return 0;
+		}
+	}
+	if (*s == '\0' || (*p == '?' && *s == '/'))
+		return 0;
+	if (*p == '[') {
+		int negate = p[1] == '!', in = 0;
+		for (p += 1 + negate; *p != ']'; p++)
+			in |= (p[1] == '-' && p[2] != ']') ? (*s >= p[0] && *s <= p[2] && (p += 2)) : *p == *s;
+		return in != negate && bench_glob_naive(p + 1, s + 1);
+	}
+	return (*p == '?' || *p == *s) && bench_glob_naive(p + 1, s + 1);
+}
+
+void bench_glob(void)
+{
+	static const char *exts[] = { "c", "h", "md", "txt", "json", "py" };
+	printf("-------------------------------------------\n");
+	printf("glob: %d patterns, %d paths\n", BENCH_GLOB_PATTERNS, BENCH_GLOB_PATHS);
+
+	struct strvec paths, patterns;
+	strvec_init(&paths);
+	strvec_init(&patterns);
+	char buf[256];
+	size_t bytes = 0;
+	for (int i = 0; i < BENCH_GLOB_PATHS; i++) {
+		int len = snprintf(buf, sizeof(buf), "project/dir%d/sub%d/module_%d/name%d.%s",
+				   (int)(bench_rand() % 50), (int)(bench_rand() % 20), (int)(bench_rand() % 10),
+				   (int)(bench_rand() % 5000), exts[bench_rand() % 6]);
+		strvec_push_len(&paths, buf, len);
+		bytes += len;
+	}
+	for (int i = 0; i < BENCH_GLOB_PATTERNS; i++) {
+		uint64 a = bench_rand() % 50, b = bench_rand() % 5000;
+		const char *ext = exts[bench_rand() % 6];
+		switch (i % 5) {
+		case 0: snprintf(buf, sizeof(buf), "project/dir%d/**/*.%s", (int)a, ext); break;
+		case 1: snprintf(buf, sizeof(buf), "**/name%d.%s", (int)b, ext); break;
+		case 2: snprintf(buf, sizeof(buf), "project/dir%d/sub*/module_?/*.%s", (int)a, ext); break;
+		case 3: snprintf(buf, sizeof(buf), "project/*/sub1[0-9]/**/name%d*", (int)b); break;
+		default: snprintf(buf, sizeof(buf), "**/module_[!0-4]/name*%d.%s", (int)b, ext); break;
+		}
+		strvec_push(&patterns, buf);
+	}
+	size_t count = strvec_count(&paths);
+	hr_clock time;
+
+	// One pattern against every path
+	char *single = strvec_get(&patterns, 0);
+	struct glob_pattern g;
+	glob_compile(&g, sv_from_cstr(single), GLOB_PATHNAME);
+	size_t hits = 0;
+	start_clock(&time);
+	for (int rep = 0; rep < 50; rep++)
+		for (size_t i = 0; i < count; i++)
+			hits += bench_glob_naive(single, strvec_get(&paths, i));
+	end_clock(&time);
+	bench_report("backtracking, one pattern", &time, 50 * count, 50 * bytes);
+	size_t want = hits;
+
+	hits = 0;
+	start_clock(&time);
+	for (int rep = 0; rep < 50; rep++)
+		for (size_t i = 0; i < count; i++)
+			hits += glob_match(&g, strvec_get_sv(&paths, i));
+	end_clock(&time);
+	bench_report("glob_match, one pattern", &time, 50 * count, 50 * bytes);
+	if (hits != want)
+		printf("glob_match disagrees: %zu vs %zu\n", hits, want);
+	glob_free(&g);
+
+	// Every pattern against every path
+	size_t checks = 2000;
+	hits = 0;
+	start_clock(&time);
+	for (size_t i = 0; i < checks; i++) {
+		char *path = strvec_get(&paths, i);
+		for (size_t k = 0; k < BENCH_GLOB_PATTERNS; k++)
+			hits += bench_glob_naive(strvec_get(&patterns, k), path);
+	}
+	end_clock(&time);
+	bench_report("backtracking, every pattern", &time, checks, 0);
+	want = hits;
+
+	struct glob_set set;
+	struct array matches;
+	array_init(&matches, sizeof(size_t), 0);
+	start_clock(&time);
+	glob_set_build(&set, &patterns, GLOB_PATHNAME);
+	end_clock(&time);
+	bench_report("glob_set_build", &time, BENCH_GLOB_PATTERNS, 0);
+
+	hits = 0;
+	start_clock(&time);
+	for (size_t i = 0; i < count; i++) {
+		matches.index = 0;
+		glob_set_matches(&set, strvec_get_sv(&paths, i), &matches);
+		if (i < checks)
+			hits += matches.index;
+	}
+	end_clock(&time);
+	bench_report("glob_set_matches", &time, count, bytes);
+	if (hits != want)
+		printf("glob_set_matches disagrees: %zu vs %zu\n", hits, want);
+
+	glob_set_free(&set);
+	array_free(&matches);
+	strvec_delete_struct(&paths);
+	strvec_delete_struct(&patterns);
+}
+
+#ifndef BENCH_ENCODING_SIZE
+#define BENCH_ENCODING_SIZE (64 << 20)
+#endif
+
+// Baseline, the usual table driven code
+static size_t bench_base64_table_encode(char *out, const unsigned char *in, size_t len)
+{
+	static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	size_t o = 0;
+	for (size_t i = 0; i + 3 <= len; i += 3) {
+		uint32 v = (uint32)in[i] << 16 | (uint32)in[i + 1] << 8 | in[i + 2];
+		out[o++] = alphabet[v >> 18];
+		out[o++] = alphabet[(v >> 12) & 63];
+		out[o++] = alphabet[(v >> 6) & 63];
+		out[o++] = alphabet[v & 63];
+	}
+	return o;
+}
+
+static size_t bench_base64_table_decode(unsigned char *out, const unsigned char *in, size_t len)
+{
+	static signed char values[256];
+	if (values['B'] == 0) {
+		const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		memset(values, -1, sizeof(values));
+		for (int i = 0; i < 64; i++)
+			values[(unsigned char)alphabet[i]] = i;
+	}
+	size_t o = 0;
+	for (size_t i = 0; i + 4 <= len; i += 4) {
+		int32 v = values[in[i]] << 18 | values[in[i + 1]] << 12 | values[in[i + 2]] << 6 | values[in[i + 3]];
+		if (v < 0)
+			return 0;
+		out[o++] = v >> 16;
+		out[o++] = v >> 8;
+		out[o++] = v;
+	}
+	return o;
+}
+
+void bench_encoding(void)
+{
+	size_t size = BENCH_ENCODING_SIZE / 3 * 3;
+	printf("-------------------------------------------\n");
+	printf("encoding: %.0f MiB\n", size / (1024.0 * 1024.0));
+
+	unsigned char *data = malloc(size);
+	char *text = malloc(base64_encoded_len(size, 0) + 2 * size);
+	char *back = malloc(size);
+	for (size_t i = 0; i < size; i += 8) {
+		uint64 r = bench_rand();
+		memcpy(data + i, &r, MIN(8, size - i));
+	}
+	// Fault the output pages in before timing anything
+	memset(text, 0, base64_encoded_len(size, 0) + 2 * size);
+	memset(back, 0, size);
+	string_view in = sv_from_parts((char*)data, size);
+	size_t len, bad;
+	hr_clock time;
+
+	start_clock(&time);
+	len = bench_base64_table_encode(text, data, size);
+	end_clock(&time);
+	bench_report("base64 table encode", &time, size, size);
+
+	start_clock(&time);
+	len = base64_encode(text, in, 0);
+	end_clock(&time);
+	bench_report("base64_encode", &time, size, size);
+
+	start_clock(&time);
+	size_t got = bench_base64_table_decode((unsigned char*)back, (unsigned char*)text, len);
+	end_clock(&time);
+	bench_report("base64 table decode", &time, len, len);
+	do_not_optimize_away(&got);
+
+	start_clock(&time);
+	base64_decode(back, sv_from_parts(text, len), 0, &got, &bad);
+	end_clock(&time);
+	bench_report("base64_decode", &time, len, len);
+	if (got != size || memcmp(back, data, size) != 0)
+		printf("base64 round trip failed\n");
+
+	struct base64_stream st;
+	base64_stream_init(&st, 0);
+	size_t total = 0;
+	start_clock(&time);
+	for (size_t i = 0; i < len; i += 65536) {
+		base64_decode_update(&st, back + total, sv_from_parts(text + i, MIN(65536, len - i)), &got, &bad);
+		total += got;
+	}
+	base64_decode_final(&st, back + total, &got, &bad);
+	end_clock(&time);
+	bench_report("base64_decode_update, 64 KiB chunks", &time, len, len);
+
+	start_clock(&time);
+	len = hex_encode(text, in);
+	end_clock(&time);
+	bench_report("hex_encode", &time, size, size);
+
+	start_clock(&time);
+	hex_decode(back, sv_from_parts(text, len), &got, &bad);
+	end_clock(&time);
+	bench_report("hex_decode", &time, len, len);
+	if (got != size || memcmp(back, data, size) != 0)
+		printf("hex round trip failed\n");
+
+	free(data);
+	free(text);
+	free(back);
+}
+
+#ifndef BENCH_HASHMAP_SLOTS
+#define BENCH_HASHMAP_SLOTS (1 << 20)
+#endif
+
+// Baseline, separate chaining with the nodes in one pool so it does
+// not pay for malloc per insert, buckets as many as hashmap slots
+struct bench_chain_node {
+	uint64 key;
+	uint64 value;
+	uint32 next;
+};
+
+struct bench_chain {
+	uint32 *heads;		// node index + 1, 0 ends a chain
+	struct bench_chain_node *nodes;
+	size_t count;
+	size_t mask;
+};
+
+static uint64 *bench_chain_get(struct bench_chain *c, uint64 key)
+{
+	uint32 n = c->heads[hash64(&key, sizeof(key), 1) & c->mask];
+	for (; n; n = c->nodes[n - 1].next)
+		if (c->nodes[n - 1].key == key)
+			return &c->nodes[n - 1].value;
+	return NULL;
+}
+
+static void bench_chain_put(struct bench_chain *c, uint64 key, uint64 value)
+{
+	uint32 *head = &c->heads[hash64(&key, sizeof(key), 1) & c->mask];
+	for (uint32 n = *head; n; n = c->nodes[n - 1].next)
+		if (c->nodes[n - 1].key == key) {
+			c->nodes[n - 1].value = value;
+			return;
+		}
+	c->nodes[c->count] = (struct bench_chain_node){ key, value, *head };
+	*head = (uint32)++c->count;
+}
+
+// Insert, hit and miss for uint64 -> uint64 at fixed table sizes and
+// growing load. Both tables are filled once before timing so the
+// timed inserts do not pay for page faults.
+void bench_hashmap(void)
+{
+	static const double loads[] = { 0.5, 0.625, 0.75, 0.875 };
+	size_t slots = BENCH_HASHMAP_SLOTS;
+	size_t max = slots - slots / 8;
+	printf("-------------------------------------------\n");
+	printf("hashmap: %zu slots, uint64 keys and values\n", slots);
+
+	uint64 *keys = malloc(max * sizeof(uint64));
+	uint64 *probes = malloc(max * sizeof(uint64));
+	uint64 *misses = malloc(max * sizeof(uint64));
+	for (size_t i = 0; i < max; i++) {
+		keys[i] = bench_rand();
+		misses[i] = bench_rand();
+	}
+
+	struct bench_chain chain;
+	chain.heads = malloc(slots * sizeof(uint32));
+	chain.nodes = malloc(max * sizeof(struct bench_chain_node));
+	chain.mask = slots - 1;
+	memset(chain.nodes, 0, max * sizeof(struct bench_chain_node));
+
+	for (size_t l = 0; l < ARRAY_SIZE(loads); l++) {
+		size_t n = (size_t)(loads[l] * slots);
+		char name[64];
+		uint64 sum = 0;
+		hr_clock time;
+
+		// Look up in another order than inserted, the chain pool is
+		// laid out in insertion order
+		memcpy(probes, keys, n * sizeof(uint64));
+		for (size_t i = n - 1; i > 0; i--) {
+			size_t j = bench_rand() % (i + 1);
+			uint64 t = probes[i];
+			probes[i] = probes[j];
+			probes[j] = t;
+		}
+
+		struct hashmap map;
+		hashmap_init(&map, sizeof(uint64), sizeof(uint64));
+		hashmap_reserve(&map, n);
+		for (size_t i = 0; i < n; i++)
+			hashmap_put(&map, &keys[i], &i);
+		hashmap_clear(&map);
+
+		start_clock(&time);
+		for (size_t i = 0; i < n; i++)
+			hashmap_put(&map, &keys[i], &i);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "hashmap insert, load %.3f", loads[l]);
+		bench_report(name, &time, n, 0);
+		if (hashmap_capacity(&map) != slots)
+			printf("hashmap has %zu slots\n", hashmap_capacity(&map));
+
+		start_clock(&time);
+		for (size_t i = 0; i < n; i++)
+			sum += *(uint64 *)hashmap_get(&map, &probes[i]);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "hashmap hit, load %.3f", loads[l]);
+		bench_report(name, &time, n, 0);
+
+		start_clock(&time);
+		for (size_t i = 0; i < n; i++)
+			sum += hashmap_get(&map, &misses[i]) != NULL;
+		end_clock(&time);
+		snprintf(name, sizeof(name), "hashmap miss, load %.3f", loads[l]);
+		bench_report(name, &time, n, 0);
+		hashmap_free(&map);
+
+		memset(chain.heads, 0, slots * sizeof(uint32));
+		chain.count = 0;
+		start_clock(&time);
+		for (size_t i = 0; i < n; i++)
+			bench_chain_put(&chain, keys[i], i);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "chained insert, load %.3f", loads[l]);
+		bench_report(name, &time, n, 0);
+
+		start_clock(&time);
+		for (size_t i = 0; i < n; i++)
+			sum -= *bench_chain_get(&chain, probes[i]);
+		end_clock(&time);
+		snprintf(name, sizeof(name), "chained hit, load %.3f", loads[l]);
+		bench_report(name, &time, n, 0);
+
+		start_clock(&time);
+		for (size_t i = 0; i < n; i++)
+			sum -= bench_chain_get(&chain, misses[i]) != NULL;
+		end_clock(&time);
+		snprintf(name, sizeof(name), "chained miss, load %.3f", loads[l]);
+		bench_report(name, &time, n, 0);
+
+		if (sum)
+			printf("hashmap and chained lookups disagree\n");
+	}
+
+	free(keys);
+	free(probes);
+	free(misses);
+	free(chain.heads);
+	free(chain.nodes);
+}
+
+#ifndef BENCH_CMAP_KEYS
+#define BENCH_CMAP_KEYS (1 << 18)
+#endif
+
+#ifndef BENCH_CMAP_OPS
+#define BENCH_CMAP_OPS 4000000
+#endif
+
+// Baseline, the single threaded hashmap behind a reader writer lock
+struct bench_locked_map {
+	struct hashmap map;
+#ifdef _SDX_WINDOWS
+	SRWLOCK lock;
+#else
+	pthread_rwlock_t lock;
+#endif
+};
+
+struct bench_cmap_job {
+	struct cmap *cmap;
+	struct bench_locked_map *locked;
+	size_t ops;
+	int write_per_mille;
+	uint64 rng;
+	uint64 found;
+};
+
+static int bench_locked_get(struct bench_locked_map *m, uint64 key, uint64 *value)
+{
+	uint64 *v;
+#ifdef _SDX_WINDOWS
+	AcquireSRWLockShared(&m->lock);
+#else
+	pthread_rwlock_rdlock(&m->lock);
+#endif
+	v = hashmap_get(&m->map, &key);
+	if (v)
+		*value = *v;
+#ifdef _SDX_WINDOWS
+	ReleaseSRWLockShared(&m->lock);
+#else
+	pthread_rwlock_unlock(&m->lock);
+#endif
+	return v != NULL;
+}
+
+static void bench_locked_write(struct bench_locked_map *m, uint64 key, int put)
+{
+#ifdef _SDX_WINDOWS
+	AcquireSRWLockExclusive(&m->lock);
+#else
+	pthread_rwlock_wrlock(&m->lock);
+#endif
+	if (put)
+		hashmap_put(&m->map, &key, &key);
+	else
+		hashmap_remove(&m->map, &key);
+#ifdef _SDX_WINDOWS
+	ReleaseSRWLockExclusive(&m->lock);
+#else
+	pthread_rwlock_unlock(&m->lock);
+#endif
+}
+
+// Reads of random keys, writes put or remove keys of twice the range
+#ifdef _SDX_WINDOWS
+static DWORD WINAPI bench_cmap_worker(LPVOID arg)
+#else
+static void *bench_cmap_worker(void *arg)
+#endif
+{
+	struct bench_cmap_job *job = arg;
+	uint64 x = job->rng, value, found = 0;
+
+	for (size_t i = 0; i < job->ops; i++) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		uint64 key = (x >> 16) % (2 * BENCH_CMAP_KEYS);
+		if ((int)(x % 1000) < job->write_per_mille) {
+			if (job->cmap) {
+				if (x & 1024)
+					cmap_put(job->cmap, &key, &key);
+				else
+					cmap_remove(job->cmap, &key);
+			} else {
+				bench_locked_write(job->locked, key, x & 1024);
+			}
+		} else if (job->cmap) {
+			found += cmap_get(job->cmap, &key, &value);
+		} else {
+			found += bench_locked_get(job->locked, key, &value);
+		}
+	}
+	job->found = found;
+	return 0;
+}
+
+static void bench_cmap_run(const char *what, struct cmap *cmap, struct bench_locked_map *locked,
+			   int nthreads, int write_per_mille)
+{
+	struct bench_cmap_job jobs[64];
+#ifdef _SDX_WINDOWS
+	HANDLE threads[64];
+#else
+	pthread_t threads[64];
+#endif
+	char name[64];
+	hr_clock time;
+	int started = 0;
+
+	for (int t = 0; t < nthreads; t++)
+		jobs[t] = (struct bench_cmap_job){ cmap, locked, BENCH_CMAP_OPS / nthreads, write_per_mille,
+						   0x9e3779b97f4a7c15ull * (t + 1), 0 };
+
+	start_clock(&time);
+	for (; started < nthreads; started++) {
+#ifdef _SDX_WINDOWS
+		threads[started] = CreateThread(NULL, 0, bench_cmap_worker, &jobs[started], 0, NULL);
+		if (!threads[started])
+			break;
+#else
+		if (pthread_create(&threads[started], NULL, bench_cmap_worker, &jobs[started]) != 0)
+			break;
+#endif
+	}
+	for (int t = started; t < nthreads; t++)
+		bench_cmap_worker(&jobs[t]);
+	for (int t = 0; t < started; t++) {
+#ifdef _SDX_WINDOWS
+		WaitForSingleObject(threads[t], INFINITE);
+		CloseHandle(threads[t]);
+#else
+		pthread_join(threads[t], NULL);
+#endif
+	}
+	end_clock(&time);
+
+	snprintf(name, sizeof(name), "%s, %d thr, %.1f%% writes", what, nthreads, write_per_mille / 10.0);
+	bench_report(name, &time, (double)(BENCH_CMAP_OPS / nthreads) * nthreads, 0);
+}
+
+// Inserts into an empty map, then again timing every insert on its own
+// for the slowest one
+static void bench_cmap_grow(const char *name, int concurrent)
+{
+	size_t count = 4 * BENCH_CMAP_KEYS;
+	double slowest = 0;
+	struct cmap cmap;
+	struct hashmap map;
+	hr_clock time;
+
+	for (int pass = 0; pass < 2; pass++) {
+		if (concurrent)
+			cmap_init(&cmap, sizeof(uint64), sizeof(uint64), 0);
+		else
+			hashmap_init(&map, sizeof(uint64), sizeof(uint64));
+		start_clock(&time);
+		for (uint64 key = 0; key < count; key++) {
+			double t0 = pass ? get_wall_time() : 0;
+			if (concurrent)
+				cmap_put(&cmap, &key, &key);
+			else
+				hashmap_put(&map, &key, &key);
+			if (pass)
+				slowest = MAX(slowest, get_wall_time() - t0);
+		}
+		end_clock(&time);
+		if (!pass)
+			bench_report(name, &time, count, 0);
+		if (concurrent)
+			cmap_free(&cmap);
+		else
+			hashmap_free(&map);
+	}
+	printf("%-40s %8.1f us\n", concurrent ? "slowest cmap_put" : "slowest hashmap_put", slowest * 1e6);
+}
+
+// Aggregate throughput of mixed reads and writes against the same
+// hashmap behind a reader writer lock, then growing from empty with
+// readers running
+void bench_concurrent_map(void)
+{
+	static const int writes[] = { 0, 10, 100, 500 };
+	int cores = MIN(sys_get_num_cpu_core_avail(), 64);
+	printf("-------------------------------------------\n");
+	printf("concurrent_map: %d keys, %d ops, up to %d threads\n", BENCH_CMAP_KEYS, BENCH_CMAP_OPS, cores);
+
+	struct cmap cmap;
+	struct bench_locked_map locked;
+	cmap_init(&cmap, sizeof(uint64), sizeof(uint64), BENCH_CMAP_KEYS);
+	hashmap_init(&locked.map, sizeof(uint64), sizeof(uint64));
+	hashmap_reserve(&locked.map, 2 * BENCH_CMAP_KEYS);
+#ifdef _SDX_WINDOWS
+	InitializeSRWLock(&locked.lock);
+#else
+	pthread_rwlock_init(&locked.lock, NULL);
+#endif
+	for (uint64 key = 0; key < BENCH_CMAP_KEYS; key++) {
+		cmap_put(&cmap, &key, &key);
+		hashmap_put(&locked.map, &key, &key);
+	}
+
+	for (int threads = 1;; threads = MIN(threads * 2, cores)) {
+		for (size_t w = 0; w < ARRAY_SIZE(writes); w++) {
+			bench_cmap_run("cmap", &cmap, NULL, threads, writes[w]);
+			bench_cmap_run("rwlock hashmap", NULL, &locked, threads, writes[w]);
+		}
+		if (threads == cores)
+			break;
+	}
+	cmap_free(&cmap);
+	hashmap_free(&locked.map);
+#ifndef _SDX_WINDOWS
+	pthread_rwlock_destroy(&locked.lock);
+#endif
+
+	// Every write moves buckets while growing, there is no pause where
+	// a single insert rehashes the whole table
+	bench_cmap_grow("cmap_put growing from empty", 1);
+	bench_cmap_grow("hashmap_put growing from empty", 0);
+}
+
+struct bench_entry {
+	const char *name;
+	void (*function)(void);
+};
+
+static struct bench_entry benchmarks[] = {
+	{ "intern", bench_intern },
+	{ "sort", bench_sort },
+	{ "map", bench_map },
+	{ "front_coding", bench_front_coding },
+	{ "split", bench_split },
+	{ "find", bench_find },
+	{ "number", bench_number },
+	{ "hash", bench_hash },
+	{ "utf8", bench_utf8 },
+	{ "multi_pattern", bench_multi_pattern },
+	{ "string_builder", bench_string_builder },
+	{ "fmt", bench_fmt },
+	{ "skip", bench_skip },
+	{ "line_index", bench_line_index },
+	{ "csv", bench_csv },
+	{ "json", bench_json },
+	{ "glob", bench_glob },
+	{ "encoding", bench_encoding },
+	{ "hashmap", bench_hashmap },
+	{ "concurrent_map", bench_concurrent_map },
+};
+
+int main(int argc, char **argv)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(benchmarks); i++) {
+		int run = argc < 2;
+		for (int j = 1; j < argc; j++)
+			if (strcmp(argv[j], benchmarks[i].name) == 0)
+				run = 1;
+
+		if (run)
+			benchmarks[i].function();
+	}
+
+	return 0;
+}
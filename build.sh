@@ -1,2 +1,2 @@
 #!/bin/sh
-gcc -g3 -std=gnu11 -DLOG_DISABLE_ERROR_STRING -DLOG_RELEASE -Iinclude/ src/mem_debug.c src/arena.c src/array.c src/log.c src/strvec.c src/string_view.c src/filesystem.c src/system.c tests.c -o a
+gcc -g3 -std=gnu11 -DLOG_DISABLE_ERROR_STRING -DLOG_RELEASE -Iinclude/ src/mem_debug.c src/arena.c src/array.c src/log.c src/strvec.c src/intern.c src/string_view.c src/string_operations.c src/number.c src/hash.c src/multi_pattern.c src/string_builder.c src/fmt.c src/line_index.c src/csv.c src/json.c src/glob_pattern.c src/encoding.c src/hashmap.c src/concurrent_map.c src/filesystem.c src/system.c tests.c -o a
@@ -1,4 +1,4 @@
 #!/bin/sh
 
 # Build and run the example program
-gcc -g3 example.c -o a && ./a
+gcc -g3 -I../../../include example.c ../../../src/strvec.c ../../../src/array.c ../../../src/string_view.c -o a && ./a
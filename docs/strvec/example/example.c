@@ -1,21 +1,28 @@
-#define STRVEC_IMPLEMENTATION
-#include "../../../strvec.h"
+#include "strvec.h"
 #include <stdio.h>
 
 int main()
 {
-	strvec arr;
+	struct strvec arr;
 	strvec_init(&arr);
 	strvec_push(&arr, "test1");
 	strvec_push(&arr, "string1");
 	strvec_push(&arr, "hellostring");
 	strvec_push(&arr, "kappa");
+
+	string_view sv = strvec_get_sv(&arr, 1);
+	printf("length of " SV_Fmt ": %zu\n", SV_Arg(sv), sv.len);
 	strvec_clear(&arr, 2);
 	printf("%s\n", strvec_get(&arr, 0));
 	printf("%s\n", strvec_get(&arr, 1));
-	printf("%s\n", strvec_get(&arr, 2));
+	printf("%p\n", strvec_get(&arr, 2)); /* cleared, NULL */
 	printf("%s\n", strvec_get(&arr, 3));
 
+	/* "hellostring" fits into the cleared space */
+	strvec_push(&arr, "short");
+	printf("fragmentation: %f\n", strvec_fragmentation(&arr));
+	strvec_compact(&arr);
+
 	/* This is how you should NOT use the next function,
 	*  the os will clear the memory after you exit the
 	*  program so calling free() is unnecesarry unless
@@ -49,6 +49,7 @@ struct array {
 int array_init(struct array *array, size_t size, size_t num_alloc);
 int array_push(struct array *array, void *data);
 void *array_alloc(struct array *array);
+int array_reserve(struct array *array, size_t count);
 int array_free_item(struct array *array, size_t index);
 void *array_get(struct array *array, size_t index);
 void array_replace_item(struct array *array, size_t index, void *data);
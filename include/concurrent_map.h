@@ -0,0 +1,85 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CONCURRENT_MAP_H
+#define CONCURRENT_MAP_H
+
+// Hash map shared between threads, made for tables that are read far
+// more often than they change. Keys and values are fixed size bytes
+// like in hashmap.h, string keys can go through intern.h first.
+//
+// Every bucket holds CMAP_BUCKET_SLOTS entries, a chain of overflow
+// buckets when it runs full and a version counter that is odd while a
+// writer owns the bucket. Writers take the bucket by bumping the
+// version, so writers on different buckets never wait on each other.
+// Readers take no lock and write nothing: they copy the entry out and
+// retry if the version changed meanwhile (a seqlock).
+//
+// Growth does not stop the world. A writer that sees the table over
+// its load hangs a table twice the size behind it, and from then on
+// every write moves a few buckets over until all are moved, then the
+// new table becomes the current one. Buckets are moved one at a time
+// under their own version, a moved bucket sends readers and writers on
+// to the next table. Readers may still be walking an old table after
+// the switch, so old tables are kept until cmap_free().
+//
+// cmap_init() and cmap_free() must not race with anything else, all
+// the other functions can be called from any number of threads.
+
+#include <stddef.h>
+#include "types.h"
+
+#define CMAP_BUCKET_SLOTS 6
+
+struct cmap_table {
+	unsigned char *buckets;
+	size_t mask;		// bucket count - 1
+	size_t cursor;		// next bucket to move, wraps around
+	size_t moved;		// buckets moved to next
+	struct cmap_table *next;	// set while growing
+	struct cmap_table *retired;	// older tables, kept for late readers
+};
+
+struct cmap {
+	struct cmap_table *table;
+	struct cmap_table *retired;
+	size_t key_size;
+	size_t value_size;
+	size_t value_offset;
+	size_t slot_size;
+	size_t bucket_size;
+	size_t count;
+	uint64 seed;
+};
+
+int cmap_init(struct cmap *map, size_t key_size, size_t value_size, size_t expected);
+void cmap_free(struct cmap *map);
+
+int cmap_get(struct cmap *map, const void *key, void *value);
+int cmap_put(struct cmap *map, const void *key, const void *value);
+int cmap_remove(struct cmap *map, const void *key);
+size_t cmap_count(struct cmap *map);
+
+#endif
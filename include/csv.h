@@ -0,0 +1,88 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CSV_H
+#define CSV_H
+
+// RFC 4180 CSV and TSV parsing into string views. Fields point into
+// the input, only quoted fields with doubled quotes ("") are copied
+// to be unescaped. Quotes, delimiters and newlines are found 64 bytes
+// at a time and the quoted regions come from a prefix xor of the quote
+// bits, so the bytes inside fields are never looked at one by one.
+//
+// Rows end at '\n', a '\r' right before it is dropped and empty lines
+// are skipped. Any quote switches between quoted and unquoted text, a
+// field starting with a quote has its outer quotes removed.
+//
+// Input can be parsed whole, into a table or row by row through a
+// callback, or fed in chunks of any size with csv_feed().
+
+#include <stddef.h>
+#include "types.h"
+#include "array.h"
+#include "string_view.h"
+#include "string_builder.h"
+
+#define CSV_PARALLEL_MIN_CHUNK (1 << 20)
+
+// A nonzero return stops the parse, fields are only valid during
+// the call
+typedef int (*csv_callback)(void *ctx, string_view *fields, size_t count);
+
+// Fields of the rows parsed so far, used by both the parser and table
+struct csv_rows {
+	struct array fields;		// string_view
+	struct array rows;		// size_t, first field of every row
+	struct array escaped;		// size_t, fields that live in unescaped
+	struct string_builder unescaped;
+};
+
+struct csv_parser {
+	char delim;
+	csv_callback callback;
+	void *ctx;
+	struct csv_rows rows;
+	struct string_builder carry;	// start of a row cut off by a chunk end
+	int stopped;
+};
+
+struct csv_table {
+	struct array fields;		// string_view, all rows back to back
+	struct array rows;		// size_t, first field of every row
+	struct array buffers;		// char *, unescaped fields
+};
+
+int csv_init(struct csv_parser *p, char delim, csv_callback callback, void *ctx);
+int csv_parse(struct csv_parser *p, string_view sv);
+int csv_feed(struct csv_parser *p, string_view chunk);
+int csv_finish(struct csv_parser *p);
+void csv_free(struct csv_parser *p);
+
+int csv_parse_table(struct csv_table *table, string_view sv, char delim, int nthreads);
+size_t csv_row_count(const struct csv_table *table);
+string_view *csv_row(const struct csv_table *table, size_t row, size_t *count);
+void csv_table_free(struct csv_table *table);
+
+#endif // CSV_H
@@ -0,0 +1,89 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ENCODING_H
+#define ENCODING_H
+
+// Base64 (RFC 4648, standard and URL safe alphabets) and hex codecs
+// over string views. Output goes into a caller buffer sized with the
+// *_len() functions or into an arena. Decoders are strict: no
+// whitespace, '=' only at the very end and unused trailing bits must
+// be zero, the offset of the first bad byte is reported. Padding is
+// optional when decoding. Hex decoding takes both cases, encoding
+// writes lower case.
+//
+// With SSSE3/AVX2 base64 goes 12/24 input bytes per iteration and hex
+// 8/16, the tail and anything invalid falls back to the table code,
+// which is also what finds the exact error offset.
+//
+// The stream functions take the input in chunks of any size, bytes
+// that do not make a full group yet are carried to the next call.
+// hex_encode() has no state, chunks are simply encoded one by one.
+
+#include <stddef.h>
+#include "types.h"
+#include "arena.h"
+#include "string_view.h"
+
+#define BASE64_URL 1		// '-' and '_' instead of '+' and '/'
+#define BASE64_NO_PAD 2		// the encoder leaves out the '='
+
+struct base64_stream {
+	int flags;
+	int done;		// decoding saw the padding, nothing may follow
+	unsigned char carry[4];
+	size_t carry_len;
+	size_t offset;		// input consumed before the carry
+};
+
+struct hex_stream {
+	char carry;
+	int has_carry;
+	size_t offset;
+};
+
+size_t base64_encoded_len(size_t len, int flags);
+size_t base64_decoded_max(size_t len);
+size_t base64_encode(char *out, string_view in, int flags);
+int base64_decode(char *out, string_view in, int flags, size_t *out_len, size_t *error_offset);
+int base64_encode_arena(struct arena *arena, string_view in, int flags, string_view *out);
+int base64_decode_arena(struct arena *arena, string_view in, int flags, string_view *out, size_t *error_offset);
+
+void base64_stream_init(struct base64_stream *s, int flags);
+size_t base64_encode_update(struct base64_stream *s, char *out, string_view in);
+size_t base64_encode_final(struct base64_stream *s, char *out);
+int base64_decode_update(struct base64_stream *s, char *out, string_view in, size_t *out_len, size_t *error_offset);
+int base64_decode_final(struct base64_stream *s, char *out, size_t *out_len, size_t *error_offset);
+
+size_t hex_encode(char *out, string_view in);
+int hex_decode(char *out, string_view in, size_t *out_len, size_t *error_offset);
+int hex_encode_arena(struct arena *arena, string_view in, string_view *out);
+int hex_decode_arena(struct arena *arena, string_view in, string_view *out, size_t *error_offset);
+
+void hex_stream_init(struct hex_stream *s);
+int hex_decode_update(struct hex_stream *s, char *out, string_view in, size_t *out_len, size_t *error_offset);
+int hex_decode_final(struct hex_stream *s, size_t *error_offset);
+
+#endif // ENCODING_H
@@ -58,6 +58,39 @@
 #define _SDX_MSVC
 #endif
 
+/* SIMD, selected at compile time (-msse2, -mavx2, -march=native...) */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _SDX_SSE2
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#define _SDX_SSSE3
+#endif
+
+#if defined(__AVX2__)
+#define _SDX_AVX2
+#endif
+
+#if defined(__PCLMUL__)
+#define _SDX_PCLMUL
+#endif
+
+/* Bit scan, x must not be 0 for CTZ and CLZ */
+#if defined(_SDX_GCC) || defined(_SDX_CLANG)
+#define CTZ32(x) __builtin_ctz(x)
+#define CTZ64(x) __builtin_ctzll(x)
+#define CLZ64(x) __builtin_clzll(x)
+#define POPCOUNT64(x) __builtin_popcountll(x)
+#elif defined(_SDX_MSVC)
+#include <intrin.h>
+static __forceinline int _sdx_ctz64(unsigned __int64 x) { unsigned long i; _BitScanForward64(&i, x); return (int)i; }
+static __forceinline int _sdx_clz64(unsigned __int64 x) { unsigned long i; _BitScanReverse64(&i, x); return 63 - (int)i; }
+#define CTZ32(x) _sdx_ctz64(x)
+#define CTZ64(x) _sdx_ctz64(x)
+#define CLZ64(x) _sdx_clz64(x)
+#define POPCOUNT64(x) ((int)__popcnt64(x))
+#endif
+
 /* Likely Unlikely */
 #if defined(_SDX_GCC) || defined(_SDX_CLANG)
 #define likely(x)       __builtin_expect(!!(x), 1)
@@ -111,15 +144,15 @@
 
 #include <errno.h>
 
-// Allocate and print a formatted string to returned buffer
+// Allocate and print a formatted string to returned buffer, this
+// formats twice, prefer string_builder.h when building bigger strings
 #ifndef xasprintf
 #define xasprintf(format, ...) ({					\
 	size_t needed = snprintf(NULL, 0, format, ##__VA_ARGS__) + 1; \
-	char *buffer = (char *)malloc(needed);		\
-	if (buffer == NULL)\
-		NULL; \
-	sprintf(buffer, format, ##__VA_ARGS__);		\
-	buffer;						\
+	char *buffer = (char *)malloc(needed);				\
+	if (buffer != NULL)						\
+		snprintf(buffer, needed, format, ##__VA_ARGS__);	\
+	buffer;								\
 })
 #endif
 
@@ -36,6 +36,7 @@
 
 #ifdef _SDX_UNIX
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
 #include <unistd.h>
@@ -80,6 +81,8 @@ enum fs_mode {
 };
 
 struct fs_file fs_file_read(char *path, enum fs_mode mode);
+struct fs_file fs_file_map(char *path);
+void fs_file_unmap(struct fs_file *file);
 int fs_file_write(char *path, void *data, size_t size, enum fs_mode mode);
 int fs_file_create(char *path);
 int fs_file_copy(char* source, char* dest);
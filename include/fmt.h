@@ -0,0 +1,53 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef FMT_H
+#define FMT_H
+
+// Number to text conversion into caller supplied buffers. Nothing
+// is allocated, no locale is consulted and the output is not '\0'
+// terminated, every function returns the number of bytes written.
+// The buffer has to hold at least the matching FMT_*_MAX bytes.
+//
+// fmt_f64 writes the shortest decimal that reads back as the same
+// double (Ryu), in the same layout as JavaScript's Number.toString:
+// "0.001", "123.5", "1e+21", "1.5e-7". Infinities and NaN are written
+// as "inf", "-inf" and "nan" so sv_to_f64 reads them back.
+
+#include <stddef.h>
+#include "types.h"
+
+#define FMT_U64_MAX 20
+#define FMT_I64_MAX 20
+#define FMT_HEX64_MAX 16
+#define FMT_F64_MAX 25
+
+size_t fmt_u64(char *buf, uint64 value);
+size_t fmt_i64(char *buf, int64 value);
+size_t fmt_hex64(char *buf, uint64 value);
+size_t fmt_f64(char *buf, f64 value);
+int fmt_u64_len(uint64 value);
+
+#endif // FMT_H
@@ -0,0 +1,98 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GLOB_PATTERN_H
+#define GLOB_PATTERN_H
+
+// Compiled glob patterns: '*', '?', '[a-z]', '[!a-z]', '**' and '\'
+// escapes. With GLOB_PATHNAME '*', '?' and classes never match '/',
+// a '**' that is a whole path component matches across directories
+// and "**/" also matches nothing, so "src/**/*.c" matches "src/a.c".
+//
+// The literal prefix and suffix of a pattern are compared first, the
+// part between them runs as a bit parallel NFA, one bit per pattern
+// character and a few word operations per input byte, no backtracking.
+// Patterns without wildcards are plain compares and a middle made of a
+// single '*' is one memchr().
+//
+// A glob_set finds every pattern matching a path. One literal of each
+// pattern goes into a multi_pattern.h automaton, one pass over the path
+// picks the candidates and only those run their NFA.
+
+#include <stddef.h>
+#include "types.h"
+#include "array.h"
+#include "strvec.h"
+#include "string_view.h"
+#include "multi_pattern.h"
+
+#define GLOB_PATHNAME 1
+
+// Tokens between the literal prefix and suffix
+#define GLOB_MAX_TOKENS 512
+
+enum glob_kind {
+	GLOB_KIND_LITERAL,	// no wildcards
+	GLOB_KIND_STAR,		// prefix, '*' or '**', suffix
+	GLOB_KIND_NFA,
+};
+
+struct glob_pattern {
+	enum glob_kind kind;
+	int flags;
+	int globstar;		// GLOB_KIND_STAR: the star also matches '/'
+
+	char *literal;		// prefix then suffix, unescaped
+	size_t prefix_len;
+	size_t suffix_len;
+
+	// NFA of the middle, bit i set means the first i tokens matched
+	size_t tokens;
+	size_t words;		// uint64 per state set
+	uint8 classes[256];	// byte -> row
+	uint64 *rows;		// row * words, single byte tokens taking the byte
+	uint64 *loop;		// star tokens, they take any byte but '/'
+	uint64 *loop_slash;	// star tokens that also take '/'
+	uint64 *skip;		// "**/" pairs, entering one may jump over it
+	uint64 *start;		// states before the first byte
+};
+
+struct glob_set {
+	struct glob_pattern *patterns;
+	size_t count;
+	struct mp_matcher literals;	// pattern i -> one of its literals
+	struct array unfiltered;	// size_t, patterns without a literal
+};
+
+int glob_compile(struct glob_pattern *glob, string_view pattern, int flags);
+int glob_match(const struct glob_pattern *glob, string_view path);
+void glob_free(struct glob_pattern *glob);
+
+int glob_set_build(struct glob_set *set, struct strvec *patterns, int flags);
+int glob_set_matches(const struct glob_set *set, string_view path, struct array *out);
+int glob_set_any(const struct glob_set *set, string_view path);
+void glob_set_free(struct glob_set *set);
+
+#endif // GLOB_PATTERN_H
@@ -0,0 +1,63 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef HASH_H
+#define HASH_H
+
+// 64 bit seedable hashing for bytes and string views. Keys up to
+// HASH_SHORT_MAX bytes go through a wyhash style mix, longer keys are
+// consumed in 64 byte stripes by 8 independent lanes (xxh3 style) that
+// are vectorized with SSE2/AVX2. The streaming interface gives the same
+// result as hash64() on the concatenated input.
+//
+// Not a cryptographic hash. Use a random seed when the keys come from
+// an untrusted source.
+
+#include <stddef.h>
+#include "types.h"
+#include "string_view.h"
+
+#define HASH_SHORT_MAX 256
+#define HASH_STRIPE_LEN 64
+#define HASH_SECRET_LEN 192
+
+struct hash_state {
+	uint64 acc[8];
+	unsigned char secret[HASH_SECRET_LEN];	// derived from the seed
+	unsigned char buffer[HASH_SHORT_MAX];
+	size_t buffered;
+	size_t stripes;				// stripes since the last scramble
+	uint64 total_len;
+	uint64 seed;
+};
+
+uint64 hash64(const void *data, size_t len, uint64 seed);
+uint64 sv_hash64(string_view sv, uint64 seed);
+
+void hash_init(struct hash_state *state, uint64 seed);
+void hash_update(struct hash_state *state, const void *data, size_t len);
+uint64 hash_final(const struct hash_state *state);
+
+#endif // HASH_H
@@ -0,0 +1,154 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+// Open addressing hash map with one control byte per slot, in the
+// style of SwissTable/F14. Slots come in groups of 16 and a control
+// byte is either HASHMAP_EMPTY or the top 7 bits of the key hash, so
+// a lookup compares a whole group against the tag with one SSE2
+// compare and only touches keys whose tag matched.
+//
+// Groups are probed triangularly starting at the one picked by the low
+// hash bits. There are no tombstones: every group counts the keys that
+// passed it because it was full when they were inserted, a lookup
+// stops at the first group with a zero count, and removing a key just
+// empties its slot and takes one off the counts along its probe path.
+// Counts saturate at 255 and then stay there until the next rehash.
+//
+// Key and value sizes are set at runtime like struct array. Keys are
+// hashed and compared as bytes, so key types must not have padding.
+// Maps made with hashmap_init_sv() store string_view keys and hash and
+// compare the viewed bytes, the bytes are not copied and have to
+// outlive the map. Value pointers are valid until the next insert.
+//
+// The map grows at 7/8 load. Iteration goes in slot order, removing
+// the current entry while iterating is allowed.
+
+#include <stddef.h>
+#include "types.h"
+#include "string_view.h"
+
+#define HASHMAP_GROUP 16
+#define HASHMAP_EMPTY 0x80
+
+struct hashmap {
+	unsigned char *ctrl;	// one byte per slot
+	unsigned char *overflow;	// one count per group
+	unsigned char *slots;	// key, then value at value_offset
+	size_t key_size;
+	size_t value_size;
+	size_t value_offset;
+	size_t slot_size;
+	size_t group_mask;	// group count - 1, groups are a power of 2
+	size_t count;
+	size_t growth_left;	// inserts before the next rehash
+	uint64 seed;		// change before the first insert
+	int sv_keys;
+};
+
+int hashmap_init(struct hashmap *map, size_t key_size, size_t value_size);
+int hashmap_init_sv(struct hashmap *map, size_t value_size);
+void hashmap_free(struct hashmap *map);
+void hashmap_clear(struct hashmap *map);
+int hashmap_reserve(struct hashmap *map, size_t count);
+size_t hashmap_capacity(const struct hashmap *map);
+
+void *hashmap_get(const struct hashmap *map, const void *key);
+void *hashmap_insert(struct hashmap *map, const void *key, int *inserted);
+void *hashmap_put(struct hashmap *map, const void *key, const void *value);
+int hashmap_remove(struct hashmap *map, const void *key);
+int hashmap_next(const struct hashmap *map, size_t *iter, void **key, void **value);
+
+static inline size_t hashmap_count(const struct hashmap *map)
+{
+	return map->count;
+}
+
+static inline void *hashmap_get_sv(const struct hashmap *map, string_view key)
+{
+	return hashmap_get(map, &key);
+}
+
+static inline void *hashmap_put_sv(struct hashmap *map, string_view key, const void *value)
+{
+	return hashmap_put(map, &key, value);
+}
+
+static inline int hashmap_remove_sv(struct hashmap *map, string_view key)
+{
+	return hashmap_remove(map, &key);
+}
+
+/*
+ * Typed front end, HASHMAP_DEFINE(u64map, uint64, double) gives
+ * struct u64map and u64map_init(), u64map_get(), u64map_put(),
+ * u64map_remove(), u64map_next() and u64map_free() taking keys and
+ * values by value. HASHMAP_DEFINE_SV(name, V) does the same for
+ * string_view keys.
+ */
+#define HASHMAP_DEFINE_COMMON(name, K, V)				\
+	struct name { struct hashmap map; };				\
+	static inline V *name##_get(const struct name *m, K key)	\
+	{								\
+		return (V *)hashmap_get(&m->map, &key);			\
+	}								\
+	static inline V *name##_put(struct name *m, K key, V value)	\
+	{								\
+		return (V *)hashmap_put(&m->map, &key, &value);		\
+	}								\
+	static inline int name##_remove(struct name *m, K key)		\
+	{								\
+		return hashmap_remove(&m->map, &key);			\
+	}								\
+	static inline int name##_next(const struct name *m, size_t *iter, K **key, V **value) \
+	{								\
+		return hashmap_next(&m->map, iter, (void **)key, (void **)value); \
+	}								\
+	static inline size_t name##_count(const struct name *m)	\
+	{								\
+		return m->map.count;					\
+	}								\
+	static inline void name##_free(struct name *m)			\
+	{								\
+		hashmap_free(&m->map);					\
+	}
+
+#define HASHMAP_DEFINE(name, K, V)					\
+	HASHMAP_DEFINE_COMMON(name, K, V)				\
+	static inline int name##_init(struct name *m)			\
+	{								\
+		return hashmap_init(&m->map, sizeof(K), sizeof(V));	\
+	}
+
+#define HASHMAP_DEFINE_SV(name, V)					\
+	HASHMAP_DEFINE_COMMON(name, string_view, V)			\
+	static inline int name##_init(struct name *m)			\
+	{								\
+		return hashmap_init_sv(&m->map, sizeof(V));		\
+	}
+
+#endif
@@ -0,0 +1,65 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INTERN_H
+#define INTERN_H
+
+// String interner built on top of strvec, every distinct string is
+// stored once and gets a 32 bit id. Two interned strings are equal
+// only if their ids are equal so comparing them is an integer compare.
+// Lookups go through an open addressing table (linear probing) that
+// keeps the hash next to the id, the string bytes are only touched
+// when the hashes match.
+
+#include <stddef.h>
+#include "types.h"
+#include "array.h"
+#include "strvec.h"
+#include "string_view.h"
+
+struct intern_slot {
+	uint32 hash;
+	uint32 id;	// id + 1, 0 means the slot is empty
+};
+
+struct intern {
+	struct strvec strings;
+	struct array hashes;		// uint32 hash of every id, used when growing
+	struct intern_slot *slots;
+	size_t cap;			// number of slots, always a power of 2
+};
+
+#define INTERN_INITIAL_CAP 64
+#define INTERN_INVALID_ID ((uint32)-1)
+
+int intern_init(struct intern *in);
+uint32 intern(struct intern *in, string_view sv);
+uint32 intern_find(struct intern *in, string_view sv);
+string_view intern_get(struct intern *in, uint32 id);
+size_t intern_count(struct intern *in);
+size_t intern_memory(struct intern *in);
+void intern_free(struct intern *in);
+
+#endif // INTERN_H
@@ -0,0 +1,103 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef JSON_H
+#define JSON_H
+
+// JSON reader over string views. The first stage finds the structural
+// characters ({}[]:, quotes and the starts of numbers and literals) 64
+// bytes at a time, with string contents and escaped quotes masked out.
+// The second stage checks the grammar and writes a flat tape of nodes
+// into an arena, every container records where it ends so whole
+// subtrees are skipped in one step while navigating.
+//
+// Nothing is converted up front: strings and numbers stay views into
+// the input until json_string(), json_f64() and friends are called.
+// The input has to outlive the document and be smaller than 4 GiB.
+
+#include <stddef.h>
+#include "types.h"
+#include "arena.h"
+#include "string_view.h"
+
+#define JSON_MAX_DEPTH 1024
+#define JSON_NONE UINT32_MAX
+
+enum json_type {
+	JSON_INVALID,
+	JSON_NULL,
+	JSON_FALSE,
+	JSON_TRUE,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT,
+};
+
+struct json_node {
+	uint32 type;
+	uint32 offset;	// in the input, strings start after the quote
+	uint32 len;	// bytes of scalars, children of arrays and objects
+	uint32 end;	// node after the last one inside this one
+};
+
+struct json_doc {
+	string_view input;
+	struct json_node *nodes;	// in the arena given to json_parse
+	uint32 count;
+	const char *error;		// NULL on success
+	size_t error_offset;
+};
+
+typedef struct {
+	const struct json_doc *doc;
+	uint32 index;			// JSON_NONE for missing values
+} json_value;
+
+// Walks arrays and objects, for arrays key is left invalid
+struct json_iter {
+	const struct json_doc *doc;
+	uint32 index;
+	uint32 end;
+	int object;
+};
+
+int json_parse(struct json_doc *doc, struct arena *arena, string_view input);
+json_value json_root(const struct json_doc *doc);
+enum json_type json_type(json_value v);
+size_t json_len(json_value v);
+string_view json_raw(json_value v);
+json_value json_get(json_value object, string_view key);
+json_value json_at(json_value array, size_t i);
+struct json_iter json_iter(json_value container);
+int json_iter_next(struct json_iter *it, json_value *key, json_value *value);
+
+int json_string(json_value v, struct arena *arena, string_view *out);
+int json_f64(json_value v, f64 *out);
+int json_i64(json_value v, int64 *out);
+int json_u64(json_value v, uint64 *out);
+int json_bool(json_value v, int *out);
+
+#endif // JSON_H
@@ -0,0 +1,60 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+// Random access to the lines of a big buffer, like a file read with
+// fs_file_read() or mapped with fs_file_map(). Building the index
+// counts the newlines 64 bytes at a time, optionally on several
+// threads, and keeps the start of every stride-th line, so the index
+// takes 8 bytes per stride lines. A query jumps to the closest kept
+// line and rescans at most stride - 1 lines from there.
+//
+// Lines are separated by '\n', a newline at the very end does not
+// start another line and '\r' is left in the line.
+
+#include <stddef.h>
+#include "types.h"
+#include "array.h"
+#include "string_view.h"
+
+#define LINE_INDEX_DEFAULT_STRIDE 64
+#define LINE_INDEX_PARALLEL_MIN_CHUNK (1 << 20)
+
+struct line_index {
+	string_view sv;		// the indexed buffer, not owned
+	size_t line_count;
+	size_t stride;
+	struct array offsets;	// uint64, start of line i * stride
+};
+
+int line_index_build(struct line_index *li, string_view sv, size_t stride, int nthreads);
+size_t line_count(const struct line_index *li);
+string_view line_at(const struct line_index *li, size_t line);
+size_t line_of_offset(const struct line_index *li, size_t offset);
+void line_index_free(struct line_index *li);
+
+#endif // LINE_INDEX_H
@@ -0,0 +1,72 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef MULTI_PATTERN_H
+#define MULTI_PATTERN_H
+
+// Multi-pattern search (Aho-Corasick). The patterns are compiled once
+// into a DFA and mp_scan() finds every occurrence of every pattern in
+// one pass over the text, one table lookup per byte however many
+// patterns there are.
+//
+// Bytes that do not appear in any pattern share one column of the
+// transition table, so its width is the number of distinct pattern
+// bytes + 1 instead of 256. Transitions into states that end a pattern
+// have MP_MATCH_BIT set, the scan loop only leaves the fast path there.
+
+#include <stddef.h>
+#include "types.h"
+#include "strvec.h"
+#include "string_view.h"
+
+#define MP_MATCH_BIT 0x80000000u
+#define MP_NONE ((uint32)-1)
+
+struct mp_matcher {
+	uint32 *table;			// state * class_count + class -> next state * class_count (| MP_MATCH_BIT)
+	uint16 classes[256];		// byte -> column of the table
+	size_t class_count;
+	size_t state_count;
+
+	uint32 *state_pattern;		// first pattern ending in the state + 1, 0 if none
+	uint32 *state_output;		// nearest suffix state that ends a pattern, MP_NONE if none
+	uint32 *pattern_next;		// next pattern + 1 ending in the same state (duplicates)
+	size_t *pattern_len;
+	size_t pattern_count;
+};
+
+/*
+ * Called for every match, pattern is the index in the strvec given to
+ * mp_build() and offset is where the match starts in the text. Return
+ * 0 to keep scanning, anything else stops mp_scan().
+ */
+typedef int (*mp_callback)(void *ctx, size_t pattern, size_t offset);
+
+int mp_build(struct mp_matcher *matcher, struct strvec *patterns);
+size_t mp_scan(const struct mp_matcher *matcher, string_view sv, mp_callback callback, void *ctx);
+size_t mp_memory(const struct mp_matcher *matcher);
+void mp_free(struct mp_matcher *matcher);
+
+#endif // MULTI_PATTERN_H
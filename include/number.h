@@ -0,0 +1,44 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef NUMBER_H
+#define NUMBER_H
+
+// Number parsing straight from a string_view, the view does not have to
+// be NUL terminated. Every function parses the longest number at the
+// start of the view and returns the number of bytes consumed, 0 means
+// that there is no number or that it does not fit in the result type.
+// No leading whitespace is skipped.
+
+#include <stddef.h>
+#include "types.h"
+#include "string_view.h"
+
+size_t sv_to_u64(string_view sv, uint64 *out);
+size_t sv_to_i64(string_view sv, int64 *out);
+size_t sv_to_hex(string_view sv, uint64 *out);
+size_t sv_to_f64(string_view sv, f64 *out);
+
+#endif // NUMBER_H
@@ -0,0 +1,77 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef STRING_BUILDER_H
+#define STRING_BUILDER_H
+
+// Growable string buffer for assembling text from many fragments.
+// The buffer is either malloc'd and kept across sb_reset() so it can
+// be reused for the next string, or allocated from an arena so
+// everything is released with the arena. The content is always '\0'
+// terminated and sb_to_sv() hands it out without copying.
+//
+// Appends return 1 on success and 0 if the buffer could not grow,
+// after a failure the builder stays failed until sb_reset().
+
+#include <stddef.h>
+#include <stdarg.h>
+#include "types.h"
+#include "arena.h"
+#include "string_view.h"
+
+#define SB_INITIAL_CAP 256
+
+struct string_builder {
+	char *data;
+	size_t len;
+	size_t cap;		// bytes in data, including the '\0'
+	struct arena *arena;	// NULL when data is malloc'd
+	int failed;
+};
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SB_PRINTF_FORMAT(fmt, args) __attribute__((format(printf, fmt, args)))
+#else
+#define SB_PRINTF_FORMAT(fmt, args)
+#endif
+
+int sb_init(struct string_builder *sb, size_t cap);
+int sb_init_arena(struct string_builder *sb, struct arena *arena, size_t cap);
+int sb_reserve(struct string_builder *sb, size_t extra);
+int sb_append_char(struct string_builder *sb, char c);
+int sb_append(struct string_builder *sb, const char *data, size_t len);
+int sb_append_sv(struct string_builder *sb, string_view sv);
+int sb_append_cstr(struct string_builder *sb, const char *str);
+int sb_append_u64(struct string_builder *sb, uint64 value);
+int sb_append_i64(struct string_builder *sb, int64 value);
+int sb_append_hex64(struct string_builder *sb, uint64 value);
+int sb_append_f64(struct string_builder *sb, f64 value);
+int sb_appendf(struct string_builder *sb, const char *format, ...) SB_PRINTF_FORMAT(2, 3);
+int sb_vappendf(struct string_builder *sb, const char *format, va_list args);
+string_view sb_to_sv(struct string_builder *sb);
+void sb_reset(struct string_builder *sb);
+void sb_free(struct string_builder *sb);
+
+#endif // STRING_BUILDER_H
@@ -28,12 +28,23 @@
 
 #include <stddef.h>
 
+struct arena;
+
 char *so_skip_whitespace(char *in);
 char *so_skip_untill_whitespace(char *in);
 char *so_skip_untill_next_word(char *in);
 char *so_skip_untill_x_char(char *in, char x);
 char *so_get_substring(char *ptr, size_t size);
+char *so_get_substring_arena(struct arena *ar, char *ptr, size_t size);
 void so_get_substring_dest(char *ptr, size_t size, char *dest);
 char *so_skip_to_nextline(char *in);
 
+// Same as above but never read at or past end, end is returned when
+// the scan runs out of input
+char *so_skip_whitespace_bounded(char *in, char *end);
+char *so_skip_untill_whitespace_bounded(char *in, char *end);
+char *so_skip_untill_next_word_bounded(char *in, char *end);
+char *so_skip_untill_x_char_bounded(char *in, char *end, char x);
+char *so_skip_to_nextline_bounded(char *in, char *end);
+
 #endif
@@ -29,20 +29,51 @@
 #include <stddef.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 
 #ifndef SV_DEF
 #define SV_DEF
 #endif
 
+struct array;
+
+// Inputs smaller than this per thread are not worth splitting in parallel
+#define SV_SPLIT_PARALLEL_MIN_CHUNK (1 << 20)
+
 typedef struct {
 	char *data;
 	size_t len;
 } string_view;
 
+/*
+ * Set of bytes, a 256 bit membership table laid out so that it can be
+ * used as two pshufb lookup tables. Byte c is in the set if bit
+ * (c >> 4) & 7 of low[c & 15] (c < 0x80) or high[c & 15] (c >= 0x80)
+ * is set.
+ */
+typedef struct {
+	unsigned char low[16];
+	unsigned char high[16];
+} sv_charset;
+
+// " \t\n\v\f\r", same as isspace() in the C locale
+#define SV_CHARSET_WHITESPACE { { 0x04, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x01, 0x01, 0x01, 0x01, 0, 0 }, { 0 } }
+// " \t\n\r", the whitespace of string_operations.h
+#define SV_CHARSET_SPACE_TAB_NEWLINE { { 0x04, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x01, 0, 0, 0x01, 0, 0 }, { 0 } }
+
 SV_DEF string_view sv_from_parts(char *data, size_t len);
 SV_DEF string_view sv_from_cstr(char *data);
 SV_DEF int sv_eq(string_view a, string_view b);
+SV_DEF int sv_eq_icase(string_view a, string_view b);
+SV_DEF int sv_cmp(string_view a, string_view b);
+SV_DEF int sv_compare(const void *a, const void *b);
+SV_DEF int sv_starts_with_icase(string_view sv, string_view prefix);
+SV_DEF void sv_to_lower(string_view sv);
+SV_DEF void sv_to_upper(string_view sv);
+SV_DEF size_t sv_index_of(string_view sv, char c);
+SV_DEF size_t sv_find(string_view haystack, string_view needle);
 SV_DEF string_view sv_chop_by_delim(string_view *sv, char delim);
+SV_DEF int sv_try_chop_by_delim(string_view *sv, char delim, string_view *dest);
 SV_DEF string_view sv_chop_by_delim_and_trim(string_view *sv, char delim);
 SV_DEF string_view sv_chop_left(string_view *sv, size_t n);
 SV_DEF string_view sv_chop_right(string_view *sv, size_t n);
@@ -54,6 +85,31 @@ SV_DEF string_view sv_trim_by_delim(string_view *sv, char delim); /* Use delim a
 SV_DEF string_view sv_trim_by_sv(string_view *sv, string_view delim); /* Return trimemd part, advance pointer to last index */
 SV_DEF string_view sv_next_line(string_view sv);
 
+SV_DEF sv_charset sv_charset_from_parts(const char *chars, size_t len);
+SV_DEF sv_charset sv_charset_from_cstr(const char *chars);
+SV_DEF void sv_charset_add(sv_charset *cs, unsigned char c);
+SV_DEF size_t sv_span(string_view sv, const sv_charset *cs);
+SV_DEF size_t sv_cspan(string_view sv, const sv_charset *cs);
+SV_DEF string_view sv_chop_by_any(string_view *sv, const sv_charset *cs);
+SV_DEF string_view sv_trim_left_any(string_view sv, const sv_charset *cs);
+SV_DEF string_view sv_trim_right_any(string_view sv, const sv_charset *cs);
+SV_DEF string_view sv_trim_any(string_view sv, const sv_charset *cs);
+
+SV_DEF int sv_split_all(string_view sv, char delim, struct array *out);
+SV_DEF int sv_split_all_any(string_view sv, const sv_charset *cs, struct array *out);
+SV_DEF int sv_split_all_parallel(string_view sv, char delim, struct array *out, int nthreads);
+SV_DEF int sv_split_all_any_parallel(string_view sv, const sv_charset *cs, struct array *out, int nthreads);
+
+SV_DEF int sv_utf8_validate(string_view sv);
+SV_DEF size_t sv_utf8_count(string_view sv);
+SV_DEF int32_t sv_utf8_next(string_view *sv);
+
+static inline int sv_charset_has(const sv_charset *cs, unsigned char c)
+{
+	const unsigned char *table = c < 0x80 ? cs->low : cs->high;
+	return (table[c & 15] >> ((c >> 4) & 7)) & 1;
+}
+
 #define SV_Fmt "%.*s"
 #define SV_Arg(sv) (int) (sv).len, (sv).data
 
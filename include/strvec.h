@@ -30,25 +30,128 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
 #include <array.h>
+#include <string_view.h>
+
+// Every string is stored with a terminating '\0' so strvec_get()
+// can still be used as a C string, the length is kept next to the
+// offset so strvec_get_sv() never has to call strlen().
+struct strvec_entry {
+	size_t offset;
+	size_t len;
+};
+
+// Byte range left behind by strvec_clear(), kept in
+// free_ranges[] bucketed by the log2 of its size.
+struct strvec_free_range {
+	size_t offset;
+	size_t size;
+};
+
+#define STRVEC_FREE_BUCKETS 16
 
 struct strvec {
 	char *data;
-	struct array offsets;
+	struct array offsets; // struct strvec_entry
+	struct array free_ranges[STRVEC_FREE_BUCKETS]; // struct strvec_free_range
 
 	size_t data_cap;
 	size_t data_size;
+	size_t free_size; // bytes inside free_ranges
+
+	void *map_data;	// set by strvec_map(), the vector is read only
+	size_t map_size;
+};
+
+/*
+ * File layout used by strvec_save() and strvec_map():
+ *
+ * | header | entries (count * struct strvec_entry) | data (data_size bytes) |
+ *
+ * Entries and data are written as they are in memory, so a mapped
+ * file is used without parsing. Files are only portable between
+ * machines with the same word size and byte order.
+ */
+struct strvec_file_header {
+	char magic[8];
+	uint32_t version;
+	uint16_t word_size;
+	uint16_t byte_order;
+	uint64_t count;
+	uint64_t data_size;
 };
 
+/*
+ * Read only front coded copy of a sorted strvec. Strings are grouped
+ * into blocks of block_size, the first string of every block is
+ * stored whole and the rest as (shared prefix length, suffix) against
+ * the string before them. Lengths are LEB128 varints. Random access
+ * decodes at most block_size strings.
+ */
+struct strvec_fc {
+	unsigned char *data;
+	size_t data_size;
+	struct array blocks;	// size_t offset of every block in data
+	size_t count;
+	size_t block_size;
+};
+
+struct strvec_fc_iter {
+	struct strvec_fc *fc;
+	size_t index;	// index of the next string
+	size_t pos;	// position of the next string in data
+	char *buf;	// current string
+	size_t len;
+	size_t cap;
+};
+
+#define STRVEC_FC_DEFAULT_BLOCK_SIZE 16
+
+#define STRVEC_FILE_MAGIC "SDXSTRV"
+#define STRVEC_FILE_VERSION 1
+#define STRVEC_FILE_BYTE_ORDER 0x0102
+
 #define STRVEC_INITIAL_DATA_CAP 256
 #define STRVEC_INITIAL_STR_COUNT 16
+#define STRVEC_INITIAL_FREE_COUNT 4
 
+// Offset of an entry that has been removed with strvec_clear()
+#define STRVEC_REMOVED ((size_t)-1)
+
+/*
+ * Push functions return the index of the pushed string,
+ * on fail -1 is returned. Mapped vectors can not be modified
+ * except for strvec_sort(), which only touches private pages.
+ */
 
 int strvec_init(struct strvec *arr);
+int strvec_reserve(struct strvec *arr, size_t bytes, size_t count);
 int strvec_push(struct strvec *arr, char* str);
+int strvec_push_len(struct strvec *arr, char *str, size_t len);
+int strvec_push_sv(struct strvec *arr, string_view sv);
+int strvec_push_many(struct strvec *arr, string_view *svs, size_t count);
 int strvec_clear(struct strvec *arr, int index);
+int strvec_compact(struct strvec *arr);
+double strvec_fragmentation(struct strvec *arr);
 void strvec_delete_struct(struct strvec* arr);
 char *strvec_get(struct strvec *arr, int index);
+string_view strvec_get_sv(struct strvec *arr, int index);
+size_t strvec_count(struct strvec *arr);
+int strvec_sort(struct strvec *arr);
+size_t strvec_lower_bound(struct strvec *arr, string_view key);
+int strvec_bsearch(struct strvec *arr, string_view key);
+int strvec_save(struct strvec *arr, char *path);
+int strvec_map(struct strvec *arr, char *path);
+
+int strvec_fc_build(struct strvec_fc *fc, struct strvec *sorted, size_t block_size);
+size_t strvec_fc_get(struct strvec_fc *fc, size_t index, char *buf, size_t buf_size);
+size_t strvec_fc_lower_bound(struct strvec_fc *fc, string_view key);
+size_t strvec_fc_memory(struct strvec_fc *fc);
+void strvec_fc_free(struct strvec_fc *fc);
+int strvec_fc_iter_init(struct strvec_fc_iter *it, struct strvec_fc *fc, size_t index);
+int strvec_fc_next(struct strvec_fc_iter *it, string_view *out);
+void strvec_fc_iter_free(struct strvec_fc_iter *it);
 
 #endif /* STRVEC_H */
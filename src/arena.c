@@ -81,12 +81,12 @@ int arena_init(struct arena *ar)
 	return 1;
 }
 
-// @Todo: Add alignement for the next pushed memory
+// Aligned pushes start at the next multiple of sizeof(void*)
 void *arena_push_size(struct arena_entry *ar, size_t size, int should_align)
 {
-	int align_off = 0;
+	size_t align_off = 0;
 	if (should_align)
-		align_off = (size_t)(ar->data + size) % sizeof(void*) - 1;
+		align_off = (sizeof(void*) - (uintptr_t)(ar->data + ar->used) % sizeof(void*)) % sizeof(void*);
 
 	if (ar->cap < size + ar->used + align_off)
 		return NULL;
@@ -30,7 +30,8 @@ int array_init(struct array *array, size_t size, size_t num_alloc)
 	num_alloc = (num_alloc == 0) ? ARRAY_INITIAL_CAP : num_alloc;
 	array->index = 0;
 	array->itemsize = size;
-	if ((array->data = malloc(ARRAY_INITIAL_CAP)) == NULL)
+	array->cap = num_alloc * size;
+	if ((array->data = malloc(array->cap)) == NULL)
 		return 0;
 
 	return 1;
@@ -86,6 +87,27 @@ void *array_alloc(struct array *array)
 	return array->data + (array->index++ * array->itemsize);
 }
 
+// Make sure that at least count more items can be pushed
+// without any reallocation, useful before pushing items in bulk.
+int array_reserve(struct array *array, size_t count)
+{
+	size_t needed = (array->index + count) * array->itemsize + array->itemsize;
+	if (array->cap >= needed)
+		return 1;
+
+	size_t newcap = array->cap ? array->cap : array->itemsize;
+	while (newcap < needed)
+		newcap *= 2;
+
+	unsigned char *tmp = realloc(array->data, newcap);
+	if (tmp == NULL)
+		return 0;
+
+	array->cap = newcap;
+	array->data = tmp;
+	return 1;
+}
+
 void array_replace_item(struct array *array, size_t index, void *data)
 {
 	// Place the data to the specified index
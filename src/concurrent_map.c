@@ -0,0 +1,525 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "concurrent_map.h"
+#include "hash.h"
+#include "extra.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _SDX_WINDOWS
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+#if defined(_SDX_SSE2)
+#include <emmintrin.h>
+#endif
+
+#define CMAP_SEED 0x2545f4914f6cdd1dull
+#define CMAP_LOAD_FACTOR 4	// entries per bucket before growing
+#define CMAP_MOVE_STEP 4	// buckets every write moves while growing
+#define CMAP_MIN_BUCKETS 8
+
+// The slots follow the header, the overflow buckets only use tags and
+// overflow, the head bucket version covers the whole chain
+struct cmap_bucket {
+	uint32 version;		// odd while a writer owns the bucket
+	uint8 moved;		// entries are in the next table, never changes again
+	uint8 tags[CMAP_BUCKET_SLOTS];	// 0 for empty, 0x80 | top hash bits
+	struct cmap_bucket *overflow;
+};
+
+static size_t cmap_align(size_t size)
+{
+	if (size >= 8)
+		return 8;
+	if (size >= 4)
+		return 4;
+	if (size >= 2)
+		return 2;
+	return 1;
+}
+
+static inline struct cmap_bucket *cmap_bucket_at(const struct cmap *map, const struct cmap_table *table, size_t i)
+{
+	return (struct cmap_bucket *)(table->buckets + i * map->bucket_size);
+}
+
+static inline unsigned char *cmap_slot(const struct cmap *map, struct cmap_bucket *bucket, int i)
+{
+	return (unsigned char *)bucket + sizeof(struct cmap_bucket) + i * map->slot_size;
+}
+
+static inline uint8 cmap_tag(uint64 hash)
+{
+	return 0x80 | (uint8)(hash >> 57);
+}
+
+/*
+ * Readers look at slots while writers change them and only trust what
+ * they read once the version checks out. Both sides go through these
+ * atomic copies so that is not a data race in the C11 sense and TSan
+ * stays quiet, in the widest words the alignment allows. Acquire loads
+ * keep the version check after the reads, release stores keep the odd
+ * version ahead of the writes, on x86 both are plain moves.
+ */
+static void cmap_read(void *dst, const unsigned char *src, size_t len)
+{
+	unsigned char *d = dst;
+
+	while (len) {
+		if (len >= 8 && !((uintptr_t)src & 7)) {
+			uint64 w = __atomic_load_n((const uint64 *)src, __ATOMIC_ACQUIRE);
+			memcpy(d, &w, 8);
+			src += 8, d += 8, len -= 8;
+		} else if (len >= 4 && !((uintptr_t)src & 3)) {
+			uint32 w = __atomic_load_n((const uint32 *)src, __ATOMIC_ACQUIRE);
+			memcpy(d, &w, 4);
+			src += 4, d += 4, len -= 4;
+		} else {
+			*d++ = __atomic_load_n(src++, __ATOMIC_ACQUIRE);
+			len--;
+		}
+	}
+}
+
+static void cmap_write(unsigned char *dst, const void *src, size_t len)
+{
+	const unsigned char *s = src;
+
+	while (len) {
+		if (len >= 8 && !((uintptr_t)dst & 7)) {
+			uint64 w;
+			memcpy(&w, s, 8);
+			__atomic_store_n((uint64 *)dst, w, __ATOMIC_RELEASE);
+			dst += 8, s += 8, len -= 8;
+		} else if (len >= 4 && !((uintptr_t)dst & 3)) {
+			uint32 w;
+			memcpy(&w, s, 4);
+			__atomic_store_n((uint32 *)dst, w, __ATOMIC_RELEASE);
+			dst += 4, s += 4, len -= 4;
+		} else {
+			__atomic_store_n(dst++, *s++, __ATOMIC_RELEASE);
+			len--;
+		}
+	}
+}
+
+static int cmap_key_eq(const unsigned char *slot, const void *key, size_t len)
+{
+	const unsigned char *k = key;
+	unsigned char chunk[64];
+
+	while (len) {
+		size_t n = MIN(len, sizeof(chunk));
+		cmap_read(chunk, slot, n);
+		if (memcmp(chunk, k, n))
+			return 0;
+		slot += n, k += n, len -= n;
+	}
+	return 1;
+}
+
+// Spin a little, then give the time slice to whoever holds the bucket
+static void cmap_relax(unsigned spins)
+{
+	if (spins < 64) {
+#if defined(_SDX_SSE2)
+		_mm_pause();
+#endif
+		return;
+	}
+#ifdef _SDX_WINDOWS
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+static uint32 cmap_lock(struct cmap_bucket *bucket)
+{
+	unsigned spins = 0;
+
+	for (;;) {
+		uint32 v = __atomic_load_n(&bucket->version, __ATOMIC_RELAXED);
+		if (!(v & 1) && __atomic_compare_exchange_n(&bucket->version, &v, v + 1, 1,
+							    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return v + 1;
+		cmap_relax(spins++);
+	}
+}
+
+static void cmap_unlock(struct cmap_bucket *bucket, uint32 version)
+{
+	__atomic_store_n(&bucket->version, version + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Buckets of a table made for growing are left uninitialized, each
+ * one is set up by the move that fills it. Zeroing it all at once
+ * would stall the writer that starts growing.
+ */
+static struct cmap_table *cmap_table_new(const struct cmap *map, size_t buckets, int zero)
+{
+	struct cmap_table *table = calloc(1, sizeof(*table));
+
+	if (!table)
+		return NULL;
+	if (buckets > SIZE_MAX / map->bucket_size ||
+	    !(table->buckets = zero ? calloc(buckets, map->bucket_size) : malloc(buckets * map->bucket_size))) {
+		free(table);
+		return NULL;
+	}
+	table->mask = buckets - 1;
+	return table;
+}
+
+static void cmap_chain_free(struct cmap_bucket *bucket)
+{
+	struct cmap_bucket *next, *it = bucket->overflow;
+
+	for (; it; it = next) {
+		next = it->overflow;
+		free(it);
+	}
+	bucket->overflow = NULL;
+}
+
+static void cmap_table_free(const struct cmap *map, struct cmap_table *table)
+{
+	struct cmap_table *next = table->next;
+	size_t count = table->mask + 1;
+
+	// Only the buckets of a still growing next table that got filled
+	if (next && table->moved != count) {
+		for (size_t i = 0; i < count; i++) {
+			if (cmap_bucket_at(map, table, i)->moved) {
+				cmap_chain_free(cmap_bucket_at(map, next, i));
+				cmap_chain_free(cmap_bucket_at(map, next, i + count));
+			}
+		}
+		free(next->buckets);
+		free(next);
+	}
+	for (size_t i = 0; i < count; i++)
+		cmap_chain_free(cmap_bucket_at(map, table, i));
+	free(table->buckets);
+	free(table);
+}
+
+/**
+ * @param {size_t} key_size: bytes per key, keys are hashed and compared as bytes
+ * @param {size_t} value_size: bytes per value
+ * @param {size_t} expected: entries to size the first table for, can be 0
+ * @return {int}: 1 on success, 0 on failure
+ */
+int cmap_init(struct cmap *map, size_t key_size, size_t value_size, size_t expected)
+{
+	size_t key_align = cmap_align(key_size);
+	size_t value_align = cmap_align(value_size);
+	size_t slot_align = MAX(key_align, value_align);
+	size_t buckets = CMAP_MIN_BUCKETS;
+
+	memset(map, 0, sizeof(*map));
+	if (!key_size)
+		return 0;
+	map->key_size = key_size;
+	map->value_size = value_size;
+	map->value_offset = (key_size + value_align - 1) & ~(value_align - 1);
+	map->slot_size = (map->value_offset + value_size + slot_align - 1) & ~(slot_align - 1);
+	map->bucket_size = (sizeof(struct cmap_bucket) + CMAP_BUCKET_SLOTS * map->slot_size + 7) & ~(size_t)7;
+	map->seed = CMAP_SEED;
+
+	while (buckets * CMAP_LOAD_FACTOR < expected && buckets <= SIZE_MAX / 2 / map->bucket_size)
+		buckets *= 2;
+	map->table = cmap_table_new(map, buckets, 1);
+	return map->table != NULL;
+}
+
+// Nothing may use the map anymore
+void cmap_free(struct cmap *map)
+{
+	struct cmap_table *table, *next;
+
+	if (map->table)
+		cmap_table_free(map, map->table);
+	for (table = map->retired; table; table = next) {
+		next = table->retired;
+		cmap_table_free(map, table);
+	}
+	map->table = NULL;
+	map->retired = NULL;
+	map->count = 0;
+}
+
+size_t cmap_count(struct cmap *map)
+{
+	return __atomic_load_n(&map->count, __ATOMIC_RELAXED);
+}
+
+// Slot of key in the chain, readers call this without owning the bucket
+static unsigned char *cmap_find(const struct cmap *map, struct cmap_bucket *bucket, const void *key,
+				uint8 tag, uint8 **tag_at)
+{
+	for (; bucket; bucket = __atomic_load_n(&bucket->overflow, __ATOMIC_ACQUIRE)) {
+		for (int i = 0; i < CMAP_BUCKET_SLOTS; i++) {
+			unsigned char *slot = cmap_slot(map, bucket, i);
+			if (__atomic_load_n(&bucket->tags[i], __ATOMIC_ACQUIRE) == tag &&
+			    cmap_key_eq(slot, key, map->key_size)) {
+				if (tag_at)
+					*tag_at = &bucket->tags[i];
+				return slot;
+			}
+		}
+	}
+	return NULL;
+}
+
+// Empty slot in the chain tagged with tag, NULL if a new overflow
+// bucket can not be allocated
+static unsigned char *cmap_claim(const struct cmap *map, struct cmap_bucket *bucket, uint8 tag)
+{
+	for (;;) {
+		for (int i = 0; i < CMAP_BUCKET_SLOTS; i++) {
+			if (!bucket->tags[i]) {
+				__atomic_store_n(&bucket->tags[i], tag, __ATOMIC_RELEASE);
+				return cmap_slot(map, bucket, i);
+			}
+		}
+		if (!bucket->overflow) {
+			struct cmap_bucket *overflow = calloc(1, map->bucket_size);
+			if (!overflow)
+				return NULL;
+			__atomic_store_n(&bucket->overflow, overflow, __ATOMIC_RELEASE);
+		}
+		bucket = bucket->overflow;
+	}
+}
+
+static void cmap_retire(struct cmap *map, struct cmap_table *table, struct cmap_table *next)
+{
+	// Only one table finishes moving at a time, the next growth needs
+	// the store below first
+	table->retired = map->retired;
+	map->retired = table;
+	__atomic_store_n(&map->table, next, __ATOMIC_RELEASE);
+}
+
+/*
+ * Copy the entries of an owned bucket into the two buckets of next it
+ * splits into. Nobody looks at those before moved is set, so they are
+ * set up here, need no locking and a failed allocation just empties
+ * them again.
+ */
+static int cmap_move(struct cmap *map, struct cmap_table *table, struct cmap_table *next,
+		     struct cmap_bucket *bucket, size_t index)
+{
+	struct cmap_bucket *low = cmap_bucket_at(map, next, index);
+	struct cmap_bucket *high = cmap_bucket_at(map, next, index + table->mask + 1);
+	struct cmap_bucket *it;
+
+	memset(low, 0, sizeof(*low));
+	memset(high, 0, sizeof(*high));
+	for (it = bucket; it; it = it->overflow) {
+		for (int i = 0; i < CMAP_BUCKET_SLOTS; i++) {
+			unsigned char *from = cmap_slot(map, it, i), *to;
+			uint64 hash;
+
+			if (!it->tags[i])
+				continue;
+			hash = hash64(from, map->key_size, map->seed);
+			to = cmap_claim(map, (hash & next->mask) == index ? low : high, it->tags[i]);
+			if (!to) {
+				cmap_chain_free(low);
+				cmap_chain_free(high);
+				memset(low->tags, 0, sizeof(low->tags));
+				memset(high->tags, 0, sizeof(high->tags));
+				return 0;
+			}
+			memcpy(to, from, map->slot_size);
+		}
+	}
+
+	__atomic_store_n(&bucket->moved, 1, __ATOMIC_RELEASE);
+	if (__atomic_add_fetch(&table->moved, 1, __ATOMIC_ACQ_REL) == table->mask + 1)
+		cmap_retire(map, table, next);
+	return 1;
+}
+
+// Move a few buckets of a growing table, any that fail come around again
+static void cmap_help(struct cmap *map, struct cmap_table *table, struct cmap_table *next)
+{
+	for (int step = 0; step < CMAP_MOVE_STEP; step++) {
+		struct cmap_bucket *bucket;
+		size_t i;
+		uint32 v;
+
+		if (__atomic_load_n(&table->moved, __ATOMIC_ACQUIRE) == table->mask + 1)
+			return;
+		i = __atomic_fetch_add(&table->cursor, 1, __ATOMIC_RELAXED) & table->mask;
+		bucket = cmap_bucket_at(map, table, i);
+		if (__atomic_load_n(&bucket->moved, __ATOMIC_ACQUIRE))
+			continue;
+		v = cmap_lock(bucket);
+		if (!bucket->moved)
+			cmap_move(map, table, next, bucket, i);
+		cmap_unlock(bucket, v);
+	}
+}
+
+static void cmap_after_write(struct cmap *map)
+{
+	struct cmap_table *table = __atomic_load_n(&map->table, __ATOMIC_ACQUIRE);
+	struct cmap_table *next = __atomic_load_n(&table->next, __ATOMIC_ACQUIRE);
+	struct cmap_table *none = NULL;
+
+	if (next) {
+		cmap_help(map, table, next);
+		return;
+	}
+	if (cmap_count(map) <= (table->mask + 1) * CMAP_LOAD_FACTOR || table->mask + 1 > SIZE_MAX / 2 / map->bucket_size)
+		return;
+
+	// Whoever hangs the new table first starts growing, a failed
+	// allocation leaves the table as it is with longer chains
+	next = cmap_table_new(map, (table->mask + 1) * 2, 0);
+	if (!next)
+		return;
+	if (!__atomic_compare_exchange_n(&table->next, &none, next, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		free(next->buckets);
+		free(next);
+		return;
+	}
+	cmap_help(map, table, next);
+}
+
+// Own the bucket of hash in the first table that has not moved it
+static struct cmap_bucket *cmap_acquire(struct cmap *map, uint64 hash, uint32 *version)
+{
+	struct cmap_table *table = __atomic_load_n(&map->table, __ATOMIC_ACQUIRE);
+
+	for (;;) {
+		struct cmap_bucket *bucket = cmap_bucket_at(map, table, hash & table->mask);
+		if (!__atomic_load_n(&bucket->moved, __ATOMIC_ACQUIRE)) {
+			*version = cmap_lock(bucket);
+			if (!bucket->moved)
+				return bucket;
+			cmap_unlock(bucket, *version);
+		}
+		table = __atomic_load_n(&table->next, __ATOMIC_ACQUIRE);
+	}
+}
+
+/**
+ * Copy the value of key out, never blocks writers.
+ *
+ * @param {void*} value: value_size bytes, can be NULL, undefined if key is not found
+ * @return {int}: 1 if key is in the map, 0 otherwise
+ */
+int cmap_get(struct cmap *map, const void *key, void *value)
+{
+	uint64 hash = hash64(key, map->key_size, map->seed);
+	uint8 tag = cmap_tag(hash);
+	struct cmap_table *table = __atomic_load_n(&map->table, __ATOMIC_ACQUIRE);
+	unsigned spins = 0;
+
+	for (;;) {
+		struct cmap_bucket *bucket = cmap_bucket_at(map, table, hash & table->mask);
+		uint32 v = __atomic_load_n(&bucket->version, __ATOMIC_ACQUIRE);
+		unsigned char *slot;
+
+		if (v & 1) {
+			cmap_relax(spins++);
+			continue;
+		}
+		if (__atomic_load_n(&bucket->moved, __ATOMIC_ACQUIRE)) {
+			table = __atomic_load_n(&table->next, __ATOMIC_ACQUIRE);
+			continue;
+		}
+		slot = cmap_find(map, bucket, key, tag, NULL);
+		if (slot && value)
+			cmap_read(value, slot + map->value_offset, map->value_size);
+
+		// Whatever was read only counts if no writer came in between
+		if (__atomic_load_n(&bucket->version, __ATOMIC_RELAXED) == v)
+			return slot != NULL;
+	}
+}
+
+/**
+ * Insert or overwrite.
+ *
+ * @return {int}: 1 on success, 0 on allocation failure
+ */
+int cmap_put(struct cmap *map, const void *key, const void *value)
+{
+	uint64 hash = hash64(key, map->key_size, map->seed);
+	uint8 tag = cmap_tag(hash);
+	uint32 v;
+	struct cmap_bucket *bucket = cmap_acquire(map, hash, &v);
+	unsigned char *slot = cmap_find(map, bucket, key, tag, NULL);
+	int added = 0;
+
+	if (!slot) {
+		slot = cmap_claim(map, bucket, tag);
+		if (!slot) {
+			cmap_unlock(bucket, v);
+			return 0;
+		}
+		cmap_write(slot, key, map->key_size);
+		added = 1;
+	}
+	cmap_write(slot + map->value_offset, value, map->value_size);
+	cmap_unlock(bucket, v);
+
+	if (added)
+		__atomic_fetch_add(&map->count, 1, __ATOMIC_RELAXED);
+	cmap_after_write(map);
+	return 1;
+}
+
+/**
+ * @return {int}: 1 if key was in the map, 0 otherwise
+ */
+int cmap_remove(struct cmap *map, const void *key)
+{
+	uint64 hash = hash64(key, map->key_size, map->seed);
+	uint32 v;
+	struct cmap_bucket *bucket = cmap_acquire(map, hash, &v);
+	uint8 *tag_at;
+	int found = cmap_find(map, bucket, key, cmap_tag(hash), &tag_at) != NULL;
+
+	if (found)
+		__atomic_store_n(tag_at, 0, __ATOMIC_RELEASE);
+	cmap_unlock(bucket, v);
+
+	if (found)
+		__atomic_fetch_sub(&map->count, 1, __ATOMIC_RELAXED);
+	cmap_after_write(map);
+	return found;
+}
@@ -0,0 +1,684 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "csv.h"
+#include "extra.h"
+#include "system.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _SDX_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(_SDX_AVX2)
+#include <immintrin.h>
+#elif defined(_SDX_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(_SDX_PCLMUL)
+#include <wmmintrin.h>
+#endif
+
+struct csv_masks {
+	uint64 quote;
+	uint64 delim;
+	uint64 newline;
+};
+
+#if defined(_SDX_AVX2)
+static inline uint64 csv_eq64(__m256i a, __m256i b, char c)
+{
+	__m256i needle = _mm256_set1_epi8(c);
+	uint64 lo = (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, needle));
+	uint64 hi = (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, needle));
+	return lo | (hi << 32);
+}
+#endif
+
+// Bit i of each mask is set when p[i] is that character
+static inline struct csv_masks csv_masks64(const char *p, char delim)
+{
+	struct csv_masks m;
+#if defined(_SDX_AVX2)
+	__m256i a = _mm256_loadu_si256((const __m256i*)p);
+	__m256i b = _mm256_loadu_si256((const __m256i*)(p + 32));
+	m.quote = csv_eq64(a, b, '"');
+	m.delim = csv_eq64(a, b, delim);
+	m.newline = csv_eq64(a, b, '\n');
+#elif defined(_SDX_SSE2)
+	__m128i quote = _mm_set1_epi8('"'), sep = _mm_set1_epi8(delim), nl = _mm_set1_epi8('\n');
+	m.quote = m.delim = m.newline = 0;
+	for (int i = 0; i < 4; i++) {
+		__m128i block = _mm_loadu_si128((const __m128i*)(p + i * 16));
+		m.quote |= (uint64)(uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, quote)) << (i * 16);
+		m.delim |= (uint64)(uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, sep)) << (i * 16);
+		m.newline |= (uint64)(uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, nl)) << (i * 16);
+	}
+#else
+	m.quote = m.delim = m.newline = 0;
+	for (int i = 0; i < 64; i++) {
+		m.quote |= (uint64)(p[i] == '"') << i;
+		m.delim |= (uint64)(p[i] == delim) << i;
+		m.newline |= (uint64)(p[i] == '\n') << i;
+	}
+#endif
+	return m;
+}
+
+// Masks of the block at data + i, the last partial block is copied
+// into a zeroed buffer first
+static inline struct csv_masks csv_block(const char *data, size_t i, size_t len, char delim)
+{
+	if (i + 64 <= len)
+		return csv_masks64(data + i, delim);
+
+	char tail[64];
+	memset(tail, 0, sizeof(tail));
+	memcpy(tail, data + i, len - i);
+	return csv_masks64(tail, delim);
+}
+
+/*
+ * Bit i of the result is the xor of bits 0..i of x. With x the quote
+ * bits this marks the bytes from an opening quote up to, but not
+ * including, its closing quote.
+ */
+static inline uint64 csv_prefix_xor(uint64 x)
+{
+#if defined(_SDX_PCLMUL)
+	__m128i all = _mm_set1_epi8(-1);
+	return (uint64)_mm_cvtsi128_si64(_mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)x), all, 0));
+#else
+	x ^= x << 1;
+	x ^= x << 2;
+	x ^= x << 4;
+	x ^= x << 8;
+	x ^= x << 16;
+	x ^= x << 32;
+	return x;
+#endif
+}
+
+static size_t csv_count_quotes(const char *data, size_t len)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < len; i += 64)
+		count += POPCOUNT64(csv_block(data, i, len, '"').quote);
+	return count;
+}
+
+// Index of the first newline that is not quoted, len if there is none.
+// in_quote tells if data starts inside a quoted field.
+static size_t csv_find_row_end(const char *data, size_t len, int in_quote)
+{
+	uint64 inside = in_quote ? ~0ULL : 0;
+	for (size_t i = 0; i < len; i += 64) {
+		struct csv_masks m = csv_block(data, i, len, '\n');
+		uint64 quoted = csv_prefix_xor(m.quote) ^ inside;
+		uint64 ends = m.newline & ~quoted;
+		if (ends)
+			return i + CTZ64(ends);
+		inside = (uint64)((int64)quoted >> 63);
+	}
+	return len;
+}
+
+static int csv_rows_init(struct csv_rows *out)
+{
+	memset(out, 0, sizeof(*out));
+	if (array_init(&out->fields, sizeof(string_view), 0) &&
+	    array_init(&out->rows, sizeof(size_t), 0) &&
+	    array_init(&out->escaped, sizeof(size_t), 0) &&
+	    sb_init(&out->unescaped, 0))
+		return 1;
+	return 0;
+}
+
+static void csv_rows_free(struct csv_rows *out)
+{
+	free(out->fields.data);
+	free(out->rows.data);
+	free(out->escaped.data);
+	sb_free(&out->unescaped);
+	memset(out, 0, sizeof(*out));
+}
+
+// Unescaped fields hold their offset into unescaped until the buffer
+// stops moving
+static void csv_fix_escaped(struct csv_rows *out)
+{
+	string_view *fields = (string_view*)out->fields.data;
+	size_t *escaped = (size_t*)out->escaped.data;
+	for (size_t i = 0; i < out->escaped.index; i++) {
+		string_view *field = &fields[escaped[i]];
+		field->data = out->unescaped.data + (uintptr_t)field->data;
+	}
+}
+
+/*
+ * Fields without quotes and quoted fields without doubled quotes point
+ * into the input, the others are unescaped into out->unescaped.
+ */
+static int csv_push_field(struct csv_rows *out, char *data, size_t len, int has_quote)
+{
+	// csv_scan_rows reserved room for every field of the block
+	string_view *field = (string_view*)out->fields.data + out->fields.index++;
+
+	if (!has_quote) {
+		field->data = data;
+		field->len = len;
+		return 1;
+	}
+
+	if (len >= 2 && data[0] == '"' && data[len - 1] == '"' &&
+	    sv_index_of(sv_from_parts(data + 1, len - 2), '"') == len - 2) {
+		*field = sv_from_parts(data + 1, len - 2);
+		return 1;
+	}
+
+	size_t *index = array_alloc(&out->escaped);
+	if (index == NULL || !sb_reserve(&out->unescaped, len))
+		return 0;
+	*index = out->fields.index - 1;
+
+	size_t offset = out->unescaped.len;
+	char *dest = out->unescaped.data + offset;
+	size_t written = 0;
+	int in_quote = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (data[i] != '"') {
+			dest[written++] = data[i];
+		} else if (in_quote && i + 1 < len && data[i + 1] == '"') {
+			dest[written++] = '"';
+			i++;
+		} else {
+			in_quote = !in_quote;
+		}
+	}
+	out->unescaped.len += written;
+	out->unescaped.data[out->unescaped.len] = '\0';
+
+	*field = sv_from_parts((char*)(uintptr_t)offset, written);
+	return 1;
+}
+
+struct csv_scan {
+	char *data;
+	size_t len;
+	char delim;
+	struct csv_rows *out;
+	csv_callback callback;	// NULL collects the rows in out
+	void *ctx;
+	int stopped;
+};
+
+static int csv_row_end(struct csv_scan *s, size_t first_field)
+{
+	struct csv_rows *out = s->out;
+
+	if (s->callback == NULL) {
+		((size_t*)out->rows.data)[out->rows.index++] = first_field;
+		return 1;
+	}
+
+	if (out->escaped.index > 0)
+		csv_fix_escaped(out);
+	if (s->callback(s->ctx, (string_view*)out->fields.data + first_field, out->fields.index - first_field))
+		s->stopped = 1;
+	out->fields.index = first_field;
+	if (out->escaped.index > 0) {
+		out->escaped.index = 0;
+		sb_reset(&out->unescaped);
+	}
+	return 1;
+}
+
+/*
+ * Parses the rows of s->data, which has to start at a row start. The
+ * end of the input ends the last row only if final is set, otherwise
+ * the unfinished row is dropped and consumed is set to its start.
+ * Returns 0 when memory runs out or the input ends inside quotes.
+ */
+static int csv_scan_rows(struct csv_scan *s, int final, size_t *consumed)
+{
+	char *data = s->data;
+	size_t len = s->len;
+	struct csv_rows *out = s->out;
+	uint64 inside = 0;
+	int field_quote = 0;
+	size_t field_start = 0, row_start = 0;
+	size_t first_field = out->fields.index;
+	size_t first_escaped = out->escaped.index;
+	size_t unescaped_len = out->unescaped.len;
+
+	for (size_t i = 0; i < len && !s->stopped; i += 64) {
+		struct csv_masks m = csv_block(data, i, len, s->delim);
+		uint64 quoted = csv_prefix_xor(m.quote) ^ inside;
+		uint64 structural = (m.delim | m.newline) & ~quoted;
+		uint64 quotes = m.quote;
+		inside = (uint64)((int64)quoted >> 63);
+
+		// At most one field and row per byte, reserving once per block
+		// keeps the growth checks out of the field loop
+		if (!array_reserve(&out->fields, 65) ||
+		    (s->callback == NULL && !array_reserve(&out->rows, 65)))
+			return 0;
+
+		while (structural) {
+			int bit = CTZ64(structural);
+			size_t pos = i + bit;
+			uint64 upto = (2ULL << bit) - 1;
+
+			// Quotes left of the delimiter belong to this field
+			field_quote |= (quotes & upto) != 0;
+			quotes &= ~upto;
+			structural &= structural - 1;
+
+			if (m.newline >> bit & 1) {
+				size_t end = pos;
+				if (end > field_start && data[end - 1] == '\r')
+					end--;
+				int empty_line = out->fields.index == first_field && end == field_start && !field_quote;
+				if (!empty_line) {
+					if (!csv_push_field(out, data + field_start, end - field_start, field_quote) ||
+					    !csv_row_end(s, first_field))
+						return 0;
+				}
+				row_start = pos + 1;
+				first_field = out->fields.index;
+				first_escaped = out->escaped.index;
+				unescaped_len = out->unescaped.len;
+			} else if (!csv_push_field(out, data + field_start, pos - field_start, field_quote)) {
+				return 0;
+			}
+
+			field_start = pos + 1;
+			field_quote = 0;
+			if (s->stopped)
+				break;
+		}
+		field_quote |= quotes != 0;
+	}
+
+	if (s->stopped || row_start == len) {
+		*consumed = row_start;
+		return 1;
+	}
+
+	if (final && !inside) {
+		size_t end = len;
+		if (end > field_start && data[end - 1] == '\r')
+			end--;
+		if (out->fields.index == first_field && end == field_start && !field_quote) {
+			*consumed = len;
+			return 1;
+		}
+		if (!array_reserve(&out->fields, 1) || !array_reserve(&out->rows, 1) ||
+		    !csv_push_field(out, data + field_start, end - field_start, field_quote) ||
+		    !csv_row_end(s, first_field))
+			return 0;
+		*consumed = len;
+		return 1;
+	}
+
+	// Drop the unfinished row
+	out->fields.index = first_field;
+	out->escaped.index = first_escaped;
+	out->unescaped.len = unescaped_len;
+	out->unescaped.data[unescaped_len] = '\0';
+	*consumed = row_start;
+	return !final;
+}
+
+/**
+ * Rows are handed to callback one at a time, use ',' or '\t' as
+ * delim for CSV or TSV.
+ */
+int csv_init(struct csv_parser *p, char delim, csv_callback callback, void *ctx)
+{
+	memset(p, 0, sizeof(*p));
+	p->delim = delim;
+	p->callback = callback;
+	p->ctx = ctx;
+
+	if (csv_rows_init(&p->rows) && sb_init(&p->carry, 0))
+		return 1;
+
+	csv_free(p);
+	return 0;
+}
+
+/**
+ * Parse a whole buffer, the last row does not need a newline.
+ *
+ * @return {int}: 1 on success, 0 if memory ran out or the input ends
+ * inside a quoted field.
+ */
+int csv_parse(struct csv_parser *p, string_view sv)
+{
+	if (p->carry.len > 0)
+		return csv_feed(p, sv) && csv_finish(p);
+	if (p->stopped)
+		return 1;
+
+	struct csv_scan s = { sv.data, sv.len, p->delim, &p->rows, p->callback, p->ctx, 0 };
+	size_t consumed;
+	int ok = csv_scan_rows(&s, 1, &consumed);
+	p->stopped = s.stopped;
+	return ok;
+}
+
+/**
+ * Parse the next piece of the input, rows that are complete are handed
+ * out right away and point into chunk. The unfinished row at the end
+ * is copied and completed by the next csv_feed() or csv_finish().
+ */
+int csv_feed(struct csv_parser *p, string_view chunk)
+{
+	if (p->stopped)
+		return 1;
+
+	struct csv_scan s = { NULL, 0, p->delim, &p->rows, p->callback, p->ctx, 0 };
+	size_t consumed;
+
+	if (p->carry.len > 0) {
+		size_t end = csv_find_row_end(chunk.data, chunk.len, csv_count_quotes(p->carry.data, p->carry.len) & 1);
+		if (end == chunk.len)
+			return sb_append(&p->carry, chunk.data, chunk.len);
+
+		if (!sb_append(&p->carry, chunk.data, end + 1))
+			return 0;
+		s.data = p->carry.data;
+		s.len = p->carry.len;
+		if (!csv_scan_rows(&s, 0, &consumed))
+			return 0;
+		sb_reset(&p->carry);
+		chunk.data += end + 1;
+		chunk.len -= end + 1;
+		if (s.stopped) {
+			p->stopped = 1;
+			return 1;
+		}
+	}
+
+	s.data = chunk.data;
+	s.len = chunk.len;
+	if (!csv_scan_rows(&s, 0, &consumed))
+		return 0;
+	p->stopped = s.stopped;
+	if (p->stopped)
+		return 1;
+
+	return sb_append(&p->carry, chunk.data + consumed, chunk.len - consumed);
+}
+
+// Hands out the last row if the input did not end with a newline
+int csv_finish(struct csv_parser *p)
+{
+	if (p->stopped || p->carry.len == 0)
+		return 1;
+
+	struct csv_scan s = { p->carry.data, p->carry.len, p->delim, &p->rows, p->callback, p->ctx, 0 };
+	size_t consumed;
+	int ok = csv_scan_rows(&s, 1, &consumed);
+	p->stopped = s.stopped;
+	sb_reset(&p->carry);
+	return ok;
+}
+
+void csv_free(struct csv_parser *p)
+{
+	csv_rows_free(&p->rows);
+	sb_free(&p->carry);
+	memset(p, 0, sizeof(*p));
+}
+
+struct csv_job {
+	char *data;
+	size_t begin;
+	size_t end;
+	char delim;
+	size_t quotes;
+	struct csv_rows rows;
+	int parse;
+	int ok;
+};
+
+#ifdef _SDX_WINDOWS
+static DWORD WINAPI csv_worker(LPVOID arg)
+#else
+static void *csv_worker(void *arg)
+#endif
+{
+	struct csv_job *job = arg;
+	if (!job->parse) {
+		job->quotes = csv_count_quotes(job->data + job->begin, job->end - job->begin);
+		job->ok = 1;
+		return 0;
+	}
+
+	struct csv_scan s = { job->data + job->begin, job->end - job->begin, job->delim, &job->rows, NULL, NULL, 0 };
+	size_t consumed;
+	job->ok = csv_rows_init(&job->rows) && csv_scan_rows(&s, 1, &consumed);
+	return 0;
+}
+
+// Runs every job, on its own thread when one can be started
+static void csv_run(struct csv_job *jobs, int count)
+{
+	if (count == 1) {
+		csv_worker(&jobs[0]);
+		return;
+	}
+
+	int started = 0;
+#ifdef _SDX_WINDOWS
+	HANDLE *threads = malloc(count * sizeof(*threads));
+	if (threads != NULL) {
+		for (; started < count; started++) {
+			threads[started] = CreateThread(NULL, 0, csv_worker, &jobs[started], 0, NULL);
+			if (threads[started] == NULL)
+				break;
+		}
+	}
+#else
+	pthread_t *threads = malloc(count * sizeof(*threads));
+	if (threads != NULL) {
+		for (; started < count; started++)
+			if (pthread_create(&threads[started], NULL, csv_worker, &jobs[started]) != 0)
+				break;
+	}
+#endif
+
+	for (int t = started; t < count; t++)
+		csv_worker(&jobs[t]);
+
+	for (int t = 0; t < started; t++) {
+#ifdef _SDX_WINDOWS
+		WaitForSingleObject(threads[t], INFINITE);
+		CloseHandle(threads[t]);
+#else
+		pthread_join(threads[t], NULL);
+#endif
+	}
+	free(threads);
+}
+
+// Moves the rows of a finished job to the end of the table
+static int csv_table_append(struct csv_table *table, struct csv_rows *rows)
+{
+	csv_fix_escaped(rows);
+
+	// The first job's arrays can be taken over as they are
+	if (table->fields.index == 0 && table->rows.index == 0) {
+		struct array swap = table->fields;
+		table->fields = rows->fields;
+		rows->fields = swap;
+		swap = table->rows;
+		table->rows = rows->rows;
+		rows->rows = swap;
+		rows->fields.index = 0;
+		rows->rows.index = 0;
+	}
+
+	size_t base = table->fields.index;
+	if (!array_reserve(&table->fields, rows->fields.index) ||
+	    !array_reserve(&table->rows, rows->rows.index))
+		return 0;
+
+	memcpy(table->fields.data + base * sizeof(string_view), rows->fields.data,
+	       rows->fields.index * sizeof(string_view));
+	table->fields.index += rows->fields.index;
+
+	size_t *first = (size_t*)rows->rows.data;
+	for (size_t i = 0; i < rows->rows.index; i++) {
+		size_t *row = array_alloc(&table->rows);
+		*row = base + first[i];
+	}
+
+	// The table takes over the unescaped fields
+	if (rows->escaped.index > 0) {
+		char **buffer = array_alloc(&table->buffers);
+		if (buffer == NULL)
+			return 0;
+		*buffer = rows->unescaped.data;
+		rows->unescaped.data = NULL;
+	}
+	return 1;
+}
+
+/**
+ * Parse a whole buffer into a table, the fields point into sv which
+ * has to outlive the table.
+ *
+ * The buffer is cut into nthreads chunks that are parsed on their own
+ * threads. Counting the quotes of every chunk first tells which
+ * newlines end rows, so chunks always start at a row even when quoted
+ * fields hold newlines. nthreads 0 uses every available core, inputs
+ * smaller than CSV_PARALLEL_MIN_CHUNK per thread use fewer threads.
+ *
+ * @return {int}: 1 on success, 0 if memory ran out or the input ends
+ * inside a quoted field.
+ */
+int csv_parse_table(struct csv_table *table, string_view sv, char delim, int nthreads)
+{
+	memset(table, 0, sizeof(*table));
+	if (!array_init(&table->fields, sizeof(string_view), 0) ||
+	    !array_init(&table->rows, sizeof(size_t), 0) ||
+	    !array_init(&table->buffers, sizeof(char*), 0)) {
+		csv_table_free(table);
+		return 0;
+	}
+
+	if (nthreads <= 0)
+		nthreads = sys_get_num_cpu_core_avail();
+	if ((size_t)nthreads > sv.len / CSV_PARALLEL_MIN_CHUNK)
+		nthreads = sv.len / CSV_PARALLEL_MIN_CHUNK;
+	if (nthreads < 1)
+		nthreads = 1;
+
+	struct csv_job *jobs = calloc(nthreads, sizeof(*jobs));
+	if (jobs == NULL) {
+		csv_table_free(table);
+		return 0;
+	}
+
+	size_t chunk = sv.len / nthreads;
+	for (int t = 0; t < nthreads; t++) {
+		jobs[t].data = sv.data;
+		jobs[t].begin = chunk * t;
+		jobs[t].end = t == nthreads - 1 ? sv.len : chunk * (t + 1);
+		jobs[t].delim = delim;
+	}
+	if (nthreads > 1)
+		csv_run(jobs, nthreads);
+
+	// Move every cut to the end of the row it falls in
+	size_t quotes = 0, start = 0;
+	for (int t = 0; t < nthreads; t++) {
+		size_t end = sv.len;
+		if (t < nthreads - 1) {
+			quotes += jobs[t].quotes;
+			end = jobs[t].end;
+			if (end < start) {
+				// The previous row ran past this whole chunk
+				end = start;
+			} else {
+				end += csv_find_row_end(sv.data + end, sv.len - end, quotes & 1);
+				end = MIN(end + 1, sv.len);
+			}
+		}
+		jobs[t].begin = start;
+		jobs[t].end = end;
+		jobs[t].parse = 1;
+		start = end;
+	}
+	csv_run(jobs, nthreads);
+
+	int ok = 1;
+	for (int t = 0; t < nthreads; t++) {
+		ok = ok && jobs[t].ok && csv_table_append(table, &jobs[t].rows);
+		csv_rows_free(&jobs[t].rows);
+	}
+	free(jobs);
+
+	if (!ok)
+		csv_table_free(table);
+	return ok;
+}
+
+size_t csv_row_count(const struct csv_table *table)
+{
+	return table->rows.index;
+}
+
+/**
+ * @return {string_view*}: the fields of row, count is set to their
+ * number.
+ */
+string_view *csv_row(const struct csv_table *table, size_t row, size_t *count)
+{
+	const size_t *rows = (const size_t*)table->rows.data;
+	size_t end = row + 1 < table->rows.index ? rows[row + 1] : table->fields.index;
+	*count = end - rows[row];
+	return (string_view*)table->fields.data + rows[row];
+}
+
+void csv_table_free(struct csv_table *table)
+{
+	char **buffers = (char**)table->buffers.data;
+	for (size_t i = 0; i < table->buffers.index; i++)
+		free(buffers[i]);
+
+	free(table->fields.data);
+	free(table->rows.data);
+	free(table->buffers.data);
+	memset(table, 0, sizeof(*table));
+}
@@ -0,0 +1,691 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "encoding.h"
+#include "extra.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_SDX_AVX2)
+#include <immintrin.h>
+#elif defined(_SDX_SSSE3)
+#include <tmmintrin.h>
+#elif defined(_SDX_SSE2)
+#include <emmintrin.h>
+#endif
+
+static const char base64_std_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char base64_url_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Value of every byte, 255 for bytes outside the alphabet
+static const unsigned char base64_std_values[256] = {
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  62, 255, 255, 255,  63,
+	 52,  53,  54,  55,  56,  57,  58,  59,  60,  61, 255, 255, 255, 255, 255, 255,
+	255,   0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,
+	 15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25, 255, 255, 255, 255, 255,
+	255,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+	 41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+};
+
+static const unsigned char base64_url_values[256] = {
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  62, 255, 255,
+	 52,  53,  54,  55,  56,  57,  58,  59,  60,  61, 255, 255, 255, 255, 255, 255,
+	255,   0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,
+	 15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25, 255, 255, 255, 255,  63,
+	255,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+	 41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+};
+
+#if defined(_SDX_SSSE3)
+/*
+ * SIMD base64 after Wojciech Mula and Daniel Lemire. Encoding spreads
+ * every 3 bytes over 4 lanes, cuts out the 6 bit indexes with two
+ * multiplies and turns them into characters with a 16 entry offset
+ * table. Decoding checks every byte with two nibble lookups (a byte is
+ * valid when the bits of its low and high nibble do not overlap), adds
+ * a per nibble offset to get the values and packs them with two
+ * multiply-adds.
+ */
+#define BASE64_ENC_SHUFFLE 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10
+#define BASE64_ENC_OFFSETS(c62, c63) 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, \
+	'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, (c62) - 62, (c63) - 63, 'A', 0, 0
+#define BASE64_DEC_PACK 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+
+// Rows: bits of the low nibbles, bits of the high nibbles, offsets by
+// high nibble with 8 added for the character of value 63
+static const signed char base64_std_nibbles[3][16] = {
+	{ 0x55, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x43, 0x6a, 0x6b, 0x6b, 0x6b, 0x6a },
+	{ 0x40, 0x40, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40 },
+	{ 0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 16, 0, 0, 0, 0, 0 },
+};
+
+static const signed char base64_url_nibbles[3][16] = {
+	{ 0x55, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x43, 0x6b, 0x6b, 0x6a, 0x6b, 0x63 },
+	{ 0x40, 0x40, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40 },
+	{ 0, 0, 17, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, -32, 0, 0 },
+};
+#endif
+
+#if defined(_SDX_AVX2)
+static inline __m256i base64_enc_avx2(__m256i in, __m256i offsets)
+{
+	in = _mm256_shuffle_epi8(in, _mm256_setr_epi8(BASE64_ENC_SHUFFLE, BASE64_ENC_SHUFFLE));
+	__m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+	__m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+	__m256i index = _mm256_or_si256(t0, t1);
+
+	__m256i row = _mm256_subs_epu8(index, _mm256_set1_epi8(51));
+	__m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), index);
+	row = _mm256_or_si256(row, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+	return _mm256_add_epi8(_mm256_shuffle_epi8(offsets, row), index);
+}
+
+// 0 if a byte is outside the alphabet
+static inline int base64_dec_avx2(__m256i in, const signed char (*nibbles)[16], char c63, __m256i *out)
+{
+	__m256i lo_bits = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)nibbles[0]));
+	__m256i hi_bits = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)nibbles[1]));
+	__m256i offsets = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)nibbles[2]));
+	__m256i nibble = _mm256_set1_epi8(0x0f);
+	__m256i hi = _mm256_and_si256(_mm256_srli_epi32(in, 4), nibble);
+	__m256i lo = _mm256_and_si256(in, nibble);
+	__m256i bad = _mm256_and_si256(_mm256_shuffle_epi8(lo_bits, lo), _mm256_shuffle_epi8(hi_bits, hi));
+	if ((uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bad, _mm256_setzero_si256())) != 0xffffffffu)
+		return 0;
+
+	__m256i last = _mm256_and_si256(_mm256_cmpeq_epi8(in, _mm256_set1_epi8(c63)), _mm256_set1_epi8(8));
+	__m256i values = _mm256_add_epi8(in, _mm256_shuffle_epi8(offsets, _mm256_or_si256(hi, last)));
+	__m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+	__m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+	packed = _mm256_shuffle_epi8(packed, _mm256_setr_epi8(BASE64_DEC_PACK, BASE64_DEC_PACK));
+	*out = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+	return 1;
+}
+#elif defined(_SDX_SSSE3)
+static inline __m128i base64_enc_ssse3(__m128i in, __m128i offsets)
+{
+	in = _mm_shuffle_epi8(in, _mm_setr_epi8(BASE64_ENC_SHUFFLE));
+	__m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+	__m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+	__m128i index = _mm_or_si128(t0, t1);
+
+	__m128i row = _mm_subs_epu8(index, _mm_set1_epi8(51));
+	__m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), index);
+	row = _mm_or_si128(row, _mm_and_si128(less, _mm_set1_epi8(13)));
+	return _mm_add_epi8(_mm_shuffle_epi8(offsets, row), index);
+}
+
+static inline int base64_dec_ssse3(__m128i in, const signed char (*nibbles)[16], char c63, __m128i *out)
+{
+	__m128i nibble = _mm_set1_epi8(0x0f);
+	__m128i hi = _mm_and_si128(_mm_srli_epi32(in, 4), nibble);
+	__m128i lo = _mm_and_si128(in, nibble);
+	__m128i bad = _mm_and_si128(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)nibbles[0]), lo),
+				    _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)nibbles[1]), hi));
+	if (_mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) != 0xffff)
+		return 0;
+
+	__m128i last = _mm_and_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8(c63)), _mm_set1_epi8(8));
+	__m128i values = _mm_add_epi8(in, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)nibbles[2]), _mm_or_si128(hi, last)));
+	__m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+	__m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+	*out = _mm_shuffle_epi8(packed, _mm_setr_epi8(BASE64_DEC_PACK));
+	return 1;
+}
+#endif
+
+size_t base64_encoded_len(size_t len, int flags)
+{
+	if (flags & BASE64_NO_PAD)
+		return len / 3 * 4 + (len % 3 ? len % 3 + 1 : 0);
+	return (len + 2) / 3 * 4;
+}
+
+// Enough for any input of len characters
+size_t base64_decoded_max(size_t len)
+{
+	return (len + 3) / 4 * 3;
+}
+
+static size_t base64_encode_core(char *out, const unsigned char *in, size_t len, int flags)
+{
+	const char *alphabet = flags & BASE64_URL ? base64_url_alphabet : base64_std_alphabet;
+	size_t i = 0, o = 0;
+
+#if defined(_SDX_AVX2)
+	__m128i half = _mm_setr_epi8(BASE64_ENC_OFFSETS(alphabet[62], alphabet[63]));
+	__m256i offsets = _mm256_broadcastsi128_si256(half);
+	for (; i + 28 <= len; i += 24, o += 32) {
+		__m256i block = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(in + i))),
+							_mm_loadu_si128((const __m128i*)(in + i + 12)), 1);
+		_mm256_storeu_si256((__m256i*)(out + o), base64_enc_avx2(block, offsets));
+	}
+#elif defined(_SDX_SSSE3)
+	__m128i offsets = _mm_setr_epi8(BASE64_ENC_OFFSETS(alphabet[62], alphabet[63]));
+	for (; i + 16 <= len; i += 12, o += 16)
+		_mm_storeu_si128((__m128i*)(out + o), base64_enc_ssse3(_mm_loadu_si128((const __m128i*)(in + i)), offsets));
+#endif
+
+	for (; i + 3 <= len; i += 3, o += 4) {
+		uint32 v = (uint32)in[i] << 16 | (uint32)in[i + 1] << 8 | in[i + 2];
+		out[o] = alphabet[v >> 18];
+		out[o + 1] = alphabet[(v >> 12) & 63];
+		out[o + 2] = alphabet[(v >> 6) & 63];
+		out[o + 3] = alphabet[v & 63];
+	}
+
+	if (i < len) {
+		uint32 v = (uint32)in[i] << 16 | (i + 1 < len ? (uint32)in[i + 1] << 8 : 0);
+		out[o++] = alphabet[v >> 18];
+		out[o++] = alphabet[(v >> 12) & 63];
+		if (i + 1 < len)
+			out[o++] = alphabet[(v >> 6) & 63];
+		if (!(flags & BASE64_NO_PAD)) {
+			if (i + 1 >= len)
+				out[o++] = '=';
+			out[o++] = '=';
+		}
+	}
+	return o;
+}
+
+/**
+ * Encodes in, out needs base64_encoded_len(in.len, flags) bytes and is
+ * not NUL terminated.
+ * @param {int} flags: BASE64_URL, BASE64_NO_PAD or 0
+ * @return {size_t}: Bytes written
+ */
+size_t base64_encode(char *out, string_view in, int flags)
+{
+	return base64_encode_core(out, (const unsigned char*)in.data, in.len, flags);
+}
+
+/*
+ * Decodes len characters, '=' may only close the last group. Sets
+ * *bad to the offset of the first bad byte and returns 0 on errors.
+ */
+static int base64_decode_core(unsigned char *out, const unsigned char *in, size_t len, int flags,
+			      size_t *out_len, size_t *bad)
+{
+	const unsigned char *values = flags & BASE64_URL ? base64_url_values : base64_std_values;
+	size_t end = len, i = 0, o = 0;
+	if (end > 0 && in[end - 1] == '=')
+		end--;
+	if (end > 0 && in[end - 1] == '=')
+		end--;
+	if (end < len && len % 4 != 0) {
+		*bad = end;
+		return 0;
+	}
+
+#if defined(_SDX_AVX2)
+	const signed char (*nibbles)[16] = flags & BASE64_URL ? base64_url_nibbles : base64_std_nibbles;
+	char c63 = flags & BASE64_URL ? '_' : '/';
+	for (; i + 44 <= end; i += 32, o += 24) {
+		__m256i block;
+		if (!base64_dec_avx2(_mm256_loadu_si256((const __m256i*)(in + i)), nibbles, c63, &block))
+			break;
+		_mm256_storeu_si256((__m256i*)(out + o), block);
+	}
+#elif defined(_SDX_SSSE3)
+	const signed char (*nibbles)[16] = flags & BASE64_URL ? base64_url_nibbles : base64_std_nibbles;
+	char c63 = flags & BASE64_URL ? '_' : '/';
+	for (; i + 24 <= end; i += 16, o += 12) {
+		__m128i block;
+		if (!base64_dec_ssse3(_mm_loadu_si128((const __m128i*)(in + i)), nibbles, c63, &block))
+			break;
+		_mm_storeu_si128((__m128i*)(out + o), block);
+	}
+#endif
+
+	for (; i + 4 <= end; i += 4, o += 3) {
+		uint32 a = values[in[i]], b = values[in[i + 1]], c = values[in[i + 2]], d = values[in[i + 3]];
+		if ((a | b | c | d) == 255) {
+			while (values[in[i]] != 255)
+				i++;
+			*bad = i;
+			return 0;
+		}
+		uint32 v = a << 18 | b << 12 | c << 6 | d;
+		out[o] = v >> 16;
+		out[o + 1] = v >> 8;
+		out[o + 2] = v;
+	}
+
+	// 2 or 3 characters left, their unused low bits have to be 0
+	size_t tail = end - i;
+	uint32 v = 0;
+	for (size_t k = 0; k < tail; k++) {
+		if (values[in[i + k]] == 255) {
+			*bad = i + k;
+			return 0;
+		}
+		v = v << 6 | values[in[i + k]];
+	}
+	if (tail == 1 || (tail == 2 && (v & 15)) || (tail == 3 && (v & 3))) {
+		*bad = end - 1;
+		return 0;
+	}
+	if (tail == 2) {
+		out[o++] = v >> 4;
+	} else if (tail == 3) {
+		out[o++] = v >> 10;
+		out[o++] = v >> 2;
+	}
+
+	*out_len = o;
+	return 1;
+}
+
+/**
+ * Decodes in, out needs base64_decoded_max(in.len) bytes.
+ * @param {int} flags: BASE64_URL or 0, padding is always optional
+ * @param {size_t*} out_len: Bytes written
+ * @param {size_t*} error_offset: Offset of the first bad byte on failure
+ * @return {int}: 1 on success, 0 if in is not valid base64
+ */
+int base64_decode(char *out, string_view in, int flags, size_t *out_len, size_t *error_offset)
+{
+	size_t bad = 0;
+	*out_len = 0;
+	if (base64_decode_core((unsigned char*)out, (const unsigned char*)in.data, in.len, flags, out_len, &bad))
+		return 1;
+	if (error_offset)
+		*error_offset = bad;
+	return 0;
+}
+
+int base64_encode_arena(struct arena *arena, string_view in, int flags, string_view *out)
+{
+	size_t len = base64_encoded_len(in.len, flags);
+	char *buf = arena_alloc(arena, len ? len : 1);
+	if (buf == NULL)
+		return 0;
+	out->data = buf;
+	out->len = base64_encode(buf, in, flags);
+	return 1;
+}
+
+int base64_decode_arena(struct arena *arena, string_view in, int flags, string_view *out, size_t *error_offset)
+{
+	size_t len = base64_decoded_max(in.len);
+	char *buf = arena_alloc(arena, len ? len : 1);
+	if (buf == NULL)
+		return 0;
+	out->data = buf;
+	return base64_decode(buf, in, flags, &out->len, error_offset);
+}
+
+void base64_stream_init(struct base64_stream *s, int flags)
+{
+	memset(s, 0, sizeof(*s));
+	s->flags = flags;
+}
+
+/**
+ * Encodes a chunk, up to 2 bytes are kept for the next call. out needs
+ * (in.len + 2) / 3 * 4 bytes.
+ * @return {size_t}: Bytes written
+ */
+size_t base64_encode_update(struct base64_stream *s, char *out, string_view in)
+{
+	const unsigned char *p = (const unsigned char*)in.data;
+	size_t i = 0, o = 0;
+
+	if (s->carry_len) {
+		while (s->carry_len < 3 && i < in.len)
+			s->carry[s->carry_len++] = p[i++];
+		if (s->carry_len < 3)
+			return 0;
+		o = base64_encode_core(out, s->carry, 3, s->flags);
+		s->carry_len = 0;
+	}
+
+	size_t full = (in.len - i) / 3 * 3;
+	o += base64_encode_core(out + o, p + i, full, s->flags);
+	for (i += full; i < in.len; i++)
+		s->carry[s->carry_len++] = p[i];
+	return o;
+}
+
+// Writes the last group and its padding, at most 4 bytes
+size_t base64_encode_final(struct base64_stream *s, char *out)
+{
+	size_t o = base64_encode_core(out, s->carry, s->carry_len, s->flags);
+	s->carry_len = 0;
+	return o;
+}
+
+/**
+ * Decodes a chunk, up to 3 characters are kept for the next call. out
+ * needs (in.len + 3) / 4 * 3 bytes.
+ * @param {size_t*} error_offset: Offset in the whole stream on failure
+ * @return {int}: 1 on success, 0 if the input is not valid base64
+ */
+int base64_decode_update(struct base64_stream *s, char *out, string_view in, size_t *out_len, size_t *error_offset)
+{
+	const unsigned char *p = (const unsigned char*)in.data;
+	unsigned char *dst = (unsigned char*)out;
+	size_t i = 0, o = 0, n, bad;
+	*out_len = 0;
+
+	if (s->carry_len && !s->done) {
+		while (s->carry_len < 4 && i < in.len)
+			s->carry[s->carry_len++] = p[i++];
+		if (s->carry_len < 4)
+			return 1;
+		if (!base64_decode_core(dst, s->carry, 4, s->flags, &n, &bad))
+			goto error;
+		o = n;
+		s->done = n < 3;
+		s->offset += 4;
+		s->carry_len = 0;
+	}
+
+	size_t full = (in.len - i) / 4 * 4;
+	if (i < in.len && s->done) {
+		bad = 0;
+		goto error;
+	}
+	if (full) {
+		if (!base64_decode_core(dst + o, p + i, full, s->flags, &n, &bad))
+			goto error;
+		o += n;
+		s->done = n < full / 4 * 3;
+		s->offset += full;
+		i += full;
+	}
+	if (i < in.len && s->done) {
+		bad = 0;
+		goto error;
+	}
+	for (; i < in.len; i++)
+		s->carry[s->carry_len++] = p[i];
+	*out_len = o;
+	return 1;
+
+error:
+	if (error_offset)
+		*error_offset = s->offset + bad;
+	return 0;
+}
+
+// Decodes the characters still carried, at most 2 bytes
+int base64_decode_final(struct base64_stream *s, char *out, size_t *out_len, size_t *error_offset)
+{
+	size_t bad = 0;
+	*out_len = 0;
+	if (s->carry_len == 0)
+		return 1;
+	if (!base64_decode_core((unsigned char*)out, s->carry, s->carry_len, s->flags, out_len, &bad)) {
+		if (error_offset)
+			*error_offset = s->offset + bad;
+		return 0;
+	}
+	s->offset += s->carry_len;
+	s->carry_len = 0;
+	return 1;
+}
+
+#if defined(_SDX_SSE2)
+// 8 bytes into 16 hex digits, every 16 bit lane gets the high nibble in
+// its first byte and the low nibble in its second
+static inline __m128i hex_digits_sse2(__m128i x)
+{
+	__m128i nibbles = _mm_or_si128(_mm_srli_epi16(x, 4), _mm_slli_epi16(_mm_and_si128(x, _mm_set1_epi16(0x0f)), 8));
+	__m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+	return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+
+// 0 if a byte is not a hex digit, values are written to *out
+static inline int hex_values_sse2(__m128i in, __m128i *out)
+{
+	__m128i digit = _mm_sub_epi8(in, _mm_set1_epi8('0'));
+	__m128i letter = _mm_sub_epi8(_mm_or_si128(in, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	__m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+	__m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+	if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xffff)
+		return 0;
+	*out = _mm_or_si128(_mm_and_si128(is_digit, digit),
+			    _mm_andnot_si128(is_digit, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+	return 1;
+}
+#endif
+
+#if defined(_SDX_AVX2)
+static inline __m256i hex_digits_avx2(__m256i x)
+{
+	__m256i nibbles = _mm256_or_si256(_mm256_srli_epi16(x, 4),
+					  _mm256_slli_epi16(_mm256_and_si256(x, _mm256_set1_epi16(0x0f)), 8));
+	__m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9)), _mm256_set1_epi8('a' - '0' - 10));
+	return _mm256_add_epi8(_mm256_add_epi8(nibbles, _mm256_set1_epi8('0')), letters);
+}
+
+static inline int hex_values_avx2(__m256i in, __m256i *out)
+{
+	__m256i digit = _mm256_sub_epi8(in, _mm256_set1_epi8('0'));
+	__m256i letter = _mm256_sub_epi8(_mm256_or_si256(in, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+	__m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+	__m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+	if ((uint32)_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_letter)) != 0xffffffffu)
+		return 0;
+	*out = _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+			       _mm256_andnot_si256(is_digit, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+	return 1;
+}
+#endif
+
+static inline int hex_value(unsigned char c)
+{
+	if ((unsigned)(c - '0') < 10)
+		return c - '0';
+	c |= 0x20;
+	if ((unsigned)(c - 'a') < 6)
+		return c - 'a' + 10;
+	return -1;
+}
+
+// Lower case, out needs 2 * in.len bytes and is not NUL terminated
+size_t hex_encode(char *out, string_view in)
+{
+	static const char digits[] = "0123456789abcdef";
+	const unsigned char *p = (const unsigned char*)in.data;
+	size_t i = 0;
+
+#if defined(_SDX_AVX2)
+	for (; i + 16 <= in.len; i += 16) {
+		__m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + i)));
+		_mm256_storeu_si256((__m256i*)(out + 2 * i), hex_digits_avx2(x));
+	}
+#elif defined(_SDX_SSE2)
+	for (; i + 16 <= in.len; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(p + i));
+		__m128i zero = _mm_setzero_si128();
+		_mm_storeu_si128((__m128i*)(out + 2 * i), hex_digits_sse2(_mm_unpacklo_epi8(x, zero)));
+		_mm_storeu_si128((__m128i*)(out + 2 * i + 16), hex_digits_sse2(_mm_unpackhi_epi8(x, zero)));
+	}
+#endif
+
+	for (; i < in.len; i++) {
+		out[2 * i] = digits[p[i] >> 4];
+		out[2 * i + 1] = digits[p[i] & 15];
+	}
+	return 2 * in.len;
+}
+
+// Decodes an even number of characters
+static int hex_decode_core(unsigned char *out, const unsigned char *in, size_t len, size_t *bad)
+{
+	size_t i = 0;
+
+#if defined(_SDX_AVX2)
+	for (; i + 32 <= len; i += 32) {
+		__m256i v;
+		if (!hex_values_avx2(_mm256_loadu_si256((const __m256i*)(in + i)), &v))
+			break;
+		__m256i w = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0xff)), 4),
+					    _mm256_srli_epi16(v, 8));
+		w = _mm256_permute4x64_epi64(_mm256_packus_epi16(w, w), 0x08);
+		_mm_storeu_si128((__m128i*)(out + i / 2), _mm256_castsi256_si128(w));
+	}
+#elif defined(_SDX_SSE2)
+	for (; i + 16 <= len; i += 16) {
+		__m128i v;
+		if (!hex_values_sse2(_mm_loadu_si128((const __m128i*)(in + i)), &v))
+			break;
+		__m128i w = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0xff)), 4), _mm_srli_epi16(v, 8));
+		_mm_storel_epi64((__m128i*)(out + i / 2), _mm_packus_epi16(w, w));
+	}
+#endif
+
+	for (; i < len; i += 2) {
+		int hi = hex_value(in[i]), lo = hex_value(in[i + 1]);
+		if ((hi | lo) < 0) {
+			*bad = hi < 0 ? i : i + 1;
+			return 0;
+		}
+		out[i / 2] = hi << 4 | lo;
+	}
+	return 1;
+}
+
+/**
+ * Decodes hex digits of either case, out needs in.len / 2 bytes.
+ * @param {size_t*} error_offset: Offset of the first bad byte, the last
+ * one if the length is odd
+ * @return {int}: 1 on success, 0 if in is not valid hex
+ */
+int hex_decode(char *out, string_view in, size_t *out_len, size_t *error_offset)
+{
+	size_t bad = 0, even = in.len & ~(size_t)1;
+	*out_len = 0;
+	if (!hex_decode_core((unsigned char*)out, (const unsigned char*)in.data, even, &bad) ||
+	    (even < in.len && (bad = even, 1))) {
+		if (error_offset)
+			*error_offset = bad;
+		return 0;
+	}
+	*out_len = in.len / 2;
+	return 1;
+}
+
+int hex_encode_arena(struct arena *arena, string_view in, string_view *out)
+{
+	char *buf = arena_alloc(arena, in.len ? 2 * in.len : 1);
+	if (buf == NULL)
+		return 0;
+	out->data = buf;
+	out->len = hex_encode(buf, in);
+	return 1;
+}
+
+int hex_decode_arena(struct arena *arena, string_view in, string_view *out, size_t *error_offset)
+{
+	char *buf = arena_alloc(arena, in.len / 2 ? in.len / 2 : 1);
+	if (buf == NULL)
+		return 0;
+	out->data = buf;
+	return hex_decode(buf, in, &out->len, error_offset);
+}
+
+void hex_stream_init(struct hex_stream *s)
+{
+	memset(s, 0, sizeof(*s));
+}
+
+// Decodes a chunk, an odd digit at the end waits for the next call.
+// out needs (in.len + 1) / 2 bytes.
+int hex_decode_update(struct hex_stream *s, char *out, string_view in, size_t *out_len, size_t *error_offset)
+{
+	const unsigned char *p = (const unsigned char*)in.data;
+	unsigned char *dst = (unsigned char*)out;
+	size_t i = 0, o = 0, bad = 0;
+	*out_len = 0;
+
+	if (s->has_carry && in.len > 0) {
+		int hi = hex_value(s->carry), lo = hex_value(p[0]);
+		if (lo < 0) {
+			bad = 1;
+			goto error;
+		}
+		dst[o++] = hi << 4 | lo;
+		s->has_carry = 0;
+		s->offset += 2;
+		i = 1;
+	}
+
+	size_t even = (in.len - i) & ~(size_t)1;
+	if (!hex_decode_core(dst + o, p + i, even, &bad))
+		goto error;
+	o += even / 2;
+	s->offset += even;
+	i += even;
+
+	if (i < in.len) {
+		if (hex_value(p[i]) < 0) {
+			bad = 0;
+			goto error;
+		}
+		s->carry = p[i];
+		s->has_carry = 1;
+	}
+	*out_len = o;
+	return 1;
+
+error:
+	if (error_offset)
+		*error_offset = s->offset + bad;
+	return 0;
+}
+
+// Fails if an odd digit is left over
+int hex_decode_final(struct hex_stream *s, size_t *error_offset)
+{
+	if (!s->has_carry)
+		return 1;
+	if (error_offset)
+		*error_offset = s->offset;
+	return 0;
+}
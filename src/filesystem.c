@@ -75,6 +75,78 @@ struct fs_file fs_file_read(char *path, enum fs_mode mode)
 	return result;
 }
 
+/**
+ * Map the file at path into memory instead of reading it. The
+ * mapping is private, writes to data are never written back to
+ * the file. Has to be released with fs_file_unmap().
+ *
+ * @return {struct fs_file}: data is NULL on failure or if the
+ * file is empty.
+ */
+struct fs_file fs_file_map(char *path)
+{
+	struct fs_file result = {0};
+
+#ifdef _SDX_UNIX
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return result;
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size == 0) {
+		close(fd);
+		return result;
+	}
+
+	void *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return result;
+
+	result.data = data;
+	result.size = st.st_size;
+#elif defined _SDX_WINDOWS
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return result;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return result;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+		return result;
+
+	void *data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(mapping);
+	if (data == NULL)
+		return result;
+
+	result.data = data;
+	result.size = (size_t)size.QuadPart;
+#endif
+
+	return result;
+}
+
+void fs_file_unmap(struct fs_file *file)
+{
+	if (file->data == NULL)
+		return;
+
+#ifdef _SDX_UNIX
+	munmap(file->data, file->size);
+#elif defined _SDX_WINDOWS
+	UnmapViewOfFile(file->data);
+#endif
+	file->data = NULL;
+	file->size = 0;
+}
+
 /**
  * This function writes the data to the file at path
  *
@@ -0,0 +1,623 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "glob_pattern.h"
+#include "intern.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum glob_token_type {
+	GLOB_TOKEN_BYTE,
+	GLOB_TOKEN_SET,		// '?' and classes
+	GLOB_TOKEN_STAR,
+	GLOB_TOKEN_GLOBSTAR,	// only with GLOB_PATHNAME
+};
+
+struct glob_token {
+	int type;
+	int skip;		// globstar followed by a '/' that may be skipped with it
+	unsigned char byte;
+	uint64 set[4];
+};
+
+static int glob_token_takes(const struct glob_token *t, unsigned char c)
+{
+	if (t->type == GLOB_TOKEN_BYTE)
+		return t->byte == c;
+	if (t->type == GLOB_TOKEN_SET)
+		return (t->set[c >> 6] >> (c & 63)) & 1;
+	return 0;
+}
+
+static void glob_set_range(uint64 *set, unsigned char lo, unsigned char hi)
+{
+	for (unsigned c = lo; c <= hi; c++)
+		set[c >> 6] |= 1ULL << (c & 63);
+}
+
+static size_t glob_star_run(const char *p, size_t i, size_t len)
+{
+	size_t end = i;
+	while (end < len && p[end] == '*')
+		end++;
+	return end - i;
+}
+
+/*
+ * Parses a class starting at p[i] == '['. Returns the index after the
+ * closing ']' or 0 if there is none, the '[' is a plain byte then.
+ */
+static size_t glob_parse_class(const char *p, size_t i, size_t len, uint64 *set)
+{
+	size_t j = i + 1;
+	int negate = 0, first = 1;
+	if (j < len && (p[j] == '!' || p[j] == '^')) {
+		negate = 1;
+		j++;
+	}
+
+	memset(set, 0, 4 * sizeof(uint64));
+	while (j < len && (p[j] != ']' || first)) {
+		unsigned char lo = p[j];
+		if (lo == '\\' && j + 1 < len)
+			lo = p[++j];
+		if (j + 2 < len && p[j + 1] == '-' && p[j + 2] != ']') {
+			j += 2;
+			unsigned char hi = p[j];
+			if (hi == '\\' && j + 1 < len)
+				hi = p[++j];
+			if (lo <= hi)
+				glob_set_range(set, lo, hi);
+		} else {
+			glob_set_range(set, lo, lo);
+		}
+		j++;
+		first = 0;
+	}
+	if (j >= len)
+		return 0;
+
+	if (negate)
+		for (int k = 0; k < 4; k++)
+			set[k] = ~set[k];
+	return j + 1;
+}
+
+static int glob_push(struct array *tokens, struct glob_token *t)
+{
+	struct glob_token *slot = array_alloc(tokens);
+	if (slot == NULL)
+		return 0;
+	*slot = *t;
+	return 1;
+}
+
+static int glob_tokenize(const char *p, size_t len, int flags, struct array *tokens)
+{
+	int pathname = flags & GLOB_PATHNAME;
+	size_t i = 0;
+
+	while (i < len) {
+		struct glob_token t;
+		memset(&t, 0, sizeof(t));
+		t.type = GLOB_TOKEN_BYTE;
+		t.byte = p[i];
+
+		if (p[i] == '*') {
+			size_t run = glob_star_run(p, i, len);
+			int component = (i == 0 || p[i - 1] == '/') && (i + run == len || p[i + run] == '/');
+			t.type = GLOB_TOKEN_STAR;
+			i += run;
+			if (pathname && run >= 2 && component) {
+				t.type = GLOB_TOKEN_GLOBSTAR;
+				if (i < len) {
+					// "**/" and the '/' after it, repeats collapse into one
+					t.skip = 1;
+					i++;
+					while ((run = glob_star_run(p, i, len)) >= 2 && i + run < len && p[i + run] == '/')
+						i += run + 1;
+					if (!glob_push(tokens, &t))
+						return 0;
+					memset(&t, 0, sizeof(t));
+					t.type = GLOB_TOKEN_BYTE;
+					t.byte = '/';
+				}
+			}
+		} else if (p[i] == '?') {
+			t.type = GLOB_TOKEN_SET;
+			memset(t.set, 0xff, sizeof(t.set));
+			i++;
+		} else if (p[i] == '[') {
+			size_t end = glob_parse_class(p, i, len, t.set);
+			if (end) {
+				t.type = GLOB_TOKEN_SET;
+				i = end;
+			} else {
+				i++;
+			}
+		} else if (p[i] == '\\' && i + 1 < len) {
+			t.byte = p[i + 1];
+			i += 2;
+		} else {
+			i++;
+		}
+
+		if (t.type == GLOB_TOKEN_SET && pathname)
+			t.set['/' >> 6] &= ~(1ULL << ('/' & 63));
+		if (!glob_push(tokens, &t))
+			return 0;
+	}
+	return 1;
+}
+
+// The '/' of a "**/" pair is optional, it never goes into a literal
+static int glob_is_literal(const struct glob_token *tokens, size_t i)
+{
+	return tokens[i].type == GLOB_TOKEN_BYTE && !(i > 0 && tokens[i - 1].skip);
+}
+
+static void glob_bit(uint64 *set, size_t i)
+{
+	set[i >> 6] |= 1ULL << (i & 63);
+}
+
+static void glob_shift(uint64 *out, const uint64 *in, size_t words, int by)
+{
+	uint64 carry = 0;
+	for (size_t w = 0; w < words; w++) {
+		uint64 v = in[w];
+		out[w] = (v << by) | carry;
+		carry = v >> (64 - by);
+	}
+}
+
+/*
+ * One input byte. Bits that arrive by taking the byte may jump over a
+ * "**" pair, bits that stay on a star may not, the star has taken
+ * something then and the pair must end in a real '/'. Any bit on a
+ * star also enables the token after it.
+ */
+static void glob_step(const struct glob_pattern *glob, uint64 *state, uint64 *tmp, unsigned char c)
+{
+	size_t words = glob->words;
+	const uint64 *row = glob->rows + glob->classes[c] * words;
+	const uint64 *loop = c == '/' ? glob->loop_slash : glob->loop;
+
+	for (size_t w = 0; w < words; w++)
+		tmp[w] = state[w] & row[w];
+	glob_shift(tmp, tmp, words, 1);
+	for (size_t w = 0; w < words; w++) {
+		state[w] &= loop[w];
+		tmp[w + words] = tmp[w] & glob->skip[w];
+	}
+	glob_shift(tmp + words, tmp + words, words, 2);
+	for (size_t w = 0; w < words; w++) {
+		state[w] |= tmp[w] | tmp[w + words];
+		tmp[w] = state[w] & glob->loop[w];
+	}
+	glob_shift(tmp, tmp, words, 1);
+	for (size_t w = 0; w < words; w++)
+		state[w] |= tmp[w];
+}
+
+static int glob_run(const struct glob_pattern *glob, const unsigned char *p, size_t len)
+{
+	if (glob->words == 1) {
+		uint64 state = glob->start[0], skip = glob->skip[0];
+		uint64 loop = glob->loop[0], loop_slash = glob->loop_slash[0];
+		for (size_t i = 0; i < len && state; i++) {
+			uint64 arrive = (state & glob->rows[glob->classes[p[i]]]) << 1;
+			state = arrive | ((arrive & skip) << 2) | (state & (p[i] == '/' ? loop_slash : loop));
+			state |= (state & loop) << 1;
+		}
+		return (state >> glob->tokens) & 1;
+	}
+
+	uint64 state[GLOB_MAX_TOKENS / 64 + 1];
+	uint64 tmp[2 * (GLOB_MAX_TOKENS / 64 + 1)];
+	memcpy(state, glob->start, glob->words * sizeof(uint64));
+	for (size_t i = 0; i < len; i++)
+		glob_step(glob, state, tmp, p[i]);
+	return (state[glob->tokens >> 6] >> (glob->tokens & 63)) & 1;
+}
+
+static int glob_build_nfa(struct glob_pattern *glob, const struct glob_token *tokens, size_t count)
+{
+	size_t words = (count + 1 + 63) / 64;
+	uint64 *byte_rows = calloc(256 * words, sizeof(uint64));
+	if (byte_rows == NULL)
+		return 0;
+
+	for (int c = 0; c < 256; c++)
+		for (size_t i = 0; i < count; i++)
+			if (glob_token_takes(&tokens[i], c))
+				glob_bit(byte_rows + c * words, i);
+
+	// Bytes with the same row share it, like the columns of mp_build()
+	size_t row_count = 0;
+	for (int c = 0; c < 256; c++) {
+		size_t r = 0;
+		while (r < row_count && memcmp(byte_rows + r * words, byte_rows + c * words, words * sizeof(uint64)) != 0)
+			r++;
+		if (r == row_count)
+			memmove(byte_rows + row_count++ * words, byte_rows + c * words, words * sizeof(uint64));
+		glob->classes[c] = r;
+	}
+
+	glob->rows = calloc((row_count + 4) * words, sizeof(uint64));
+	if (glob->rows == NULL) {
+		free(byte_rows);
+		return 0;
+	}
+	memcpy(glob->rows, byte_rows, row_count * words * sizeof(uint64));
+	free(byte_rows);
+
+	glob->tokens = count;
+	glob->words = words;
+	glob->loop = glob->rows + row_count * words;
+	glob->loop_slash = glob->loop + words;
+	glob->skip = glob->loop_slash + words;
+	glob->start = glob->skip + words;
+
+	for (size_t i = 0; i < count; i++) {
+		if (tokens[i].type == GLOB_TOKEN_STAR || tokens[i].type == GLOB_TOKEN_GLOBSTAR) {
+			glob_bit(glob->loop, i);
+			if (tokens[i].type == GLOB_TOKEN_GLOBSTAR || !(glob->flags & GLOB_PATHNAME))
+				glob_bit(glob->loop_slash, i);
+		}
+		if (tokens[i].skip)
+			glob_bit(glob->skip, i);
+	}
+
+	uint64 tmp[GLOB_MAX_TOKENS / 64 + 1];
+	glob->start[0] = 1;
+	memcpy(tmp, glob->start, words * sizeof(uint64));
+	for (size_t w = 0; w < words; w++)
+		tmp[w] &= glob->skip[w];
+	glob_shift(tmp, tmp, words, 2);
+	for (size_t w = 0; w < words; w++)
+		glob->start[w] |= tmp[w];
+	for (size_t w = 0; w < words; w++)
+		tmp[w] = glob->start[w] & glob->loop[w];
+	glob_shift(tmp, tmp, words, 1);
+	for (size_t w = 0; w < words; w++)
+		glob->start[w] |= tmp[w];
+	return 1;
+}
+
+/**
+ * Compiles a pattern, the pattern is not referenced afterwards.
+ * @param {struct glob_pattern*} glob: Output
+ * @param {string_view} pattern: The glob, an unterminated '[' is a plain byte
+ * @param {int} flags: 0 or GLOB_PATHNAME
+ * @return {int}: 1 on success, 0 on allocation failure or when the part
+ * between the literal prefix and suffix has more than GLOB_MAX_TOKENS tokens
+ */
+int glob_compile(struct glob_pattern *glob, string_view pattern, int flags)
+{
+	struct array array;
+	memset(glob, 0, sizeof(*glob));
+	glob->flags = flags;
+	if (!array_init(&array, sizeof(struct glob_token), 0))
+		return 0;
+	if (!glob_tokenize(pattern.data, pattern.len, flags, &array)) {
+		array_free(&array);
+		return 0;
+	}
+
+	const struct glob_token *tokens = (const struct glob_token*)array.data;
+	size_t count = array.index;
+	size_t prefix = 0, suffix = 0;
+	while (prefix < count && glob_is_literal(tokens, prefix))
+		prefix++;
+	while (prefix < count && suffix < count - prefix && glob_is_literal(tokens, count - suffix - 1))
+		suffix++;
+
+	glob->prefix_len = prefix;
+	glob->suffix_len = suffix;
+	glob->literal = malloc(prefix + suffix + 1);
+	if (glob->literal == NULL)
+		goto error;
+	for (size_t i = 0; i < prefix; i++)
+		glob->literal[i] = tokens[i].byte;
+	for (size_t i = 0; i < suffix; i++)
+		glob->literal[prefix + i] = tokens[count - suffix + i].byte;
+
+	size_t middle = count - prefix - suffix;
+	const struct glob_token *mid = tokens + prefix;
+	if (middle == 0) {
+		glob->kind = GLOB_KIND_LITERAL;
+	} else if (middle == 1 && (mid->type == GLOB_TOKEN_STAR || mid->type == GLOB_TOKEN_GLOBSTAR)) {
+		glob->kind = GLOB_KIND_STAR;
+		glob->globstar = mid->type == GLOB_TOKEN_GLOBSTAR || !(flags & GLOB_PATHNAME);
+	} else {
+		glob->kind = GLOB_KIND_NFA;
+		if (middle > GLOB_MAX_TOKENS || !glob_build_nfa(glob, mid, middle))
+			goto error;
+	}
+
+	array_free(&array);
+	return 1;
+error:
+	array_free(&array);
+	glob_free(glob);
+	return 0;
+}
+
+int glob_match(const struct glob_pattern *glob, string_view path)
+{
+	size_t prefix = glob->prefix_len, suffix = glob->suffix_len;
+	if (path.len < prefix + suffix)
+		return 0;
+	if ((prefix && memcmp(path.data, glob->literal, prefix) != 0) ||
+	    (suffix && memcmp(path.data + path.len - suffix, glob->literal + prefix, suffix) != 0))
+		return 0;
+
+	const unsigned char *middle = (const unsigned char*)path.data + prefix;
+	size_t len = path.len - prefix - suffix;
+	switch (glob->kind) {
+	case GLOB_KIND_LITERAL:
+		return len == 0;
+	case GLOB_KIND_STAR:
+		return glob->globstar || len == 0 || memchr(middle, '/', len) == NULL;
+	default:
+		return glob_run(glob, middle, len);
+	}
+}
+
+void glob_free(struct glob_pattern *glob)
+{
+	free(glob->literal);
+	free(glob->rows);
+	memset(glob, 0, sizeof(*glob));
+}
+
+struct glob_run {
+	uint32 pattern;
+	uint32 id;	// interned bytes of the run
+};
+
+/*
+ * Interns every literal run of a pattern (the maximal stretches of
+ * plain bytes) and records them in runs.
+ */
+static int glob_add_runs(string_view pattern, int flags, uint32 index, struct array *tokens,
+			 struct array *bytes, struct intern *in, struct array *runs)
+{
+	tokens->index = 0;
+	if (!glob_tokenize(pattern.data, pattern.len, flags, tokens))
+		return 0;
+
+	const struct glob_token *t = (const struct glob_token*)tokens->data;
+	for (size_t i = 0; i < tokens->index;) {
+		bytes->index = 0;
+		while (i < tokens->index && glob_is_literal(t, i)) {
+			unsigned char *slot = array_alloc(bytes);
+			if (slot == NULL)
+				return 0;
+			*slot = t[i++].byte;
+		}
+		if (bytes->index == 0) {
+			i++;
+			continue;
+		}
+
+		struct glob_run *run = array_alloc(runs);
+		if (run == NULL)
+			return 0;
+		run->pattern = index;
+		run->id = intern(in, sv_from_parts((char*)bytes->data, bytes->index));
+		if (run->id == INTERN_INVALID_ID)
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Picks the literal each pattern is looked up by. A run that many
+ * patterns share ("src/", ".c") lets most of them through for most
+ * paths, so the run shared by the fewest patterns wins. Runs shorter
+ * than 3 bytes only win if there is nothing else, the longer one wins
+ * a tie.
+ */
+static int glob_pick_literals(struct glob_set *set, struct strvec *patterns, int flags, struct strvec *literals)
+{
+	struct array tokens, bytes, runs;
+	struct intern in;
+	uint32 *shared = NULL;
+	int ok = 0;
+
+	if (!intern_init(&in))
+		return 0;
+	array_init(&tokens, sizeof(struct glob_token), 0);
+	array_init(&bytes, 1, 0);
+	array_init(&runs, sizeof(struct glob_run), 0);
+
+	for (size_t i = 0; i < set->count; i++)
+		if (!glob_add_runs(strvec_get_sv(patterns, i), flags, i, &tokens, &bytes, &in, &runs))
+			goto done;
+
+	const struct glob_run *r = (const struct glob_run*)runs.data;
+	shared = calloc(intern_count(&in) + 1, sizeof(uint32));
+	if (shared == NULL)
+		goto done;
+	for (size_t k = 0; k < runs.index; k++)
+		shared[r[k].id]++;
+
+	size_t k = 0;
+	for (size_t i = 0; i < set->count; i++) {
+		string_view best = { NULL, 0 };
+		uint32 best_shared = 0;
+		for (; k < runs.index && r[k].pattern == i; k++) {
+			string_view sv = intern_get(&in, r[k].id);
+			int short_run = sv.len < 3, best_short = best.len < 3;
+			if (best.len == 0 || (best_short && !short_run) ||
+			    (short_run == best_short && (shared[r[k].id] < best_shared ||
+			     (shared[r[k].id] == best_shared && sv.len > best.len)))) {
+				best = sv;
+				best_shared = shared[r[k].id];
+			}
+		}
+
+		// mp_build() skips the empty ones, their index stays in step
+		if (strvec_push_len(literals, best.data ? best.data : "", best.len) < 0)
+			goto done;
+		if (best.len == 0 && strvec_get_sv(patterns, i).data != NULL) {
+			size_t *slot = array_alloc(&set->unfiltered);
+			if (slot == NULL)
+				goto done;
+			*slot = i;
+		}
+	}
+	ok = 1;
+
+done:
+	free(shared);
+	intern_free(&in);
+	array_free(&tokens);
+	array_free(&bytes);
+	array_free(&runs);
+	return ok;
+}
+
+/**
+ * Compiles every pattern of the strvec, cleared strings never match.
+ * @return {int}: 1 on success, 0 if a pattern does not compile or on
+ * allocation failure
+ */
+int glob_set_build(struct glob_set *set, struct strvec *patterns, int flags)
+{
+	struct strvec literals;
+	memset(set, 0, sizeof(*set));
+	set->count = strvec_count(patterns);
+	set->patterns = calloc(set->count ? set->count : 1, sizeof(struct glob_pattern));
+	if (set->patterns == NULL || !array_init(&set->unfiltered, sizeof(size_t), 0)) {
+		free(set->patterns);
+		return 0;
+	}
+	if (!strvec_init(&literals)) {
+		glob_set_free(set);
+		return 0;
+	}
+
+	int ok = 1;
+	for (size_t i = 0; i < set->count && ok; i++)
+		ok = glob_compile(&set->patterns[i], strvec_get_sv(patterns, i), flags);
+	if (ok)
+		ok = glob_pick_literals(set, patterns, flags, &literals);
+	if (ok)
+		ok = mp_build(&set->literals, &literals);
+	strvec_delete_struct(&literals);
+	if (!ok)
+		glob_set_free(set);
+	return ok;
+}
+
+struct glob_set_scan {
+	const struct glob_set *set;
+	string_view path;
+	struct array *out;	// NULL when any match will do
+	size_t first;		// first entry of out added by this scan
+	int found;
+	int failed;
+};
+
+static int glob_set_check(struct glob_set_scan *scan, size_t pattern)
+{
+	if (scan->out) {
+		const size_t *seen = (const size_t*)scan->out->data;
+		for (size_t i = scan->first; i < scan->out->index; i++)
+			if (seen[i] == pattern)
+				return 0;
+	}
+	if (!glob_match(&scan->set->patterns[pattern], scan->path))
+		return 0;
+
+	scan->found = 1;
+	if (scan->out == NULL)
+		return 1;
+	size_t *slot = array_alloc(scan->out);
+	if (slot == NULL) {
+		scan->failed = 1;
+		return 1;
+	}
+	*slot = pattern;
+	return 0;
+}
+
+static int glob_set_candidate(void *ctx, size_t pattern, size_t offset)
+{
+	(void)offset;
+	return glob_set_check(ctx, pattern);
+}
+
+static int glob_index_compare(const void *a, const void *b)
+{
+	size_t x = *(const size_t*)a, y = *(const size_t*)b;
+	return (x > y) - (x < y);
+}
+
+static void glob_set_scan(struct glob_set_scan *scan)
+{
+	const struct glob_set *set = scan->set;
+	mp_scan(&set->literals, scan->path, glob_set_candidate, scan);
+
+	const size_t *unfiltered = (const size_t*)set->unfiltered.data;
+	for (size_t i = 0; i < set->unfiltered.index && !(scan->found && !scan->out) && !scan->failed; i++)
+		glob_set_check(scan, unfiltered[i]);
+}
+
+/**
+ * Appends the index of every pattern matching path to out, sorted.
+ * @param {struct array*} out: Array of size_t
+ * @return {int}: 1 on success, 0 on allocation failure
+ */
+int glob_set_matches(const struct glob_set *set, string_view path, struct array *out)
+{
+	struct glob_set_scan scan = { set, path, out, out->index, 0, 0 };
+	glob_set_scan(&scan);
+	if (scan.failed)
+		return 0;
+	qsort((size_t*)out->data + scan.first, out->index - scan.first, sizeof(size_t), glob_index_compare);
+	return 1;
+}
+
+// 1 if any pattern matches path, stops at the first one found
+int glob_set_any(const struct glob_set *set, string_view path)
+{
+	struct glob_set_scan scan = { set, path, NULL, 0, 0, 0 };
+	glob_set_scan(&scan);
+	return scan.found;
+}
+
+void glob_set_free(struct glob_set *set)
+{
+	for (size_t i = 0; i < set->count && set->patterns; i++)
+		glob_free(&set->patterns[i]);
+	free(set->patterns);
+	mp_free(&set->literals);
+	array_free(&set->unfiltered);
+	memset(set, 0, sizeof(*set));
+}
@@ -0,0 +1,407 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "hash.h"
+#include "extra.h"
+#include <string.h>
+
+#if defined(_SDX_AVX2)
+#include <immintrin.h>
+#elif defined(_SDX_SSE2)
+#include <emmintrin.h>
+#endif
+
+// wyhash constants, used for the short keys
+#define HASH_P0 0xa0761d6478bd642fULL
+#define HASH_P1 0xe7037ed1a0b428dbULL
+#define HASH_P2 0x8ebc6af09c88c6e3ULL
+#define HASH_P3 0x589965cc75374cc3ULL
+
+#define HASH_PRIME32_1 0x9e3779b1U
+#define HASH_PRIME32_2 0x85ebca77U
+#define HASH_PRIME32_3 0xc2b2ae3dU
+#define HASH_PRIME64_1 0x9e3779b185ebca87ULL
+#define HASH_PRIME64_2 0xc2b2ae3d27d4eb4fULL
+#define HASH_PRIME64_3 0x165667b19e3779f9ULL
+#define HASH_PRIME64_4 0x85ebca77c2b2ae63ULL
+#define HASH_PRIME64_5 0x27d4eb2f165667c5ULL
+
+// Stripes between two scrambles of the accumulators
+#define HASH_BLOCK_STRIPES ((HASH_SECRET_LEN - HASH_STRIPE_LEN) / 8)
+
+/*
+ * Random bytes (splitmix64), the seed is mixed into a copy of it. Stripe
+ * n of a block is keyed with the 64 bytes at 8 * n.
+ */
+static const unsigned char hash_default_secret[HASH_SECRET_LEN] = {
+	0xdc, 0xa4, 0x85, 0x3a, 0x16, 0x6b, 0xe1, 0xc0, 0x7c, 0xc4, 0x43, 0xd4,
+	0x8d, 0xcd, 0x0a, 0x89, 0x61, 0x77, 0xc4, 0x6d, 0x8a, 0x9d, 0x88, 0xb3,
+	0x6a, 0xae, 0xf0, 0x28, 0xe5, 0x98, 0x03, 0x6a, 0x5e, 0x85, 0x8a, 0xe4,
+	0xec, 0x44, 0x83, 0x04, 0x30, 0x13, 0x87, 0x21, 0xea, 0xcf, 0x75, 0xf1,
+	0xfd, 0xc2, 0x02, 0x27, 0xf0, 0xee, 0x1c, 0x39, 0x12, 0xcb, 0x84, 0x47,
+	0xac, 0x8c, 0xaf, 0x4b, 0x8e, 0xf8, 0xa3, 0x83, 0x45, 0x74, 0x47, 0x35,
+	0x0e, 0xc9, 0xb6, 0xc6, 0x15, 0x2b, 0xcf, 0xd9, 0x1c, 0xe2, 0x5f, 0x6d,
+	0xc7, 0xac, 0x1f, 0x96, 0xf9, 0x11, 0x0f, 0xd5, 0x49, 0xab, 0x94, 0x00,
+	0xdc, 0xb6, 0xbe, 0xbd, 0x37, 0x1e, 0x21, 0xe3, 0x1a, 0x51, 0xf3, 0x4f,
+	0x27, 0x6c, 0xfe, 0x62, 0x74, 0x05, 0xdf, 0x9f, 0x32, 0x0b, 0xc3, 0x5a,
+	0x06, 0xb4, 0x65, 0x6b, 0x2c, 0x58, 0x50, 0x14, 0x91, 0xb7, 0x8e, 0x88,
+	0xc7, 0xfc, 0x30, 0x7a, 0x6e, 0x57, 0x15, 0x6a, 0xba, 0xf5, 0x40, 0x55,
+	0xe9, 0xd3, 0x96, 0x90, 0x55, 0xf0, 0xce, 0x16, 0x99, 0x48, 0x87, 0x06,
+	0x4b, 0xf1, 0xf8, 0x2c, 0x03, 0xe1, 0x2c, 0x6e, 0x3b, 0x26, 0xc9, 0xc9,
+	0x6d, 0xaa, 0x9f, 0x0a, 0x0b, 0x92, 0xff, 0xd6, 0xc1, 0x8d, 0x99, 0xdb,
+	0x97, 0x26, 0x19, 0x53, 0xd7, 0x18, 0xcd, 0xc7, 0x9b, 0x9b, 0xea, 0x73,
+};
+
+static const uint64 hash_init_acc[8] = {
+	HASH_PRIME32_3, HASH_PRIME64_1, HASH_PRIME64_2, HASH_PRIME64_3,
+	HASH_PRIME64_4, HASH_PRIME32_2, HASH_PRIME64_5, HASH_PRIME32_1,
+};
+
+static inline uint64 hash_read64(const unsigned char *p)
+{
+	uint64 v;
+	memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+static inline uint64 hash_read32(const unsigned char *p)
+{
+	uint32 v;
+	memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap32(v);
+#endif
+	return v;
+}
+
+static inline void hash_write64(unsigned char *p, uint64 v)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	memcpy(p, &v, sizeof(v));
+}
+
+// 64x64 -> 128 bit multiply, low half in *a and high half in *b
+static inline void hash_mum(uint64 *a, uint64 *b)
+{
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 r = (unsigned __int128)*a * *b;
+	*a = (uint64)r;
+	*b = (uint64)(r >> 64);
+#else
+	uint64 a_lo = (uint32)*a, a_hi = *a >> 32;
+	uint64 b_lo = (uint32)*b, b_hi = *b >> 32;
+	uint64 p0 = a_lo * b_lo, p1 = a_lo * b_hi;
+	uint64 p2 = a_hi * b_lo, p3 = a_hi * b_hi;
+	uint64 mid = (p0 >> 32) + (uint32)p1 + (uint32)p2;
+	*a = (mid << 32) | (uint32)p0;
+	*b = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+#endif
+}
+
+static inline uint64 hash_mix(uint64 a, uint64 b)
+{
+	hash_mum(&a, &b);
+	return a ^ b;
+}
+
+/*
+ * Keys up to HASH_SHORT_MAX bytes. 4 to 16 bytes are read with
+ * overlapping loads and no branch on the length, longer keys are mixed
+ * 16 or 48 bytes at a time and finish with the last 16 bytes.
+ */
+static uint64 hash_short(const unsigned char *p, size_t len, uint64 seed)
+{
+	uint64 a, b;
+
+	seed ^= hash_mix(seed ^ HASH_P0, HASH_P1);
+	if (len <= 16) {
+		if (len >= 4) {
+			size_t mid = (len >> 3) << 2;
+			a = (hash_read32(p) << 32) | hash_read32(p + mid);
+			b = (hash_read32(p + len - 4) << 32) | hash_read32(p + len - 4 - mid);
+		} else if (len > 0) {
+			a = ((uint64)p[0] << 16) | ((uint64)p[len >> 1] << 8) | p[len - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = len;
+		if (i > 48) {
+			uint64 seed1 = seed, seed2 = seed;
+			do {
+				seed = hash_mix(hash_read64(p) ^ HASH_P1, hash_read64(p + 8) ^ seed);
+				seed1 = hash_mix(hash_read64(p + 16) ^ HASH_P2, hash_read64(p + 24) ^ seed1);
+				seed2 = hash_mix(hash_read64(p + 32) ^ HASH_P3, hash_read64(p + 40) ^ seed2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= seed1 ^ seed2;
+		}
+		while (i > 16) {
+			seed = hash_mix(hash_read64(p) ^ HASH_P1, hash_read64(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+		a = hash_read64(p + i - 16);
+		b = hash_read64(p + i - 8);
+	}
+
+	a ^= HASH_P1;
+	b ^= seed;
+	hash_mum(&a, &b);
+	return hash_mix(a ^ HASH_P0 ^ len, b ^ HASH_P1);
+}
+
+/*
+ * One 64 byte stripe into the 8 lanes: every lane adds the product of
+ * the two 32 bit halves of data ^ key, and the raw data of its neighbour
+ * so no input bit is lost when a product is 0.
+ */
+static inline void hash_accumulate_stripe(uint64 *acc, const unsigned char *p, const unsigned char *key)
+{
+#if defined(_SDX_AVX2)
+	for (int i = 0; i < 2; i++) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)(acc + 4 * i));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(p + 32 * i));
+		__m256i k = _mm256_loadu_si256((const __m256i*)(key + 32 * i));
+		__m256i dk = _mm256_xor_si256(d, k);
+		__m256i product = _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32));
+		__m256i swapped = _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+		a = _mm256_add_epi64(a, _mm256_add_epi64(product, swapped));
+		_mm256_storeu_si256((__m256i*)(acc + 4 * i), a);
+	}
+#elif defined(_SDX_SSE2)
+	for (int i = 0; i < 4; i++) {
+		__m128i a = _mm_loadu_si128((const __m128i*)(acc + 2 * i));
+		__m128i d = _mm_loadu_si128((const __m128i*)(p + 16 * i));
+		__m128i k = _mm_loadu_si128((const __m128i*)(key + 16 * i));
+		__m128i dk = _mm_xor_si128(d, k);
+		__m128i product = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+		__m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+		a = _mm_add_epi64(a, _mm_add_epi64(product, swapped));
+		_mm_storeu_si128((__m128i*)(acc + 2 * i), a);
+	}
+#else
+	for (int i = 0; i < 8; i++) {
+		uint64 d = hash_read64(p + 8 * i);
+		uint64 dk = d ^ hash_read64(key + 8 * i);
+		acc[i ^ 1] += d;
+		acc[i] += (dk & 0xffffffff) * (dk >> 32);
+	}
+#endif
+}
+
+// Folds the high bits back in so the multiplies keep mixing them
+static inline void hash_scramble(uint64 *acc, const unsigned char *key)
+{
+#if defined(_SDX_AVX2)
+	__m256i prime = _mm256_set1_epi32(HASH_PRIME32_1);
+	for (int i = 0; i < 2; i++) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)(acc + 4 * i));
+		__m256i k = _mm256_loadu_si256((const __m256i*)(key + 32 * i));
+		a = _mm256_xor_si256(_mm256_xor_si256(a, _mm256_srli_epi64(a, 47)), k);
+		__m256i lo = _mm256_mul_epu32(a, prime);
+		__m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+		_mm256_storeu_si256((__m256i*)(acc + 4 * i), _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+	}
+#elif defined(_SDX_SSE2)
+	__m128i prime = _mm_set1_epi32(HASH_PRIME32_1);
+	for (int i = 0; i < 4; i++) {
+		__m128i a = _mm_loadu_si128((const __m128i*)(acc + 2 * i));
+		__m128i k = _mm_loadu_si128((const __m128i*)(key + 16 * i));
+		a = _mm_xor_si128(_mm_xor_si128(a, _mm_srli_epi64(a, 47)), k);
+		__m128i lo = _mm_mul_epu32(a, prime);
+		__m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+		_mm_storeu_si128((__m128i*)(acc + 2 * i), _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+	}
+#else
+	for (int i = 0; i < 8; i++) {
+		uint64 a = acc[i];
+		a ^= a >> 47;
+		a ^= hash_read64(key + 8 * i);
+		acc[i] = a * HASH_PRIME32_1;
+	}
+#endif
+}
+
+// Accumulates count stripes, *stripes is the position in the current block
+static void hash_accumulate(uint64 *acc, const unsigned char *p, size_t count,
+			    const unsigned char *secret, size_t *stripes)
+{
+	for (size_t i = 0; i < count; i++) {
+		PREFETCH(p + 384, 0)
+		hash_accumulate_stripe(acc, p, secret + *stripes * 8);
+		p += HASH_STRIPE_LEN;
+		if (++*stripes == HASH_BLOCK_STRIPES) {
+			hash_scramble(acc, secret + HASH_SECRET_LEN - HASH_STRIPE_LEN);
+			*stripes = 0;
+		}
+	}
+}
+
+static uint64 hash_merge(const uint64 *acc, const unsigned char *secret, uint64 len)
+{
+	uint64 result = len * HASH_PRIME64_1;
+	for (int i = 0; i < 4; i++)
+		result += hash_mix(acc[2 * i] ^ hash_read64(secret + 11 + 16 * i),
+				   acc[2 * i + 1] ^ hash_read64(secret + 19 + 16 * i));
+
+	result ^= result >> 37;
+	result *= 0x165667919e3779f9ULL;
+	return result ^ (result >> 32);
+}
+
+static void hash_derive_secret(unsigned char *secret, uint64 seed)
+{
+	for (size_t i = 0; i < HASH_SECRET_LEN; i += 16) {
+		hash_write64(secret + i, hash_read64(hash_default_secret + i) + seed);
+		hash_write64(secret + i + 8, hash_read64(hash_default_secret + i + 8) - seed);
+	}
+}
+
+// The last stripe always ends at the end of the input, overlapping the previous ones
+static inline void hash_last_stripe(uint64 *acc, const unsigned char *p, const unsigned char *secret)
+{
+	hash_accumulate_stripe(acc, p, secret + HASH_SECRET_LEN - HASH_STRIPE_LEN - 7);
+}
+
+static uint64 hash_long(const unsigned char *p, size_t len, uint64 seed)
+{
+	unsigned char derived[HASH_SECRET_LEN];
+	const unsigned char *secret = hash_default_secret;
+	uint64 acc[8];
+	size_t stripes = 0;
+
+	if (seed != 0) {
+		hash_derive_secret(derived, seed);
+		secret = derived;
+	}
+
+	memcpy(acc, hash_init_acc, sizeof(acc));
+	hash_accumulate(acc, p, (len - 1) / HASH_STRIPE_LEN, secret, &stripes);
+	hash_last_stripe(acc, p + len - HASH_STRIPE_LEN, secret);
+
+	return hash_merge(acc, secret, len);
+}
+
+/**
+ * Hash len bytes at data
+ *
+ * @param {uint64} seed: different seeds give unrelated hashes
+ */
+uint64 hash64(const void *data, size_t len, uint64 seed)
+{
+	if (len <= HASH_SHORT_MAX)
+		return hash_short(data, len, seed);
+
+	return hash_long(data, len, seed);
+}
+
+uint64 sv_hash64(string_view sv, uint64 seed)
+{
+	return hash64(sv.data, sv.len, seed);
+}
+
+void hash_init(struct hash_state *state, uint64 seed)
+{
+	memcpy(state->acc, hash_init_acc, sizeof(state->acc));
+	hash_derive_secret(state->secret, seed);
+	state->buffered = 0;
+	state->stripes = 0;
+	state->total_len = 0;
+	state->seed = seed;
+}
+
+/*
+ * The buffer is only consumed once more input follows it, so the last
+ * (overlapping) stripe of the input is still around in hash_final().
+ * When stripes are consumed straight from data, the last one is copied
+ * to the end of the buffer for the same reason.
+ */
+void hash_update(struct hash_state *state, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	state->total_len += len;
+
+	if (len <= HASH_SHORT_MAX - state->buffered) {
+		memcpy(state->buffer + state->buffered, p, len);
+		state->buffered += len;
+		return;
+	}
+
+	if (state->buffered > 0) {
+		size_t fill = HASH_SHORT_MAX - state->buffered;
+		memcpy(state->buffer + state->buffered, p, fill);
+		p += fill;
+		len -= fill;
+		hash_accumulate(state->acc, state->buffer, HASH_SHORT_MAX / HASH_STRIPE_LEN,
+				state->secret, &state->stripes);
+		state->buffered = 0;
+	}
+
+	if (len > HASH_SHORT_MAX) {
+		size_t count = (len - 1) / HASH_SHORT_MAX * (HASH_SHORT_MAX / HASH_STRIPE_LEN);
+		hash_accumulate(state->acc, p, count, state->secret, &state->stripes);
+		p += count * HASH_STRIPE_LEN;
+		len -= count * HASH_STRIPE_LEN;
+		memcpy(state->buffer + HASH_SHORT_MAX - HASH_STRIPE_LEN, p - HASH_STRIPE_LEN, HASH_STRIPE_LEN);
+	}
+
+	memcpy(state->buffer, p, len);
+	state->buffered = len;
+}
+
+/**
+ * Hash of everything passed to hash_update(), the state is not changed
+ * so more input can still be added.
+ */
+uint64 hash_final(const struct hash_state *state)
+{
+	if (state->total_len <= HASH_SHORT_MAX)
+		return hash_short(state->buffer, state->total_len, state->seed);
+
+	uint64 acc[8];
+	size_t stripes = state->stripes;
+	unsigned char last[HASH_STRIPE_LEN];
+
+	memcpy(acc, state->acc, sizeof(acc));
+	if (state->buffered >= HASH_STRIPE_LEN) {
+		hash_accumulate(acc, state->buffer, (state->buffered - 1) / HASH_STRIPE_LEN, state->secret, &stripes);
+		hash_last_stripe(acc, state->buffer + state->buffered - HASH_STRIPE_LEN, state->secret);
+	} else {
+		size_t catchup = HASH_STRIPE_LEN - state->buffered;
+		memcpy(last, state->buffer + HASH_SHORT_MAX - catchup, catchup);
+		memcpy(last + catchup, state->buffer, state->buffered);
+		hash_last_stripe(acc, last, state->secret);
+	}
+
+	return hash_merge(acc, state->secret, state->total_len);
+}
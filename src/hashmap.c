@@ -0,0 +1,403 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "hashmap.h"
+#include "hash.h"
+#include "extra.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_SDX_SSE2)
+#include <emmintrin.h>
+#endif
+
+#define HASHMAP_SEED 0x9e3779b97f4a7c15ull
+#define HASHMAP_OVERFLOW_MAX 255
+
+// Natural alignment of a type of this size, capped at 8
+static size_t hashmap_align(size_t size)
+{
+	if (size >= 8)
+		return 8;
+	if (size >= 4)
+		return 4;
+	if (size >= 2)
+		return 2;
+	return 1;
+}
+
+static int hashmap_setup(struct hashmap *map, size_t key_size, size_t value_size, int sv_keys)
+{
+	size_t key_align = hashmap_align(key_size);
+	size_t value_align = hashmap_align(value_size);
+	size_t slot_align = MAX(key_align, value_align);
+
+	memset(map, 0, sizeof(*map));
+	if (!key_size)
+		return 0;
+	map->key_size = key_size;
+	map->value_size = value_size;
+	map->value_offset = (key_size + value_align - 1) & ~(value_align - 1);
+	map->slot_size = (map->value_offset + value_size + slot_align - 1) & ~(slot_align - 1);
+	map->seed = HASHMAP_SEED;
+	map->sv_keys = sv_keys;
+	return 1;
+}
+
+/**
+ * @param {size_t} key_size: bytes per key, keys are hashed and compared as bytes
+ * @param {size_t} value_size: bytes per value, 0 gives a set
+ * @return {int}: 1 on success, 0 if key_size is 0
+ */
+int hashmap_init(struct hashmap *map, size_t key_size, size_t value_size)
+{
+	return hashmap_setup(map, key_size, value_size, 0);
+}
+
+// Keys are string_views, the viewed bytes are not copied
+int hashmap_init_sv(struct hashmap *map, size_t value_size)
+{
+	return hashmap_setup(map, sizeof(string_view), value_size, 1);
+}
+
+void hashmap_free(struct hashmap *map)
+{
+	free(map->ctrl);
+	map->ctrl = NULL;
+	map->overflow = NULL;
+	map->slots = NULL;
+	map->group_mask = 0;
+	map->count = 0;
+	map->growth_left = 0;
+}
+
+size_t hashmap_capacity(const struct hashmap *map)
+{
+	return map->ctrl ? (map->group_mask + 1) * HASHMAP_GROUP : 0;
+}
+
+static size_t hashmap_limit(size_t capacity)
+{
+	return capacity - capacity / 8;
+}
+
+static inline uint64 hashmap_hash(const struct hashmap *map, const void *key)
+{
+	if (map->sv_keys)
+		return sv_hash64(*(const string_view *)key, map->seed);
+	return hash64(key, map->key_size, map->seed);
+}
+
+static inline int hashmap_key_eq(const struct hashmap *map, const void *a, const void *b)
+{
+	if (map->sv_keys) {
+		const string_view *x = a, *y = b;
+		return x->len == y->len && (!x->len || !memcmp(x->data, y->data, x->len));
+	}
+	// The common integer keys without a call to memcmp
+	if (map->key_size == 8) {
+		uint64 x, y;
+		memcpy(&x, a, 8);
+		memcpy(&y, b, 8);
+		return x == y;
+	}
+	if (map->key_size == 4) {
+		uint32 x, y;
+		memcpy(&x, a, 4);
+		memcpy(&y, b, 4);
+		return x == y;
+	}
+	return !memcmp(a, b, map->key_size);
+}
+
+#if !defined(_SDX_SSE2)
+// High bit of every byte of x into one bit each, byte 0 into bit 0
+static inline uint32 hashmap_high_bits(uint64 x)
+{
+	return (uint32)((((x >> 7) & 0x0101010101010101ull) * 0x0102040810204080ull) >> 56);
+}
+
+// High bit set in every zero byte of x, exact unlike the usual
+// (x - 0x01..) & ~x which also flags bytes above a zero one
+static inline uint64 hashmap_zero_bytes(uint64 x)
+{
+	uint64 t = (x & 0x7f7f7f7f7f7f7f7full) + 0x7f7f7f7f7f7f7f7full;
+	return ~(t | x | 0x7f7f7f7f7f7f7f7full);
+}
+#endif
+
+// Bit i set when ctrl[i] == tag
+static inline uint32 hashmap_match(const unsigned char *ctrl, unsigned char tag)
+{
+#if defined(_SDX_SSE2)
+	__m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+	return (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+#else
+	uint64 lo, hi, pattern = 0x0101010101010101ull * tag;
+	memcpy(&lo, ctrl, 8);
+	memcpy(&hi, ctrl + 8, 8);
+	return hashmap_high_bits(hashmap_zero_bytes(lo ^ pattern)) |
+		hashmap_high_bits(hashmap_zero_bytes(hi ^ pattern)) << 8;
+#endif
+}
+
+// Bit i set when ctrl[i] is empty, the only control byte with the high bit
+static inline uint32 hashmap_match_empty(const unsigned char *ctrl)
+{
+#if defined(_SDX_SSE2)
+	return (uint32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+	uint64 lo, hi;
+	memcpy(&lo, ctrl, 8);
+	memcpy(&hi, ctrl + 8, 8);
+	return hashmap_high_bits(lo) | hashmap_high_bits(hi) << 8;
+#endif
+}
+
+static int hashmap_find(const struct hashmap *map, const void *key, uint64 hash, size_t *index)
+{
+	unsigned char tag = (unsigned char)(hash >> 57);
+	size_t group = hash & map->group_mask;
+	size_t step;
+
+	if (!map->ctrl)
+		return 0;
+
+	// Triangular steps visit every group once when the count is a power of 2
+	for (step = 0; step <= map->group_mask; step++) {
+		uint32 bits = hashmap_match(map->ctrl + group * HASHMAP_GROUP, tag);
+		while (bits) {
+			size_t i = group * HASHMAP_GROUP + CTZ32(bits);
+			if (hashmap_key_eq(map, map->slots + i * map->slot_size, key)) {
+				*index = i;
+				return 1;
+			}
+			bits &= bits - 1;
+		}
+		if (!map->overflow[group])
+			return 0;
+		group = (group + step + 1) & map->group_mask;
+	}
+	return 0;
+}
+
+// First empty slot on the probe path, counting the full groups passed.
+// There has to be one.
+static size_t hashmap_claim(struct hashmap *map, uint64 hash)
+{
+	size_t group = hash & map->group_mask;
+	size_t step = 0;
+
+	for (;;) {
+		uint32 empty = hashmap_match_empty(map->ctrl + group * HASHMAP_GROUP);
+		if (empty)
+			return group * HASHMAP_GROUP + CTZ32(empty);
+		if (map->overflow[group] < HASHMAP_OVERFLOW_MAX)
+			map->overflow[group]++;
+		group = (group + ++step) & map->group_mask;
+	}
+}
+
+static int hashmap_rehash(struct hashmap *map, size_t groups)
+{
+	struct hashmap old = *map;
+	size_t capacity = groups * HASHMAP_GROUP;
+	size_t slots_offset = (capacity + groups + 15) & ~(size_t)15;
+	size_t old_capacity = hashmap_capacity(&old);
+	unsigned char *block;
+	size_t i;
+
+	if (groups > (SIZE_MAX - slots_offset) / HASHMAP_GROUP / (map->slot_size + 2))
+		return 0;
+	block = malloc(slots_offset + capacity * map->slot_size);
+	if (!block)
+		return 0;
+
+	memset(block, HASHMAP_EMPTY, capacity);
+	memset(block + capacity, 0, groups);
+	map->ctrl = block;
+	map->overflow = block + capacity;
+	map->slots = block + slots_offset;
+	map->group_mask = groups - 1;
+	map->growth_left = hashmap_limit(capacity) - old.count;
+
+	for (i = 0; i < old_capacity; i++) {
+		const unsigned char *slot = old.slots + i * old.slot_size;
+		uint64 hash;
+		size_t j;
+
+		if (old.ctrl[i] == HASHMAP_EMPTY)
+			continue;
+		hash = hashmap_hash(map, slot);
+		j = hashmap_claim(map, hash);
+		map->ctrl[j] = (unsigned char)(hash >> 57);
+		memcpy(map->slots + j * map->slot_size, slot, map->slot_size);
+	}
+
+	free(old.ctrl);
+	return 1;
+}
+
+/**
+ * Make room for count entries without rehashing.
+ *
+ * @return {int}: 1 on success, 0 on allocation failure
+ */
+int hashmap_reserve(struct hashmap *map, size_t count)
+{
+	size_t groups = 1;
+
+	while (hashmap_limit(groups * HASHMAP_GROUP) < count) {
+		if (groups > SIZE_MAX / 2 / HASHMAP_GROUP)
+			return 0;
+		groups *= 2;
+	}
+	if (map->ctrl && groups <= map->group_mask + 1)
+		return 1;
+	return hashmap_rehash(map, groups);
+}
+
+void hashmap_clear(struct hashmap *map)
+{
+	size_t capacity = hashmap_capacity(map);
+
+	if (!map->ctrl)
+		return;
+	memset(map->ctrl, HASHMAP_EMPTY, capacity);
+	memset(map->overflow, 0, map->group_mask + 1);
+	map->count = 0;
+	map->growth_left = hashmap_limit(capacity);
+}
+
+// Pointer to the value of key, NULL if it is not in the map
+void *hashmap_get(const struct hashmap *map, const void *key)
+{
+	size_t i;
+
+	if (!map->count || !hashmap_find(map, key, hashmap_hash(map, key), &i))
+		return NULL;
+	return map->slots + i * map->slot_size + map->value_offset;
+}
+
+/**
+ * Find key or add it with an uninitialized value.
+ *
+ * @param {int*} inserted: set to 1 if the key was added, can be NULL
+ * @return {void*}: pointer to the value, NULL on allocation failure
+ */
+void *hashmap_insert(struct hashmap *map, const void *key, int *inserted)
+{
+	uint64 hash = hashmap_hash(map, key);
+	unsigned char *slot;
+	size_t i;
+
+	if (inserted)
+		*inserted = 0;
+	if (map->count && hashmap_find(map, key, hash, &i))
+		return map->slots + i * map->slot_size + map->value_offset;
+
+	if (!map->growth_left) {
+		size_t groups = map->ctrl ? (map->group_mask + 1) * 2 : 1;
+		if (!hashmap_rehash(map, groups))
+			return NULL;
+	}
+
+	i = hashmap_claim(map, hash);
+	map->ctrl[i] = (unsigned char)(hash >> 57);
+	slot = map->slots + i * map->slot_size;
+	memcpy(slot, key, map->key_size);
+	map->count++;
+	map->growth_left--;
+	if (inserted)
+		*inserted = 1;
+	return slot + map->value_offset;
+}
+
+// Insert or overwrite, returns the value pointer or NULL on allocation failure
+void *hashmap_put(struct hashmap *map, const void *key, const void *value)
+{
+	void *dst = hashmap_insert(map, key, NULL);
+
+	if (dst && map->value_size)
+		memcpy(dst, value, map->value_size);
+	return dst;
+}
+
+/**
+ * @return {int}: 1 if key was in the map, 0 otherwise
+ */
+int hashmap_remove(struct hashmap *map, const void *key)
+{
+	uint64 hash;
+	size_t i, group, target, step = 0;
+
+	if (!map->count)
+		return 0;
+	hash = hashmap_hash(map, key);
+	if (!hashmap_find(map, key, hash, &i))
+		return 0;
+
+	map->ctrl[i] = HASHMAP_EMPTY;
+	map->count--;
+	map->growth_left++;
+
+	// Undo the counts the insert left on the groups it passed
+	target = i / HASHMAP_GROUP;
+	group = hash & map->group_mask;
+	while (group != target) {
+		if (map->overflow[group] < HASHMAP_OVERFLOW_MAX)
+			map->overflow[group]--;
+		group = (group + ++step) & map->group_mask;
+	}
+	return 1;
+}
+
+/**
+ * Iterate in slot order, start with *iter = 0.
+ *
+ * @param {void**} key: set to the stored key, can be NULL
+ * @param {void**} value: set to the value, can be NULL
+ * @return {int}: 1 while there are entries, 0 at the end
+ */
+int hashmap_next(const struct hashmap *map, size_t *iter, void **key, void **value)
+{
+	size_t capacity = hashmap_capacity(map);
+	size_t i;
+
+	for (i = *iter; i < capacity; i++) {
+		if (map->ctrl[i] != HASHMAP_EMPTY) {
+			unsigned char *slot = map->slots + i * map->slot_size;
+			*iter = i + 1;
+			if (key)
+				*key = slot;
+			if (value)
+				*value = slot + map->value_offset;
+			return 1;
+		}
+	}
+	*iter = capacity;
+	return 0;
+}
@@ -0,0 +1,170 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "intern.h"
+#include "hash.h"
+#include <stdlib.h>
+
+// sv_hash64, folded to 32 bits
+static uint32 intern_hash(string_view sv)
+{
+	uint64 hash = sv_hash64(sv, 0);
+	return (uint32)(hash ^ (hash >> 32));
+}
+
+int intern_init(struct intern *in)
+{
+	if (!strvec_init(&in->strings))
+		return 0;
+
+	if (!array_init(&in->hashes, sizeof(uint32), 0)) {
+		strvec_delete_struct(&in->strings);
+		return 0;
+	}
+
+	in->cap = INTERN_INITIAL_CAP;
+	in->slots = calloc(in->cap, sizeof(struct intern_slot));
+	if (in->slots == NULL) {
+		array_free(&in->hashes);
+		strvec_delete_struct(&in->strings);
+		return 0;
+	}
+
+	return 1;
+}
+
+static struct intern_slot *intern_lookup(struct intern *in, string_view sv, uint32 hash)
+{
+	size_t mask = in->cap - 1;
+	size_t i = hash & mask;
+
+	for (;;) {
+		struct intern_slot *slot = &in->slots[i];
+		if (slot->id == 0)
+			return slot;
+
+		if (slot->hash == hash && sv_eq(strvec_get_sv(&in->strings, slot->id - 1), sv))
+			return slot;
+
+		i = (i + 1) & mask;
+	}
+}
+
+// Rebuild the table from the stored hashes, no string is rehashed
+static int intern_grow(struct intern *in)
+{
+	size_t newcap = in->cap * 2;
+	struct intern_slot *slots = calloc(newcap, sizeof(struct intern_slot));
+	if (slots == NULL)
+		return 0;
+
+	size_t mask = newcap - 1;
+	for (size_t id = 0; id < in->hashes.index; id++) {
+		uint32 hash = *(uint32*)array_get(&in->hashes, id);
+		size_t i = hash & mask;
+		while (slots[i].id != 0)
+			i = (i + 1) & mask;
+
+		slots[i].hash = hash;
+		slots[i].id = id + 1;
+	}
+
+	free(in->slots);
+	in->slots = slots;
+	in->cap = newcap;
+	return 1;
+}
+
+/*
+ * Return the id of sv, the string is copied into the interner
+ * the first time it is seen.
+ *
+ * @return {uint32}: id of the string, INTERN_INVALID_ID on fail.
+ */
+uint32 intern(struct intern *in, string_view sv)
+{
+	uint32 hash = intern_hash(sv);
+	struct intern_slot *slot = intern_lookup(in, sv, hash);
+	if (slot->id != 0)
+		return slot->id - 1;
+
+	// Keep the load factor under 3/4
+	if ((in->hashes.index + 1) * 4 > in->cap * 3) {
+		if (!intern_grow(in))
+			return INTERN_INVALID_ID;
+		slot = intern_lookup(in, sv, hash);
+	}
+
+	if (!array_reserve(&in->hashes, 1))
+		return INTERN_INVALID_ID;
+
+	int id = strvec_push_sv(&in->strings, sv);
+	if (id == -1)
+		return INTERN_INVALID_ID;
+
+	array_push(&in->hashes, &hash);
+	slot->hash = hash;
+	slot->id = (uint32)id + 1;
+
+	return (uint32)id;
+}
+
+/*
+ * Same as intern() but never inserts.
+ *
+ * @return {uint32}: id of the string, INTERN_INVALID_ID if it was
+ * never interned.
+ */
+uint32 intern_find(struct intern *in, string_view sv)
+{
+	struct intern_slot *slot = intern_lookup(in, sv, intern_hash(sv));
+	return slot->id ? slot->id - 1 : INTERN_INVALID_ID;
+}
+
+string_view intern_get(struct intern *in, uint32 id)
+{
+	return strvec_get_sv(&in->strings, id);
+}
+
+size_t intern_count(struct intern *in)
+{
+	return in->hashes.index;
+}
+
+// Bytes allocated by the interner, including unused capacity
+size_t intern_memory(struct intern *in)
+{
+	return in->strings.data_cap + in->strings.offsets.cap +
+		in->hashes.cap + in->cap * sizeof(struct intern_slot);
+}
+
+void intern_free(struct intern *in)
+{
+	strvec_delete_struct(&in->strings);
+	array_free(&in->hashes);
+	free(in->slots);
+	in->slots = NULL;
+	in->cap = 0;
+}
@@ -0,0 +1,726 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "json.h"
+#include "array.h"
+#include "number.h"
+#include "extra.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_SDX_AVX2)
+#include <immintrin.h>
+#elif defined(_SDX_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(_SDX_PCLMUL)
+#include <wmmintrin.h>
+#endif
+
+struct json_masks {
+	uint64 quote;
+	uint64 backslash;
+	uint64 space;
+	uint64 op;	// {}[]:,
+};
+
+#if defined(_SDX_AVX2)
+static inline uint64 json_eq64(__m256i a, __m256i b, char c)
+{
+	__m256i needle = _mm256_set1_epi8(c);
+	uint64 lo = (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, needle));
+	uint64 hi = (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, needle));
+	return lo | (hi << 32);
+}
+#elif defined(_SDX_SSE2)
+static inline uint64 json_eq16(__m128i block, char c)
+{
+	return (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(c)));
+}
+#endif
+
+// Bit i of each mask is set when p[i] is in that class. Or-ing 0x20
+// folds '[' into '{' and ']' into '}', no other byte maps onto them.
+static inline struct json_masks json_masks64(const char *p)
+{
+	struct json_masks m;
+#if defined(_SDX_AVX2)
+	__m256i a = _mm256_loadu_si256((const __m256i*)p);
+	__m256i b = _mm256_loadu_si256((const __m256i*)(p + 32));
+	__m256i case_bit = _mm256_set1_epi8(0x20);
+	__m256i fa = _mm256_or_si256(a, case_bit), fb = _mm256_or_si256(b, case_bit);
+	m.quote = json_eq64(a, b, '"');
+	m.backslash = json_eq64(a, b, '\\');
+	m.space = json_eq64(a, b, ' ') | json_eq64(a, b, '\n') |
+		json_eq64(a, b, '\r') | json_eq64(a, b, '\t');
+	m.op = json_eq64(fa, fb, '{') | json_eq64(fa, fb, '}') |
+		json_eq64(a, b, ':') | json_eq64(a, b, ',');
+#elif defined(_SDX_SSE2)
+	m.quote = m.backslash = m.space = m.op = 0;
+	for (int i = 0; i < 4; i++) {
+		__m128i block = _mm_loadu_si128((const __m128i*)(p + i * 16));
+		__m128i folded = _mm_or_si128(block, _mm_set1_epi8(0x20));
+		int shift = i * 16;
+		m.quote |= json_eq16(block, '"') << shift;
+		m.backslash |= json_eq16(block, '\\') << shift;
+		m.space |= (json_eq16(block, ' ') | json_eq16(block, '\n') |
+			    json_eq16(block, '\r') | json_eq16(block, '\t')) << shift;
+		m.op |= (json_eq16(folded, '{') | json_eq16(folded, '}') |
+			 json_eq16(block, ':') | json_eq16(block, ',')) << shift;
+	}
+#else
+	m.quote = m.backslash = m.space = m.op = 0;
+	for (int i = 0; i < 64; i++) {
+		char c = p[i];
+		m.quote |= (uint64)(c == '"') << i;
+		m.backslash |= (uint64)(c == '\\') << i;
+		m.space |= (uint64)(c == ' ' || c == '\n' || c == '\r' || c == '\t') << i;
+		m.op |= (uint64)(c == '{' || c == '}' || c == '[' || c == ']' ||
+				 c == ':' || c == ',') << i;
+	}
+#endif
+	return m;
+}
+
+// The last partial block is padded with spaces so a number or literal
+// at the very end of the input still ends inside the block
+static inline struct json_masks json_block(const char *data, size_t i, size_t len)
+{
+	if (i + 64 <= len)
+		return json_masks64(data + i);
+
+	char tail[64];
+	memset(tail, ' ', sizeof(tail));
+	memcpy(tail, data + i, len - i);
+	return json_masks64(tail);
+}
+
+// Same trick as in csv.c, bit i is the xor of bits 0..i of x
+static inline uint64 json_prefix_xor(uint64 x)
+{
+#if defined(_SDX_PCLMUL)
+	__m128i all = _mm_set1_epi8(-1);
+	return (uint64)_mm_cvtsi128_si64(_mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)x), all, 0));
+#else
+	x ^= x << 1;
+	x ^= x << 2;
+	x ^= x << 4;
+	x ^= x << 8;
+	x ^= x << 16;
+	x ^= x << 32;
+	return x;
+#endif
+}
+
+/*
+ * Bits of the characters that follow an unescaped backslash. Runs of
+ * backslashes pair up from the left, carry is set when the block ends
+ * with a backslash that escapes the first byte of the next one. Most
+ * blocks have no backslash at all and return right away.
+ */
+static inline uint64 json_escaped(uint64 backslash, uint64 *carry)
+{
+	uint64 escaped = *carry;
+	*carry = 0;
+	backslash &= ~escaped;
+	while (backslash) {
+		int bit = CTZ64(backslash);
+		if (bit == 63) {
+			*carry = 1;
+			break;
+		}
+		uint64 next = 1ULL << (bit + 1);
+		escaped |= next;
+		backslash &= ~(next | (next >> 1));
+	}
+	return escaped;
+}
+
+/*
+ * Stage one, appends the offset of every structural character to
+ * positions: operators outside strings, both quotes of every string and
+ * the first byte of every other run of non whitespace characters, that
+ * is numbers, literals and garbage. Returns the offset of an
+ * unterminated string or SIZE_MAX.
+ */
+static size_t json_index(const char *data, size_t len, struct array *positions)
+{
+	uint64 escape_carry = 0, in_string = 0, prev_scalar = 0;
+
+	for (size_t i = 0; i < len; i += 64) {
+		struct json_masks m = json_block(data, i, len);
+		uint64 quote = m.quote & ~json_escaped(m.backslash, &escape_carry);
+		uint64 string = json_prefix_xor(quote) ^ in_string;
+		in_string = (uint64)((int64)string >> 63);
+
+		uint64 op = m.op & ~string;
+		uint64 scalar = ~(m.op | m.space | quote | string);
+		uint64 scalar_start = scalar & ~((scalar << 1) | prev_scalar);
+		prev_scalar = scalar >> 63;
+
+		uint64 structural = op | quote | scalar_start;
+		if (!array_reserve(positions, 64))
+			return SIZE_MAX - 1;
+		uint32 *out = (uint32*)positions->data + positions->index;
+		size_t count = 0;
+		while (structural) {
+			out[count++] = (uint32)(i + CTZ64(structural));
+			structural &= structural - 1;
+		}
+		positions->index += count;
+	}
+
+	if (in_string) {
+		const uint32 *pos = (const uint32*)positions->data;
+		for (size_t k = positions->index; k > 0; k--)
+			if (data[pos[k - 1]] == '"')
+				return pos[k - 1];
+	}
+	return SIZE_MAX;
+}
+
+static int json_is_space(char c)
+{
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static int json_is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+// Length of the number at p, -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+// or 0 if there is none
+static size_t json_number_len(const char *p, size_t len)
+{
+	size_t i = 0;
+	if (i < len && p[i] == '-')
+		i++;
+	if (i >= len || !json_is_digit(p[i]))
+		return 0;
+	if (p[i] == '0')
+		i++;
+	else
+		while (i < len && json_is_digit(p[i]))
+			i++;
+
+	if (i < len && p[i] == '.') {
+		if (++i >= len || !json_is_digit(p[i]))
+			return 0;
+		while (i < len && json_is_digit(p[i]))
+			i++;
+	}
+
+	if (i < len && (p[i] == 'e' || p[i] == 'E')) {
+		i++;
+		if (i < len && (p[i] == '+' || p[i] == '-'))
+			i++;
+		if (i >= len || !json_is_digit(p[i]))
+			return 0;
+		while (i < len && json_is_digit(p[i]))
+			i++;
+	}
+	return i;
+}
+
+/*
+ * Type and length of the scalar at p, JSON_INVALID if it is malformed.
+ * Stage one guarantees that only whitespace sits between the end of
+ * the scalar and the next structural character, which is avail bytes
+ * away, so the scalar is fine if it stops at whitespace or right there.
+ */
+static enum json_type json_scalar(const char *p, size_t avail, size_t *len)
+{
+	enum json_type type = JSON_NUMBER;
+	size_t n;
+	switch (*p) {
+	case 'n':
+		n = 4, type = JSON_NULL;
+		if (avail < 4 || memcmp(p, "null", 4) != 0)
+			return JSON_INVALID;
+		break;
+	case 't':
+		n = 4, type = JSON_TRUE;
+		if (avail < 4 || memcmp(p, "true", 4) != 0)
+			return JSON_INVALID;
+		break;
+	case 'f':
+		n = 5, type = JSON_FALSE;
+		if (avail < 5 || memcmp(p, "false", 5) != 0)
+			return JSON_INVALID;
+		break;
+	default:
+		if ((n = json_number_len(p, avail)) == 0)
+			return JSON_INVALID;
+	}
+
+	if (n < avail && !json_is_space(p[n]))
+		return JSON_INVALID;
+	*len = n;
+	return type;
+}
+
+static int json_fail(struct json_doc *doc, const char *error, size_t offset)
+{
+	doc->error = error;
+	doc->error_offset = offset;
+	return 0;
+}
+
+/*
+ * Stage two, walks the structural characters with an explicit stack
+ * and appends one node per value. Keys are string nodes directly
+ * followed by their value. Every node ends up with end set to the
+ * index just past its subtree.
+ */
+static int json_build(struct json_doc *doc, const uint32 *pos, size_t count)
+{
+	const char *data = doc->input.data;
+	size_t len = doc->input.len;
+	struct json_node *nodes = doc->nodes;
+	uint32 stack[JSON_MAX_DEPTH];
+	size_t depth = 0;
+	uint32 n = 0;
+	size_t i = 0;
+	char c;
+
+#define JSON_AT(k) ((k) < count ? data[pos[k]] : '\0')
+#define JSON_OFFSET(k) ((k) < count ? (size_t)pos[k] : len)
+
+value:
+	if (i >= count)
+		return json_fail(doc, "unexpected end of input", len);
+	c = data[pos[i]];
+	if (c == '{' || c == '[') {
+		if (depth == JSON_MAX_DEPTH)
+			return json_fail(doc, "nesting too deep", pos[i]);
+		nodes[n].type = c == '{' ? JSON_OBJECT : JSON_ARRAY;
+		nodes[n].offset = pos[i];
+		nodes[n].len = 0;
+		stack[depth++] = n++;
+		i++;
+		if (JSON_AT(i) == (c == '{' ? '}' : ']'))
+			goto close;
+		if (c == '{')
+			goto key;
+		goto value;
+	} else if (c == '"') {
+		nodes[n].type = JSON_STRING;
+		nodes[n].offset = pos[i] + 1;
+		nodes[n].len = pos[i + 1] - pos[i] - 1;
+		nodes[n].end = n + 1;
+		n++;
+		i += 2;
+	} else {
+		size_t start = pos[i], scalar_len;
+		enum json_type type = json_scalar(data + start, JSON_OFFSET(i + 1) - start, &scalar_len);
+		if (type == JSON_INVALID)
+			return json_fail(doc, "unexpected character", start);
+		nodes[n].type = type;
+		nodes[n].offset = start;
+		nodes[n].len = scalar_len;
+		nodes[n].end = n + 1;
+		n++;
+		i++;
+	}
+
+after:
+	if (depth == 0) {
+		if (i != count)
+			return json_fail(doc, "trailing characters", pos[i]);
+		doc->count = n;
+		return 1;
+	}
+	nodes[stack[depth - 1]].len++;
+	c = JSON_AT(i);
+	if (c == ',') {
+		i++;
+		if (nodes[stack[depth - 1]].type == JSON_OBJECT)
+			goto key;
+		goto value;
+	}
+	if (c != (nodes[stack[depth - 1]].type == JSON_OBJECT ? '}' : ']'))
+		return json_fail(doc, "expected ',' or closing bracket", JSON_OFFSET(i));
+
+close:
+	nodes[stack[--depth]].end = n;
+	i++;
+	goto after;
+
+key:
+	if (JSON_AT(i) != '"')
+		return json_fail(doc, "expected string key", JSON_OFFSET(i));
+	nodes[n].type = JSON_STRING;
+	nodes[n].offset = pos[i] + 1;
+	nodes[n].len = pos[i + 1] - pos[i] - 1;
+	nodes[n].end = n + 1;
+	n++;
+	i += 2;
+	if (JSON_AT(i) != ':')
+		return json_fail(doc, "expected ':'", JSON_OFFSET(i));
+	i++;
+	goto value;
+
+#undef JSON_AT
+#undef JSON_OFFSET
+}
+
+/**
+ * Parses input into doc, the node tape is allocated from arena and
+ * lives as long as it. String contents are only checked when they are
+ * converted with json_string().
+ * @param {struct json_doc*} doc: Filled in, doc->error is set on failure
+ * @param {struct arena*} arena: Where the nodes go
+ * @param {string_view} input: JSON text, referenced by the document
+ * @return {int}: 1 on success, 0 on failure
+ */
+int json_parse(struct json_doc *doc, struct arena *arena, string_view input)
+{
+	memset(doc, 0, sizeof(*doc));
+	doc->input = input;
+	if (input.len >= UINT32_MAX)
+		return json_fail(doc, "input too large", 0);
+
+	struct array positions;
+	if (!array_init(&positions, sizeof(uint32), 0))
+		return json_fail(doc, "out of memory", 0);
+
+	size_t bad = json_index(input.data, input.len, &positions);
+	int result = 0;
+	if (bad == SIZE_MAX - 1) {
+		json_fail(doc, "out of memory", 0);
+	} else if (bad != SIZE_MAX) {
+		json_fail(doc, "unterminated string", bad);
+	} else if (positions.index == 0) {
+		json_fail(doc, "empty document", input.len);
+	} else {
+		arena_align_next_block(arena);
+		doc->nodes = arena_alloc(arena, positions.index * sizeof(struct json_node));
+		if (doc->nodes == NULL)
+			json_fail(doc, "out of memory", 0);
+		else
+			result = json_build(doc, (const uint32*)positions.data, positions.index);
+	}
+
+	array_free(&positions);
+	if (!result)
+		doc->count = 0;
+	return result;
+}
+
+json_value json_root(const struct json_doc *doc)
+{
+	json_value v = { doc, doc->count > 0 ? 0 : JSON_NONE };
+	return v;
+}
+
+static const struct json_node *json_node(json_value v)
+{
+	if (v.doc == NULL || v.index == JSON_NONE || v.index >= v.doc->count)
+		return NULL;
+	return &v.doc->nodes[v.index];
+}
+
+enum json_type json_type(json_value v)
+{
+	const struct json_node *node = json_node(v);
+	return node ? (enum json_type)node->type : JSON_INVALID;
+}
+
+// Children of arrays, members of objects, source bytes of the rest
+size_t json_len(json_value v)
+{
+	const struct json_node *node = json_node(v);
+	return node ? node->len : 0;
+}
+
+// Source text of numbers, literals and strings (without the quotes
+// and still escaped), empty for arrays, objects and missing values
+string_view json_raw(json_value v)
+{
+	const struct json_node *node = json_node(v);
+	string_view sv = { NULL, 0 };
+	if (node && node->type != JSON_ARRAY && node->type != JSON_OBJECT) {
+		sv.data = (char*)v.doc->input.data + node->offset;
+		sv.len = node->len;
+	}
+	return sv;
+}
+
+static int json_hex4(const char *p, uint32 *out)
+{
+	uint32 value = 0;
+	for (int i = 0; i < 4; i++) {
+		char c = p[i];
+		value <<= 4;
+		if (c >= '0' && c <= '9')
+			value |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			value |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			value |= c - 'A' + 10;
+		else
+			return 0;
+	}
+	*out = value;
+	return 1;
+}
+
+static size_t json_utf8(char *out, uint32 cp)
+{
+	if (cp < 0x80) {
+		out[0] = cp;
+		return 1;
+	} else if (cp < 0x800) {
+		out[0] = 0xC0 | (cp >> 6);
+		out[1] = 0x80 | (cp & 0x3F);
+		return 2;
+	} else if (cp < 0x10000) {
+		out[0] = 0xE0 | (cp >> 12);
+		out[1] = 0x80 | ((cp >> 6) & 0x3F);
+		out[2] = 0x80 | (cp & 0x3F);
+		return 3;
+	}
+	out[0] = 0xF0 | (cp >> 18);
+	out[1] = 0x80 | ((cp >> 12) & 0x3F);
+	out[2] = 0x80 | ((cp >> 6) & 0x3F);
+	out[3] = 0x80 | (cp & 0x3F);
+	return 4;
+}
+
+/*
+ * Decodes the escapes of a raw string into out, which needs len bytes,
+ * the result is never longer than the input. Returns the decoded length
+ * or SIZE_MAX for bad escapes, control characters and unpaired
+ * surrogates.
+ */
+static size_t json_unescape(const char *in, size_t len, char *out)
+{
+	size_t o = 0;
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = in[i];
+		if (c < 0x20)
+			return SIZE_MAX;
+		if (c != '\\') {
+			out[o++] = c;
+			continue;
+		}
+		if (++i >= len)
+			return SIZE_MAX;
+		switch (in[i]) {
+		case '"': out[o++] = '"'; break;
+		case '\\': out[o++] = '\\'; break;
+		case '/': out[o++] = '/'; break;
+		case 'b': out[o++] = '\b'; break;
+		case 'f': out[o++] = '\f'; break;
+		case 'n': out[o++] = '\n'; break;
+		case 'r': out[o++] = '\r'; break;
+		case 't': out[o++] = '\t'; break;
+		case 'u': {
+			uint32 cp, low;
+			if (i + 4 >= len || !json_hex4(in + i + 1, &cp))
+				return SIZE_MAX;
+			i += 4;
+			if (cp >= 0xDC00 && cp <= 0xDFFF)
+				return SIZE_MAX;
+			if (cp >= 0xD800 && cp <= 0xDBFF) {
+				if (i + 6 >= len || in[i + 1] != '\\' || in[i + 2] != 'u' ||
+				    !json_hex4(in + i + 3, &low) || low < 0xDC00 || low > 0xDFFF)
+					return SIZE_MAX;
+				i += 6;
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+			}
+			o += json_utf8(out + o, cp);
+			break;
+		}
+		default:
+			return SIZE_MAX;
+		}
+	}
+	return o;
+}
+
+// Raw strings without backslashes and control characters need no copy
+static int json_plain(const char *p, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		if ((unsigned char)p[i] < 0x20 || p[i] == '\\')
+			return 0;
+	return 1;
+}
+
+static int json_key_equals(string_view raw, string_view key)
+{
+	if (memchr(raw.data, '\\', raw.len) == NULL)
+		return raw.len == key.len && memcmp(raw.data, key.data, key.len) == 0;
+
+	char stack[256];
+	char *buf = raw.len <= sizeof(stack) ? stack : malloc(raw.len);
+	if (buf == NULL)
+		return 0;
+	size_t len = json_unescape(raw.data, raw.len, buf);
+	int equal = len == key.len && memcmp(buf, key.data, key.len) == 0;
+	if (buf != stack)
+		free(buf);
+	return equal;
+}
+
+/**
+ * Looks up a member by its decoded key, the first match wins.
+ * @param {json_value} object: Object to search
+ * @param {string_view} key: Key without quotes or escapes
+ * @return {json_value}: The member's value, invalid when there is none
+ */
+json_value json_get(json_value object, string_view key)
+{
+	json_value result = { object.doc, JSON_NONE };
+	const struct json_node *node = json_node(object);
+	if (node == NULL || node->type != JSON_OBJECT)
+		return result;
+
+	const struct json_node *nodes = object.doc->nodes;
+	for (uint32 i = object.index + 1; i < node->end; i = nodes[i + 1].end) {
+		json_value k = { object.doc, i };
+		if (json_key_equals(json_raw(k), key)) {
+			result.index = i + 1;
+			break;
+		}
+	}
+	return result;
+}
+
+// Element i of an array, earlier elements are skipped a subtree at a time
+json_value json_at(json_value array, size_t i)
+{
+	json_value result = { array.doc, JSON_NONE };
+	const struct json_node *node = json_node(array);
+	if (node == NULL || node->type != JSON_ARRAY || i >= node->len)
+		return result;
+
+	uint32 index = array.index + 1;
+	while (i--)
+		index = array.doc->nodes[index].end;
+	result.index = index;
+	return result;
+}
+
+struct json_iter json_iter(json_value container)
+{
+	struct json_iter it = { container.doc, 0, 0, 0 };
+	const struct json_node *node = json_node(container);
+	if (node && (node->type == JSON_ARRAY || node->type == JSON_OBJECT)) {
+		it.index = container.index + 1;
+		it.end = node->end;
+		it.object = node->type == JSON_OBJECT;
+	}
+	return it;
+}
+
+/**
+ * Moves to the next element or member.
+ * @param {struct json_iter*} it: From json_iter()
+ * @param {json_value*} key: Member key for objects, may be NULL
+ * @param {json_value*} value: Element or member value, may be NULL
+ * @return {int}: 1 while there are values left, 0 at the end
+ */
+int json_iter_next(struct json_iter *it, json_value *key, json_value *value)
+{
+	if (it->index >= it->end)
+		return 0;
+
+	json_value k = { it->doc, JSON_NONE };
+	if (it->object) {
+		k.index = it->index;
+		it->index++;
+	}
+	json_value v = { it->doc, it->index };
+	it->index = it->doc->nodes[it->index].end;
+
+	if (key)
+		*key = k;
+	if (value)
+		*value = v;
+	return 1;
+}
+
+/**
+ * Decoded contents of a string value. Strings without escapes are
+ * returned as a view into the input, others are decoded into arena.
+ * @param {json_value} v: String value
+ * @param {struct arena*} arena: Used only for escaped strings
+ * @param {string_view*} out: The contents, not NUL terminated
+ * @return {int}: 1 on success, 0 for other types and bad escapes
+ */
+int json_string(json_value v, struct arena *arena, string_view *out)
+{
+	if (json_type(v) != JSON_STRING)
+		return 0;
+
+	string_view raw = json_raw(v);
+	if (json_plain(raw.data, raw.len)) {
+		*out = raw;
+		return 1;
+	}
+
+	char *buf = arena_alloc(arena, raw.len);
+	if (buf == NULL)
+		return 0;
+	size_t len = json_unescape(raw.data, raw.len, buf);
+	if (len == SIZE_MAX)
+		return 0;
+	out->data = buf;
+	out->len = len;
+	return 1;
+}
+
+int json_f64(json_value v, f64 *out)
+{
+	string_view raw = json_raw(v);
+	return json_type(v) == JSON_NUMBER && sv_to_f64(raw, out) == raw.len;
+}
+
+// Fails for fractions, exponents and values out of range
+int json_i64(json_value v, int64 *out)
+{
+	string_view raw = json_raw(v);
+	return json_type(v) == JSON_NUMBER && sv_to_i64(raw, out) == raw.len;
+}
+
+int json_u64(json_value v, uint64 *out)
+{
+	string_view raw = json_raw(v);
+	return json_type(v) == JSON_NUMBER && sv_to_u64(raw, out) == raw.len;
+}
+
+int json_bool(json_value v, int *out)
+{
+	enum json_type type = json_type(v);
+	if (type != JSON_TRUE && type != JSON_FALSE)
+		return 0;
+	*out = type == JSON_TRUE;
+	return 1;
+}
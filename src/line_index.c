@@ -0,0 +1,370 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "line_index.h"
+#include "extra.h"
+#include "system.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _SDX_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(_SDX_AVX2)
+#include <immintrin.h>
+#elif defined(_SDX_SSE2)
+#include <emmintrin.h>
+#endif
+
+// Bit i is set when p[i] is a newline
+static inline uint64 line_index_mask64(const char *p)
+{
+#if defined(_SDX_AVX2)
+	__m256i nl = _mm256_set1_epi8('\n');
+	uint64 lo = (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), nl));
+	uint64 hi = (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 32)), nl));
+	return lo | (hi << 32);
+#elif defined(_SDX_SSE2)
+	__m128i nl = _mm_set1_epi8('\n');
+	uint64 mask = 0;
+	for (int i = 0; i < 4; i++) {
+		__m128i block = _mm_loadu_si128((const __m128i*)(p + i * 16));
+		mask |= (uint64)(uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, nl)) << (i * 16);
+	}
+	return mask;
+#else
+	uint64 mask = 0;
+	for (int i = 0; i < 64; i++)
+		mask |= (uint64)(p[i] == '\n') << i;
+	return mask;
+#endif
+}
+
+static size_t line_index_count(const char *data, size_t begin, size_t end)
+{
+	size_t count = 0;
+	size_t i = begin;
+
+	for (; i + 64 <= end; i += 64)
+		count += POPCOUNT64(line_index_mask64(data + i));
+	for (; i < end; i++)
+		count += data[i] == '\n';
+
+	return count;
+}
+
+// Start of the line k lines after the one at pos, end if there is
+// no such line
+static size_t line_index_skip(const char *data, size_t pos, size_t end, size_t k)
+{
+	for (; k && pos + 64 <= end; pos += 64) {
+		uint64 mask = line_index_mask64(data + pos);
+		size_t count = POPCOUNT64(mask);
+		if (count < k) {
+			k -= count;
+			continue;
+		}
+		while (--k)
+			mask &= mask - 1;
+		return pos + CTZ64(mask) + 1;
+	}
+
+	for (; k && pos < end; pos++)
+		if (data[pos] == '\n')
+			k--;
+
+	return pos;
+}
+
+/*
+ * Pushes the start of every line in [begin, end) whose number is a
+ * multiple of stride, base is the number of newlines before begin.
+ * Blocks that don't hold such a line are only counted.
+ */
+static int line_index_record(const char *data, size_t begin, size_t end, size_t base,
+			     size_t stride, struct array *out, size_t *newlines)
+{
+	size_t n = base;
+	size_t target = (n / stride + 1) * stride - 1;
+	size_t i = begin;
+	uint64 *slot;
+
+	for (; i + 64 <= end; i += 64) {
+		uint64 mask = line_index_mask64(data + i);
+		size_t count = POPCOUNT64(mask);
+		if (n + count <= target) {
+			n += count;
+			continue;
+		}
+		for (; mask; mask &= mask - 1, n++) {
+			if (n != target)
+				continue;
+			if ((slot = array_alloc(out)) == NULL)
+				return 0;
+			*slot = i + CTZ64(mask) + 1;
+			target += stride;
+		}
+	}
+
+	for (; i < end; i++) {
+		if (data[i] != '\n')
+			continue;
+		if (n == target) {
+			if ((slot = array_alloc(out)) == NULL)
+				return 0;
+			*slot = i + 1;
+			target += stride;
+		}
+		n++;
+	}
+
+	*newlines = n - base;
+	return 1;
+}
+
+struct line_index_job {
+	const char *data;
+	size_t begin;
+	size_t end;
+	size_t base;
+	size_t stride;
+	size_t newlines;
+	struct array offsets;
+	int record;
+	int ok;
+};
+
+#ifdef _SDX_WINDOWS
+static DWORD WINAPI line_index_worker(LPVOID arg)
+#else
+static void *line_index_worker(void *arg)
+#endif
+{
+	struct line_index_job *job = arg;
+	if (job->record) {
+		job->ok = array_init(&job->offsets, sizeof(uint64), 0) &&
+			line_index_record(job->data, job->begin, job->end, job->base,
+					  job->stride, &job->offsets, &job->newlines);
+	} else {
+		job->newlines = line_index_count(job->data, job->begin, job->end);
+		job->ok = 1;
+	}
+	return 0;
+}
+
+// Runs every job, on its own thread when one can be started
+static void line_index_run(struct line_index_job *jobs, int count)
+{
+	int started = 0;
+#ifdef _SDX_WINDOWS
+	HANDLE *threads = malloc(count * sizeof(*threads));
+	if (threads != NULL) {
+		for (; started < count; started++) {
+			threads[started] = CreateThread(NULL, 0, line_index_worker, &jobs[started], 0, NULL);
+			if (threads[started] == NULL)
+				break;
+		}
+	}
+#else
+	pthread_t *threads = malloc(count * sizeof(*threads));
+	if (threads != NULL) {
+		for (; started < count; started++)
+			if (pthread_create(&threads[started], NULL, line_index_worker, &jobs[started]) != 0)
+				break;
+	}
+#endif
+
+	for (int t = started; t < count; t++)
+		line_index_worker(&jobs[t]);
+
+	for (int t = 0; t < started; t++) {
+#ifdef _SDX_WINDOWS
+		WaitForSingleObject(threads[t], INFINITE);
+		CloseHandle(threads[t]);
+#else
+		pthread_join(threads[t], NULL);
+#endif
+	}
+	free(threads);
+}
+
+/*
+ * Two passes over nthreads chunks, the first counts the newlines of
+ * every chunk so the second knows which line numbers each chunk starts
+ * at and can record its kept lines on its own.
+ */
+static int line_index_build_parallel(struct line_index *li, int nthreads, size_t *newlines)
+{
+	struct line_index_job *jobs = calloc(nthreads, sizeof(*jobs));
+	if (jobs == NULL)
+		return 0;
+
+	size_t chunk = li->sv.len / nthreads;
+	for (int t = 0; t < nthreads; t++) {
+		jobs[t].data = li->sv.data;
+		jobs[t].begin = chunk * t;
+		jobs[t].end = t == nthreads - 1 ? li->sv.len : chunk * (t + 1);
+		jobs[t].stride = li->stride;
+	}
+	line_index_run(jobs, nthreads);
+
+	size_t base = 0;
+	for (int t = 0; t < nthreads; t++) {
+		jobs[t].base = base;
+		jobs[t].record = 1;
+		base += jobs[t].newlines;
+	}
+	line_index_run(jobs, nthreads);
+
+	size_t total = 0;
+	int ok = 1;
+	for (int t = 0; t < nthreads; t++) {
+		total += jobs[t].offsets.index;
+		ok &= jobs[t].ok;
+	}
+
+	if (ok && array_reserve(&li->offsets, total)) {
+		for (int t = 0; t < nthreads; t++) {
+			memcpy(li->offsets.data + li->offsets.index * sizeof(uint64), jobs[t].offsets.data,
+			       jobs[t].offsets.index * sizeof(uint64));
+			li->offsets.index += jobs[t].offsets.index;
+		}
+	} else {
+		ok = 0;
+	}
+
+	for (int t = 0; t < nthreads; t++)
+		if (jobs[t].offsets.data != NULL)
+			array_free(&jobs[t].offsets);
+	free(jobs);
+
+	*newlines = base;
+	return ok;
+}
+
+/**
+ * Index the lines of sv, sv has to outlive the index.
+ *
+ * @param {size_t} stride: keep every stride-th line start, 0 uses
+ * LINE_INDEX_DEFAULT_STRIDE. Bigger strides make the index smaller
+ * and the queries slower.
+ * @param {int} nthreads: 0 uses every available core, inputs smaller
+ * than LINE_INDEX_PARALLEL_MIN_CHUNK per thread use fewer threads.
+ * @return {int}: 1 on success, 0 if memory ran out.
+ */
+int line_index_build(struct line_index *li, string_view sv, size_t stride, int nthreads)
+{
+	memset(li, 0, sizeof(*li));
+	li->sv = sv;
+	li->stride = stride ? stride : LINE_INDEX_DEFAULT_STRIDE;
+
+	if (!array_init(&li->offsets, sizeof(uint64), 0))
+		return 0;
+
+	uint64 *first = array_alloc(&li->offsets);
+	if (first == NULL)
+		goto error;
+	*first = 0;
+
+	if (nthreads <= 0)
+		nthreads = sys_get_num_cpu_core_avail();
+	if ((size_t)nthreads > sv.len / LINE_INDEX_PARALLEL_MIN_CHUNK)
+		nthreads = sv.len / LINE_INDEX_PARALLEL_MIN_CHUNK;
+
+	size_t newlines;
+	int ok;
+	if (nthreads > 1)
+		ok = line_index_build_parallel(li, nthreads, &newlines);
+	else
+		ok = line_index_record(sv.data, 0, sv.len, 0, li->stride, &li->offsets, &newlines);
+	if (!ok)
+		goto error;
+
+	// A newline at the end was recorded as the start of an empty line
+	li->line_count = newlines + (sv.len > 0 && sv.data[sv.len - 1] != '\n');
+	li->offsets.index = MAX(1, (li->line_count + li->stride - 1) / li->stride);
+	return 1;
+
+error:
+	array_free(&li->offsets);
+	memset(li, 0, sizeof(*li));
+	return 0;
+}
+
+size_t line_count(const struct line_index *li)
+{
+	return li->line_count;
+}
+
+/**
+ * @return {string_view}: the line without its newline, an empty view
+ * at the end of the buffer if line is out of range.
+ */
+string_view line_at(const struct line_index *li, size_t line)
+{
+	if (line >= li->line_count)
+		return sv_from_parts(li->sv.data + li->sv.len, 0);
+
+	const uint64 *offsets = (const uint64*)li->offsets.data;
+	size_t start = line_index_skip(li->sv.data, offsets[line / li->stride], li->sv.len, line % li->stride);
+	string_view rest = sv_from_parts(li->sv.data + start, li->sv.len - start);
+	return sv_from_parts(rest.data, sv_index_of(rest, '\n'));
+}
+
+/**
+ * Line that holds the byte at offset, which is the number of newlines
+ * before it. Offsets past the buffer are clamped to its end.
+ */
+size_t line_of_offset(const struct line_index *li, size_t offset)
+{
+	if (li->line_count == 0)
+		return 0;
+
+	offset = MIN(offset, li->sv.len);
+
+	// Last kept line starting at or before offset
+	const uint64 *offsets = (const uint64*)li->offsets.data;
+	size_t low = 0, high = li->offsets.index;
+	while (high - low > 1) {
+		size_t mid = low + (high - low) / 2;
+		if (offsets[mid] <= offset)
+			low = mid;
+		else
+			high = mid;
+	}
+
+	return low * li->stride + line_index_count(li->sv.data, offsets[low], offset);
+}
+
+void line_index_free(struct line_index *li)
+{
+	if (li->offsets.data != NULL)
+		array_free(&li->offsets);
+	memset(li, 0, sizeof(*li));
+}
@@ -0,0 +1,203 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "multi_pattern.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Compile the patterns, empty and cleared strings are ignored. The
+ * strvec is not used after this returns.
+ *
+ * @return {int}: 1 on success, 0 on allocation failure or if the
+ * table would not fit 31 bit state offsets
+ */
+int mp_build(struct mp_matcher *matcher, struct strvec *patterns)
+{
+	size_t count = strvec_count(patterns);
+	size_t total_len = 0;
+	unsigned char seen[256] = { 0 };
+	uint32 *fail = NULL;
+	uint32 *queue = NULL;
+
+	memset(matcher, 0, sizeof(*matcher));
+
+	for (size_t i = 0; i < count; i++) {
+		string_view sv = strvec_get_sv(patterns, i);
+		for (size_t j = 0; j < sv.len; j++)
+			seen[(unsigned char)sv.data[j]] = 1;
+		total_len += sv.len;
+	}
+
+	// Column 0 is every byte that is in no pattern
+	matcher->class_count = 1;
+	for (int c = 0; c < 256; c++)
+		matcher->classes[c] = seen[c] ? matcher->class_count++ : 0;
+
+	size_t classes = matcher->class_count;
+	size_t max_states = total_len + 1;
+	if (max_states * classes >= MP_MATCH_BIT)
+		return 0;
+
+	matcher->pattern_count = count;
+	matcher->table = calloc(max_states * classes, sizeof(uint32));
+	matcher->state_pattern = calloc(max_states, sizeof(uint32));
+	matcher->state_output = malloc(max_states * sizeof(uint32));
+	matcher->pattern_next = calloc(count + 1, sizeof(uint32));
+	matcher->pattern_len = malloc((count + 1) * sizeof(size_t));
+	fail = malloc(max_states * sizeof(uint32));
+	queue = malloc(max_states * sizeof(uint32));
+	if (!matcher->table || !matcher->state_pattern || !matcher->state_output ||
+	    !matcher->pattern_next || !matcher->pattern_len || !fail || !queue)
+		goto error;
+
+	/*
+	 * Trie, while building the table holds plain state numbers and 0
+	 * means no edge (no edge of the trie goes back to the root).
+	 */
+	uint32 *table = matcher->table;
+	size_t states = 1;
+	for (size_t i = 0; i < count; i++) {
+		string_view sv = strvec_get_sv(patterns, i);
+		uint32 s = 0;
+
+		matcher->pattern_len[i] = sv.len;
+		if (sv.len == 0)
+			continue;
+
+		for (size_t j = 0; j < sv.len; j++) {
+			uint32 *edge = &table[s * classes + matcher->classes[(unsigned char)sv.data[j]]];
+			if (*edge == 0)
+				*edge = states++;
+			s = *edge;
+		}
+		matcher->pattern_next[i] = matcher->state_pattern[s];
+		matcher->state_pattern[s] = i + 1;
+	}
+	matcher->state_count = states;
+
+	/*
+	 * Breadth first, so the failure state of a state is always done
+	 * before it and its row can be copied for the missing edges.
+	 */
+	size_t head = 0, tail = 0;
+	fail[0] = 0;
+	matcher->state_output[0] = MP_NONE;
+	queue[tail++] = 0;
+	while (head < tail) {
+		uint32 s = queue[head++];
+		uint32 *row = &table[s * classes];
+		uint32 *fail_row = &table[fail[s] * classes];
+
+		for (size_t c = 0; c < classes; c++) {
+			uint32 t = row[c];
+			if (t == 0) {
+				row[c] = s == 0 ? 0 : fail_row[c];
+				continue;
+			}
+
+			uint32 f = s == 0 ? 0 : fail_row[c];
+			fail[t] = f;
+			matcher->state_output[t] = matcher->state_pattern[f] ? f : matcher->state_output[f];
+			queue[tail++] = t;
+		}
+	}
+
+	// Premultiply the states and flag the ones that report a match
+	for (size_t i = 0; i < states * classes; i++) {
+		uint32 t = table[i];
+		uint32 match = matcher->state_pattern[t] || matcher->state_output[t] != MP_NONE;
+		table[i] = t * classes | (match ? MP_MATCH_BIT : 0);
+	}
+
+	uint32 *shrunk = realloc(table, states * classes * sizeof(uint32));
+	if (shrunk != NULL)
+		matcher->table = shrunk;
+
+	free(fail);
+	free(queue);
+	return 1;
+
+error:
+	free(fail);
+	free(queue);
+	mp_free(matcher);
+	return 0;
+}
+
+/**
+ * Report every occurrence of every pattern in sv, overlapping ones
+ * included. Matches ending at the same byte are reported longest first.
+ *
+ * @param {mp_callback} callback: can be NULL to only count the matches
+ * @return {size_t}: number of matches reported
+ */
+size_t mp_scan(const struct mp_matcher *matcher, string_view sv, mp_callback callback, void *ctx)
+{
+	const uint32 *table = matcher->table;
+	const uint16 *classes = matcher->classes;
+	const unsigned char *p = (const unsigned char*)sv.data;
+	size_t matches = 0;
+	uint32 s = 0;
+
+	for (size_t i = 0; i < sv.len; i++) {
+		s = table[s + classes[p[i]]];
+		if (!(s & MP_MATCH_BIT))
+			continue;
+
+		s &= ~MP_MATCH_BIT;
+		uint32 state = s / matcher->class_count;
+		if (!matcher->state_pattern[state])
+			state = matcher->state_output[state];
+
+		for (; state != MP_NONE; state = matcher->state_output[state]) {
+			for (uint32 id = matcher->state_pattern[state]; id; id = matcher->pattern_next[id - 1]) {
+				matches++;
+				if (callback && callback(ctx, id - 1, i + 1 - matcher->pattern_len[id - 1]))
+					return matches;
+			}
+		}
+	}
+
+	return matches;
+}
+
+// Bytes used by the tables
+size_t mp_memory(const struct mp_matcher *matcher)
+{
+	return matcher->state_count * matcher->class_count * sizeof(uint32) +
+		matcher->state_count * 2 * sizeof(uint32) +
+		matcher->pattern_count * (sizeof(uint32) + sizeof(size_t));
+}
+
+void mp_free(struct mp_matcher *matcher)
+{
+	free(matcher->table);
+	free(matcher->state_pattern);
+	free(matcher->state_output);
+	free(matcher->pattern_next);
+	free(matcher->pattern_len);
+	memset(matcher, 0, sizeof(*matcher));
+}
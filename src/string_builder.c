@@ -0,0 +1,217 @@
+// This file is a part of sdx libraries
+// https://github.com/hsnovel/sdx
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+//
+// MIT License
+// Copyright (c) Çağan Korkmaz <cagankorkmaz35@gmail.com>
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "string_builder.h"
+#include "extra.h"
+#include "fmt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int sb_grow(struct string_builder *sb, size_t need)
+{
+	size_t cap = sb->cap ? sb->cap : SB_INITIAL_CAP;
+	while (cap < need) {
+		if (cap > SIZE_MAX / 2) {
+			cap = need;
+			break;
+		}
+		cap *= 2;
+	}
+
+	char *data;
+	if (sb->arena) {
+		// Arena memory can't be resized or given back, the old block
+		// stays in the arena until it is freed.
+		data = arena_alloc(sb->arena, cap);
+		if (data && sb->data)
+			memcpy(data, sb->data, sb->len + 1);
+	} else {
+		data = realloc(sb->data, cap);
+	}
+
+	if (!data) {
+		sb->failed = 1;
+		return 0;
+	}
+
+	if (!sb->data)
+		data[0] = '\0';
+	sb->data = data;
+	sb->cap = cap;
+	return 1;
+}
+
+int sb_init(struct string_builder *sb, size_t cap)
+{
+	memset(sb, 0, sizeof(*sb));
+	return sb_grow(sb, cap ? cap : SB_INITIAL_CAP);
+}
+
+int sb_init_arena(struct string_builder *sb, struct arena *arena, size_t cap)
+{
+	memset(sb, 0, sizeof(*sb));
+	sb->arena = arena;
+	return sb_grow(sb, cap ? cap : SB_INITIAL_CAP);
+}
+
+int sb_reserve(struct string_builder *sb, size_t extra)
+{
+	if (sb->failed)
+		return 0;
+	if (extra > SIZE_MAX - sb->len - 1) {
+		sb->failed = 1;
+		return 0;
+	}
+	if (sb->len + extra + 1 <= sb->cap)
+		return 1;
+	return sb_grow(sb, sb->len + extra + 1);
+}
+
+int sb_append_char(struct string_builder *sb, char c)
+{
+	if (sb->failed || (sb->len + 2 > sb->cap && !sb_reserve(sb, 1)))
+		return 0;
+	sb->data[sb->len++] = c;
+	sb->data[sb->len] = '\0';
+	return 1;
+}
+
+int sb_append(struct string_builder *sb, const char *data, size_t len)
+{
+	if (!sb_reserve(sb, len))
+		return 0;
+	memcpy(sb->data + sb->len, data, len);
+	sb->len += len;
+	sb->data[sb->len] = '\0';
+	return 1;
+}
+
+int sb_append_sv(struct string_builder *sb, string_view sv)
+{
+	return sb_append(sb, sv.data, sv.len);
+}
+
+int sb_append_cstr(struct string_builder *sb, const char *str)
+{
+	return sb_append(sb, str, strlen(str));
+}
+
+// The numbers are formatted straight into the free space
+int sb_append_u64(struct string_builder *sb, uint64 value)
+{
+	if (!sb_reserve(sb, FMT_U64_MAX))
+		return 0;
+	sb->len += fmt_u64(sb->data + sb->len, value);
+	sb->data[sb->len] = '\0';
+	return 1;
+}
+
+int sb_append_i64(struct string_builder *sb, int64 value)
+{
+	if (!sb_reserve(sb, FMT_I64_MAX))
+		return 0;
+	sb->len += fmt_i64(sb->data + sb->len, value);
+	sb->data[sb->len] = '\0';
+	return 1;
+}
+
+int sb_append_hex64(struct string_builder *sb, uint64 value)
+{
+	if (!sb_reserve(sb, FMT_HEX64_MAX))
+		return 0;
+	sb->len += fmt_hex64(sb->data + sb->len, value);
+	sb->data[sb->len] = '\0';
+	return 1;
+}
+
+// Shortest form that reads back as the same value, see fmt.h
+int sb_append_f64(struct string_builder *sb, f64 value)
+{
+	if (!sb_reserve(sb, FMT_F64_MAX))
+		return 0;
+	sb->len += fmt_f64(sb->data + sb->len, value);
+	sb->data[sb->len] = '\0';
+	return 1;
+}
+
+int sb_vappendf(struct string_builder *sb, const char *format, va_list args)
+{
+	if (sb->failed)
+		return 0;
+
+	// Format straight into the free space, only when the output did
+	// not fit grow once to the exact size and format again.
+	va_list copy;
+	va_copy(copy, args);
+	size_t avail = sb->cap - sb->len;
+	int len = vsnprintf(sb->data + sb->len, avail, format, copy);
+	va_end(copy);
+
+	if (len < 0) {
+		sb->data[sb->len] = '\0';
+		sb->failed = 1;
+		return 0;
+	}
+
+	if ((size_t)len >= avail) {
+		sb->data[sb->len] = '\0';
+		if (!sb_reserve(sb, len))
+			return 0;
+		vsnprintf(sb->data + sb->len, len + 1, format, args);
+	}
+
+	sb->len += len;
+	return 1;
+}
+
+int sb_appendf(struct string_builder *sb, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int ret = sb_vappendf(sb, format, args);
+	va_end(args);
+	return ret;
+}
+
+string_view sb_to_sv(struct string_builder *sb)
+{
+	return (string_view){ .data = sb->data, .len = sb->len };
+}
+
+void sb_reset(struct string_builder *sb)
+{
+	sb->len = 0;
+	sb->failed = 0;
+	if (sb->data)
+		sb->data[0] = '\0';
+}
+
+void sb_free(struct string_builder *sb)
+{
+	if (!sb->arena)
+		free(sb->data);
+	memset(sb, 0, sizeof(*sb));
+}
@@ -24,82 +24,151 @@
 // SOFTWARE.
 
 #include "string_operations.h"
+#include "string_view.h"
+#include "arena.h"
+#include "extra.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(_SDX_AVX2)
+#include <immintrin.h>
+#elif defined(_SDX_SSE2)
+#include <emmintrin.h>
+#endif
+
+static const sv_charset so_whitespace = SV_CHARSET_SPACE_TAB_NEWLINE;
+
+// The NUL terminated versions stop at the terminator, for large or
+// untrusted buffers use the _bounded versions below, they never read
+// past end and scan 16 or 32 bytes per step.
+
 char *so_skip_whitespace(char *in)
 {
-	char *result = in;
-	for (;;) {
-		switch(*result) {
-		case ' ':
-		case '\r':
-		case '\t':
-		case '\n': {
-			result++;
-		} break;
-		default:
-			return result;
-		}
-	}
-	return result;
+	return in + strspn(in, " \r\t\n");
 }
 
 char *so_skip_untill_whitespace(char *in)
 {
-	char *result = in;
-	for (;;) {
-		switch(*result) {
-		case ' ':
-		case '\r':
-		case '\t':
-		case '\n': {
-			return result;
-		} break;
-		default:
-			result++;
-		}
-	}
-	return result;
-
+	return in + strcspn(in, " \r\t\n");
 }
 
 char *so_skip_untill_next_word(char *in)
 {
-	char *result = in;
-	for (;;) {
-		switch(*result) {
-		case ' ':
-		case '\r':
-		case '\t':
-		case '\n': {
-			goto cleanup;
-		} break;
-		default:
-			result++;
-		}
+	return so_skip_whitespace(so_skip_untill_whitespace(in));
+}
+
+// Returns the terminator if there is no x
+char *so_skip_untill_x_char(char *in, char x)
+{
+	char *result = strchr(in, x);
+	return result ? result : in + strlen(in);
+}
+
+#if defined(_SDX_AVX2)
+static inline uint32_t so_whitespace_mask32(__m256i block)
+{
+	__m256i ws = _mm256_or_si256(
+		_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')),
+				_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t'))),
+		_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')),
+				_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r'))));
+	return (uint32_t)_mm256_movemask_epi8(ws);
+}
+#endif
+
+#if defined(_SDX_SSE2)
+static inline uint32_t so_whitespace_mask16(__m128i block)
+{
+	__m128i ws = _mm_or_si128(
+		_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+			     _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+		_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')),
+			     _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+	return (uint32_t)_mm_movemask_epi8(ws);
+}
+#endif
+
+// First byte in [in, end) that is (want == 1) or is not (want == 0)
+// whitespace, end if there is none
+static char *so_scan_whitespace(char *in, char *end, int want)
+{
+	// Runs are mostly short, check the first byte before the blocks
+	if (in == end || sv_charset_has(&so_whitespace, *in) == want)
+		return in;
+	in++;
+
+#if defined(_SDX_AVX2)
+	uint32_t flip32 = want ? 0 : 0xffffffff;
+	for (; end - in >= 32; in += 32) {
+		uint32_t mask = so_whitespace_mask32(_mm256_loadu_si256((const __m256i*)in)) ^ flip32;
+		if (mask)
+			return in + CTZ32(mask);
 	}
+#endif
 
- cleanup:
-	result = so_skip_whitespace(result);
-	return result;
+#if defined(_SDX_SSE2)
+	uint32_t flip16 = want ? 0 : 0xffff;
+	for (; end - in >= 16; in += 16) {
+		uint32_t mask = so_whitespace_mask16(_mm_loadu_si128((const __m128i*)in)) ^ flip16;
+		if (mask)
+			return in + CTZ32(mask);
+	}
+#endif
+
+	for (; in < end; in++)
+		if (sv_charset_has(&so_whitespace, *in) == want)
+			return in;
 
+	return end;
 }
 
-char *so_skip_untill_x_char(char *in, char x)
+char *so_skip_whitespace_bounded(char *in, char *end)
 {
-	char *result = in;
-	while (*result != x)
-		result++;
+	return so_scan_whitespace(in, end, 0);
+}
 
-	return result;
+char *so_skip_untill_whitespace_bounded(char *in, char *end)
+{
+	return so_scan_whitespace(in, end, 1);
+}
+
+char *so_skip_untill_next_word_bounded(char *in, char *end)
+{
+	return so_scan_whitespace(so_scan_whitespace(in, end, 1), end, 0);
+}
+
+char *so_skip_untill_x_char_bounded(char *in, char *end, char x)
+{
+	return in + sv_index_of(sv_from_parts(in, end - in), x);
+}
+
+// Returns the start of the next line, end if this is the last one
+char *so_skip_to_nextline_bounded(char *in, char *end)
+{
+	char *result = so_skip_untill_x_char_bounded(in, end, '\n');
+	return result < end ? result + 1 : end;
 }
 
 // Return a null terminated string from a part of
 // a string
 char *so_get_substring(char *ptr, size_t size)
 {
-	char *result = malloc(size);
+	char *result = malloc(size + 1);
+	if (!result)
+		return NULL;
+	memcpy(result, ptr, size);
+	result[size] = '\0';
+	return result;
+}
+
+// Same as so_get_substring but the copy lives in the arena,
+// use this when pulling out many substrings to free them at once
+char *so_get_substring_arena(struct arena *ar, char *ptr, size_t size)
+{
+	char *result = arena_alloc(ar, size + 1);
+	if (!result)
+		return NULL;
 	memcpy(result, ptr, size);
 	result[size] = '\0';
 	return result;
@@ -115,10 +184,10 @@ void so_get_substring_dest(char *ptr, size_t size, char *dest)
 	dest[size] = '\0';
 }
 
+// Returns the start of the next line, or the terminator if this is
+// the last line
 char *so_skip_to_nextline(char *in)
 {
-	char *result = in;
-	while (*result != '\n' || *result != '\0')
-		result++;
-	return ++result;
+	char *result = so_skip_untill_x_char(in, '\n');
+	return *result ? result + 1 : result;
 }
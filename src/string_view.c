@@ -24,6 +24,26 @@
 // SOFTWARE.
 
 #include "string_view.h"
+#include "extra.h"
+#include "array.h"
+#include "system.h"
+#include <stdint.h>
+
+#ifdef _SDX_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(_SDX_AVX2)
+#include <immintrin.h>
+#elif defined(_SDX_SSSE3)
+#include <tmmintrin.h>
+#elif defined(_SDX_SSE2)
+#include <emmintrin.h>
+#endif
+
+static const sv_charset sv_whitespace = SV_CHARSET_WHITESPACE;
 
 SV_DEF string_view sv_from_parts(char *data, size_t len)
 {
@@ -50,6 +70,200 @@ SV_DEF int sv_eq(string_view a, string_view b)
 	}
 }
 
+/*
+ * ASCII case folding, only 'A'-'Z' and 'a'-'z' are touched. The SIMD
+ * versions find the letters with one signed compare: c - 'A' + 128
+ * is below -128 + 26 exactly for the 26 letters.
+ */
+static inline unsigned char sv_ascii_lower(unsigned char c)
+{
+	return c | (((unsigned char)(c - 'A') < 26) << 5);
+}
+
+static inline unsigned char sv_ascii_upper(unsigned char c)
+{
+	return c & ~(((unsigned char)(c - 'a') < 26) << 5);
+}
+
+#if defined(_SDX_AVX2)
+static inline __m256i sv_ascii_lower32(__m256i x)
+{
+	__m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 26),
+					  _mm256_add_epi8(x, _mm256_set1_epi8(128 - 'A')));
+	return _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+#endif
+
+#if defined(_SDX_SSE2)
+static inline __m128i sv_ascii_lower16(__m128i x)
+{
+	__m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(-128 + 26), _mm_add_epi8(x, _mm_set1_epi8(128 - 'A')));
+	return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+// a and b have at least len bytes
+static int sv_eq_icase_len(const char *a, const char *b, size_t len)
+{
+	size_t i = 0;
+
+#if defined(_SDX_AVX2)
+	for (; i + 32 <= len; i += 32) {
+		__m256i x = sv_ascii_lower32(_mm256_loadu_si256((const __m256i*)(a + i)));
+		__m256i y = sv_ascii_lower32(_mm256_loadu_si256((const __m256i*)(b + i)));
+		if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != 0xffffffff)
+			return 0;
+	}
+#endif
+#if defined(_SDX_SSE2)
+	for (; i + 16 <= len; i += 16) {
+		__m128i x = sv_ascii_lower16(_mm_loadu_si128((const __m128i*)(a + i)));
+		__m128i y = sv_ascii_lower16(_mm_loadu_si128((const __m128i*)(b + i)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff)
+			return 0;
+	}
+#endif
+
+	for (; i < len; i++)
+		if (sv_ascii_lower(a[i]) != sv_ascii_lower(b[i]))
+			return 0;
+
+	return 1;
+}
+
+/**
+ * Same as sv_eq() but ignoring ASCII case, "Content-Length" and
+ * "content-length" are equal. Bytes above 0x7f must match exactly.
+ */
+SV_DEF int sv_eq_icase(string_view a, string_view b)
+{
+	return a.len == b.len && sv_eq_icase_len(a.data, b.data, a.len);
+}
+
+SV_DEF int sv_starts_with_icase(string_view sv, string_view prefix)
+{
+	return sv.len >= prefix.len && sv_eq_icase_len(sv.data, prefix.data, prefix.len);
+}
+
+/**
+ * Byte wise order, a prefix is ordered before the longer string
+ *
+ * @return {int}: < 0 if a < b, 0 if equal and > 0 if a > b
+ */
+SV_DEF int sv_cmp(string_view a, string_view b)
+{
+	int r = memcmp(a.data, b.data, a.len < b.len ? a.len : b.len);
+	if (r != 0)
+		return r;
+
+	return (a.len > b.len) - (a.len < b.len);
+}
+
+/**
+ * sv_cmp() for qsort() and bsearch() on arrays of string_view
+ */
+SV_DEF int sv_compare(const void *a, const void *b)
+{
+	return sv_cmp(*(const string_view*)a, *(const string_view*)b);
+}
+
+// In place, sv has to point to writable memory
+SV_DEF void sv_to_lower(string_view sv)
+{
+	size_t i = 0;
+
+#if defined(_SDX_AVX2)
+	for (; i + 32 <= sv.len; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)(sv.data + i));
+		_mm256_storeu_si256((__m256i*)(sv.data + i), sv_ascii_lower32(x));
+	}
+#endif
+#if defined(_SDX_SSE2)
+	for (; i + 16 <= sv.len; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(sv.data + i));
+		_mm_storeu_si128((__m128i*)(sv.data + i), sv_ascii_lower16(x));
+	}
+#endif
+
+	for (; i < sv.len; i++)
+		sv.data[i] = sv_ascii_lower(sv.data[i]);
+}
+
+SV_DEF void sv_to_upper(string_view sv)
+{
+	size_t i = 0;
+
+#if defined(_SDX_AVX2)
+	for (; i + 32 <= sv.len; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)(sv.data + i));
+		__m256i lower = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 26),
+						  _mm256_add_epi8(x, _mm256_set1_epi8(128 - 'a')));
+		x = _mm256_andnot_si256(_mm256_and_si256(lower, _mm256_set1_epi8(0x20)), x);
+		_mm256_storeu_si256((__m256i*)(sv.data + i), x);
+	}
+#endif
+#if defined(_SDX_SSE2)
+	for (; i + 16 <= sv.len; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(sv.data + i));
+		__m128i lower = _mm_cmpgt_epi8(_mm_set1_epi8(-128 + 26), _mm_add_epi8(x, _mm_set1_epi8(128 - 'a')));
+		x = _mm_andnot_si128(_mm_and_si128(lower, _mm_set1_epi8(0x20)), x);
+		_mm_storeu_si128((__m128i*)(sv.data + i), x);
+	}
+#endif
+
+	for (; i < sv.len; i++)
+		sv.data[i] = sv_ascii_upper(sv.data[i]);
+}
+
+/**
+ * Find the first occurrence of c. Scans 64 bytes per iteration with
+ * AVX2, 16 with SSE2 and falls back to memchr() without either.
+ *
+ * @return {size_t}: index of c, sv.len if there is none.
+ */
+SV_DEF size_t sv_index_of(string_view sv, char c)
+{
+	const char *data = sv.data;
+	size_t len = sv.len;
+	size_t i = 0;
+
+#if defined(_SDX_AVX2)
+	__m256i needle = _mm256_set1_epi8(c);
+	for (; i + 64 <= len; i += 64) {
+		__m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i)), needle);
+		__m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i + 32)), needle);
+		if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b))) {
+			uint64_t mask = (uint32_t)_mm256_movemask_epi8(a) |
+				((uint64_t)(uint32_t)_mm256_movemask_epi8(b) << 32);
+			return i + CTZ64(mask);
+		}
+	}
+	for (; i + 32 <= len; i += 32) {
+		uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i)), needle));
+		if (mask)
+			return i + CTZ32(mask);
+	}
+#endif
+
+#if defined(_SDX_SSE2)
+	__m128i needle16 = _mm_set1_epi8(c);
+	for (; i + 16 <= len; i += 16) {
+		uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), needle16));
+		if (mask)
+			return i + CTZ32(mask);
+	}
+
+	for (; i < len; i++)
+		if (data[i] == c)
+			return i;
+
+	return len;
+#else
+	const char *found = len ? memchr(data, c, len) : NULL;
+	return found ? (size_t)(found - data) : len;
+#endif
+}
+
 SV_DEF string_view sv_chop_left(string_view *sv, size_t n)
 {
 	if (n > sv->len) {
@@ -79,9 +293,7 @@ SV_DEF string_view sv_chop_right(string_view *sv, size_t n)
 
 SV_DEF string_view sv_chop_by_delim(string_view *sv, char delim)
 {
-	size_t i = 0;
-	while (i < sv->len && sv->data[i] != delim)
-		i++;
+	size_t i = sv_index_of(*sv, delim);
 
 	string_view tmp = sv_from_parts(sv->data, i);
 
@@ -98,9 +310,7 @@ SV_DEF string_view sv_chop_by_delim(string_view *sv, char delim)
 
 SV_DEF int sv_try_chop_by_delim(string_view *sv, char delim, string_view *dest)
 {
-	size_t i = 0;
-	while (i < sv->len && sv->data[i] != delim)
-		i++;
+	size_t i = sv_index_of(*sv, delim);
 
 	string_view result = sv_from_parts(sv->data, i);
 
@@ -116,30 +326,126 @@ SV_DEF int sv_try_chop_by_delim(string_view *sv, char delim, string_view *dest)
 	return 0;
 }
 
+/*
+ * Needles up to this length are searched with the SIMD first and last
+ * byte filter, longer ones with Boyer-Moore-Horspool.
+ */
+#define SV_FIND_SHORT_NEEDLE 32
+
+/*
+ * Compare the first and the last byte of the needle against 16/32
+ * positions at once, only the positions where both match are checked
+ * with memcmp. Returns the index or (size_t)-1 after scanning every
+ * position it can load a full block for, *next is set to where the
+ * caller has to continue with the scalar loop.
+ */
+static size_t sv_find_simd(string_view h, string_view n, size_t *next)
+{
+	size_t i = 0;
+
+#if defined(_SDX_AVX2)
+	__m256i first32 = _mm256_set1_epi8(n.data[0]);
+	__m256i last32 = _mm256_set1_epi8(n.data[n.len - 1]);
+	for (; i + n.len - 1 + 32 <= h.len; i += 32) {
+		__m256i a = _mm256_cmpeq_epi8(first32, _mm256_loadu_si256((const __m256i*)(h.data + i)));
+		__m256i b = _mm256_cmpeq_epi8(last32, _mm256_loadu_si256((const __m256i*)(h.data + i + n.len - 1)));
+		uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(a, b));
+		while (mask) {
+			size_t pos = i + CTZ32(mask);
+			if (memcmp(h.data + pos + 1, n.data + 1, n.len - 2) == 0)
+				return pos;
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+#if defined(_SDX_SSE2)
+	__m128i first = _mm_set1_epi8(n.data[0]);
+	__m128i last = _mm_set1_epi8(n.data[n.len - 1]);
+	for (; i + n.len - 1 + 16 <= h.len; i += 16) {
+		__m128i a = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)(h.data + i)));
+		__m128i b = _mm_cmpeq_epi8(last, _mm_loadu_si128((const __m128i*)(h.data + i + n.len - 1)));
+		uint32_t mask = _mm_movemask_epi8(_mm_and_si128(a, b));
+		while (mask) {
+			size_t pos = i + CTZ32(mask);
+			if (memcmp(h.data + pos + 1, n.data + 1, n.len - 2) == 0)
+				return pos;
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	*next = i;
+	return (size_t)-1;
+}
+
+static size_t sv_find_horspool(string_view h, string_view n)
+{
+	size_t skip[256];
+	for (int i = 0; i < 256; i++)
+		skip[i] = n.len;
+	for (size_t i = 0; i + 1 < n.len; i++)
+		skip[(unsigned char)n.data[i]] = n.len - 1 - i;
+
+	unsigned char last = n.data[n.len - 1];
+	size_t i = 0;
+	while (i <= h.len - n.len) {
+		unsigned char c = h.data[i + n.len - 1];
+		if (c == last && memcmp(h.data + i, n.data, n.len - 1) == 0)
+			return i;
+		i += skip[c];
+	}
+
+	return h.len;
+}
+
 /**
- * Return trimmed part, do not advance
+ * Find the first occurrence of needle in haystack.
  *
- * @param {string_view*} sv: target sv object
- * @param {string_view} delim: delimeter string
- * @return {string_view} part that is trimmed
+ * @return {size_t}: index of needle, haystack.len if there is none.
+ * An empty needle is found at 0.
  */
-
-SV_DEF string_view sv_chop_by_sv(string_view *sv, string_view delim)
+SV_DEF size_t sv_find(string_view haystack, string_view needle)
 {
-	string_view window = sv_from_parts(sv->data, delim.len);
+	if (needle.len == 0)
+		return 0;
+	if (needle.len > haystack.len)
+		return haystack.len;
+	if (needle.len == 1)
+		return sv_index_of(haystack, needle.data[0]);
+	if (needle.len > SV_FIND_SHORT_NEEDLE)
+		return sv_find_horspool(haystack, needle);
+
 	size_t i = 0;
-	while (i + delim.len < sv->len && !(sv_eq(window, delim))) {
+	size_t found = sv_find_simd(haystack, needle, &i);
+	if (found != (size_t)-1)
+		return found;
+
+	// Positions the blocks could not reach, memchr the first byte
+	while (i + needle.len <= haystack.len) {
+		const char *p = memchr(haystack.data + i, needle.data[0], haystack.len - needle.len - i + 1);
+		if (p == NULL)
+			break;
+		i = p - haystack.data;
+		if (memcmp(p + 1, needle.data + 1, needle.len - 1) == 0)
+			return i;
 		i++;
-		window.data++;
 	}
 
-	string_view result = sv_from_parts(sv->data, i);
+	return haystack.len;
+}
 
-	if (i + delim.len == sv->len) {
-		result.len += delim.len;
-	}
+/**
+ * Return trimmed part, do not advance
+ *
+ * @param {string_view*} sv: target sv object
+ * @param {string_view} delim: delimeter string
+ * @return {string_view} part before delim, the whole sv if delim is not found
+ */
 
-	return result;
+SV_DEF string_view sv_chop_by_sv(string_view *sv, string_view delim)
+{
+	return sv_from_parts(sv->data, sv_find(*sv, delim));
 }
 
 /**
@@ -152,9 +458,7 @@ SV_DEF string_view sv_chop_by_sv(string_view *sv, string_view delim)
 
 SV_DEF string_view sv_trim_by_delim(string_view *sv, char delim)
 {
-	size_t i = 0;
-	while (i < sv->len && sv->data[i] != delim)
-		i++;
+	size_t i = sv_index_of(*sv, delim);
 
 	string_view trimmed_part = sv_from_parts(sv->data, i);
 
@@ -179,64 +483,753 @@ SV_DEF string_view sv_trim_by_delim(string_view *sv, char delim)
 
 SV_DEF string_view sv_trim_by_sv(string_view *sv, string_view delim)
 {
-	string_view window = sv_from_parts(sv->data, delim.len);
+	size_t i = sv_find(*sv, delim);
+	string_view result = sv_from_parts(sv->data, i);
+
+	if (i < sv->len) {
+		sv->data += i + delim.len;
+		sv->len -= i + delim.len;
+	} else {
+		sv->data += i;
+		sv->len = 0;
+	}
+
+	return result;
+}
+
+SV_DEF string_view sv_trim_left(string_view sv)
+{
+	return sv_trim_left_any(sv, &sv_whitespace);
+}
+
+SV_DEF string_view sv_trim_right(string_view sv)
+{
+	return sv_trim_right_any(sv, &sv_whitespace);
+}
+
+SV_DEF string_view sv_trim(string_view sv)
+{
+	return sv_trim_right(sv_trim_left(sv));
+}
+
+/**
+ * The rest of sv after its first newline, sv itself when there is no
+ * newline or nothing follows it. See line_index.h for random access.
+ */
+SV_DEF string_view sv_next_line(string_view sv)
+{
+	size_t i = sv_index_of(sv, '\n');
+	if (i + 1 >= sv.len)
+		return sv;
+
+	return sv_from_parts(sv.data + i + 1, sv.len - i - 1);
+}
+
+SV_DEF void sv_charset_add(sv_charset *cs, unsigned char c)
+{
+	unsigned char *table = c < 0x80 ? cs->low : cs->high;
+	table[c & 15] |= 1 << ((c >> 4) & 7);
+}
+
+SV_DEF sv_charset sv_charset_from_parts(const char *chars, size_t len)
+{
+	sv_charset cs;
+	memset(&cs, 0, sizeof(cs));
+	for (size_t i = 0; i < len; i++)
+		sv_charset_add(&cs, chars[i]);
+	return cs;
+}
+
+SV_DEF sv_charset sv_charset_from_cstr(const char *chars)
+{
+	return sv_charset_from_parts(chars, strlen(chars));
+}
+
+/*
+ * Membership of 16/32 bytes with three pshufb lookups: the low nibble
+ * picks a row of the table for both halves, the high nibble picks the
+ * bit in the row and the sign bit picks the half.
+ */
+#if defined(_SDX_AVX2)
+static inline uint32_t sv_charset_mask32(__m256i block, __m256i low, __m256i high, __m256i bits)
+{
+	__m256i nibble_mask = _mm256_set1_epi8(0x0f);
+	__m256i lo = _mm256_and_si256(block, nibble_mask);
+	__m256i hi = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble_mask);
+	__m256i is_high = _mm256_cmpgt_epi8(_mm256_setzero_si256(), block);
+	__m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(low, lo), _mm256_shuffle_epi8(high, lo), is_high);
+	__m256i bit = _mm256_shuffle_epi8(bits, hi);
+	return _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit));
+}
+#endif
+
+#if defined(_SDX_SSSE3)
+static inline uint32_t sv_charset_mask16(__m128i block, __m128i low, __m128i high, __m128i bits)
+{
+	__m128i nibble_mask = _mm_set1_epi8(0x0f);
+	__m128i lo = _mm_and_si128(block, nibble_mask);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(block, 4), nibble_mask);
+	__m128i is_high = _mm_cmplt_epi8(block, _mm_setzero_si128());
+	__m128i row = _mm_or_si128(_mm_and_si128(is_high, _mm_shuffle_epi8(high, lo)),
+				   _mm_andnot_si128(is_high, _mm_shuffle_epi8(low, lo)));
+	__m128i bit = _mm_shuffle_epi8(bits, hi);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), bit));
+}
+#endif
+
+// Index of the first byte whose membership is not skip_members
+static size_t sv_charset_scan(string_view sv, const sv_charset *cs, int skip_members)
+{
 	size_t i = 0;
-	while (i + delim.len < sv->len && !(sv_eq(window, delim))) {
-		i++;
-		window.data++;
+
+#if defined(_SDX_AVX2)
+	{
+		__m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)cs->low));
+		__m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)cs->high));
+		__m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+						1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+		uint32_t flip = skip_members ? 0xffffffff : 0;
+		for (; i + 32 <= sv.len; i += 32) {
+			__m256i block = _mm256_loadu_si256((const __m256i*)(sv.data + i));
+			uint32_t mask = sv_charset_mask32(block, low, high, bits) ^ flip;
+			if (mask)
+				return i + CTZ32(mask);
+		}
+	}
+#endif
+
+#if defined(_SDX_SSSE3)
+	{
+		__m128i low = _mm_loadu_si128((const __m128i*)cs->low);
+		__m128i high = _mm_loadu_si128((const __m128i*)cs->high);
+		__m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+		uint32_t flip = skip_members ? 0xffff : 0;
+		for (; i + 16 <= sv.len; i += 16) {
+			__m128i block = _mm_loadu_si128((const __m128i*)(sv.data + i));
+			uint32_t mask = sv_charset_mask16(block, low, high, bits) ^ flip;
+			if (mask)
+				return i + CTZ32(mask);
+		}
 	}
+#endif
+
+	for (; i < sv.len; i++)
+		if (sv_charset_has(cs, sv.data[i]) != skip_members)
+			return i;
+
+	return sv.len;
+}
+
+/**
+ * Length of the prefix of sv that only has bytes in cs
+ */
+SV_DEF size_t sv_span(string_view sv, const sv_charset *cs)
+{
+	return sv_charset_scan(sv, cs, 1);
+}
 
+/**
+ * Length of the prefix of sv that has no bytes in cs
+ */
+SV_DEF size_t sv_cspan(string_view sv, const sv_charset *cs)
+{
+	return sv_charset_scan(sv, cs, 0);
+}
+
+/**
+ * Same as sv_chop_by_delim() but any byte in cs is a delimiter
+ */
+SV_DEF string_view sv_chop_by_any(string_view *sv, const sv_charset *cs)
+{
+	size_t i = sv_cspan(*sv, cs);
 	string_view result = sv_from_parts(sv->data, i);
 
-	if (i + delim.len == sv->len) {
-		result.len += delim.len;
-	}
+	if (i < sv->len)
+		i++;
 
-	sv->data += i + delim.len;
-	sv->len -= i + delim.len;
+	sv->data += i;
+	sv->len -= i;
 
 	return result;
 }
 
-SV_DEF string_view sv_trim_left(string_view sv)
+SV_DEF string_view sv_trim_left_any(string_view sv, const sv_charset *cs)
+{
+	size_t i = sv_span(sv, cs);
+	return sv_from_parts(sv.data + i, sv.len - i);
+}
+
+SV_DEF string_view sv_trim_right_any(string_view sv, const sv_charset *cs)
+{
+	size_t len = sv.len;
+	while (len > 0 && sv_charset_has(cs, sv.data[len - 1]))
+		len--;
+
+	return sv_from_parts(sv.data, len);
+}
+
+SV_DEF string_view sv_trim_any(string_view sv, const sv_charset *cs)
+{
+	return sv_trim_right_any(sv_trim_left_any(sv, cs), cs);
+}
+
+/*
+ * Bitmask of the delimiter positions in the 64 bytes at p, bit i is set
+ * if p[i] is a delimiter. With cs == NULL the delimiter is delim.
+ */
+static inline uint64_t sv_split_mask64(const char *p, char delim, const sv_charset *cs)
+{
+#if defined(_SDX_AVX2)
+	__m256i a = _mm256_loadu_si256((const __m256i*)p);
+	__m256i b = _mm256_loadu_si256((const __m256i*)(p + 32));
+	if (cs == NULL) {
+		__m256i d = _mm256_set1_epi8(delim);
+		return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, d)) |
+			((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, d)) << 32);
+	}
+
+	__m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)cs->low));
+	__m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)cs->high));
+	__m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+					1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	return sv_charset_mask32(a, low, high, bits) | ((uint64_t)sv_charset_mask32(b, low, high, bits) << 32);
+#else
+	uint64_t mask = 0;
+#if defined(_SDX_SSSE3)
+	if (cs != NULL) {
+		__m128i low = _mm_loadu_si128((const __m128i*)cs->low);
+		__m128i high = _mm_loadu_si128((const __m128i*)cs->high);
+		__m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+		for (int i = 0; i < 4; i++) {
+			__m128i block = _mm_loadu_si128((const __m128i*)(p + i * 16));
+			mask |= (uint64_t)sv_charset_mask16(block, low, high, bits) << (i * 16);
+		}
+		return mask;
+	}
+#endif
+#if defined(_SDX_SSE2)
+	if (cs == NULL) {
+		__m128i d = _mm_set1_epi8(delim);
+		for (int i = 0; i < 4; i++) {
+			__m128i block = _mm_loadu_si128((const __m128i*)(p + i * 16));
+			mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, d)) << (i * 16);
+		}
+		return mask;
+	}
+#endif
+	for (int i = 0; i < 64; i++) {
+		int hit = cs ? sv_charset_has(cs, p[i]) : p[i] == delim;
+		mask |= (uint64_t)hit << i;
+	}
+	return mask;
+#endif
+}
+
+/*
+ * One pass over sv: every 64 byte block is turned into a bitmask of
+ * delimiter positions and the set bits become tokens, written straight
+ * into the array storage.
+ */
+static int sv_split_all_impl(string_view sv, char delim, const sv_charset *cs, struct array *out)
 {
+	size_t start = 0;
 	size_t i = 0;
-	while (i < sv.len && isspace(sv.data[i])) {
-		i += 1;
+
+	for (; i < sv.len; i += 64) {
+		uint64_t mask;
+		if (i + 64 <= sv.len) {
+			mask = sv_split_mask64(sv.data + i, delim, cs);
+		} else {
+			mask = 0;
+			for (size_t j = 0; i + j < sv.len; j++) {
+				unsigned char c = sv.data[i + j];
+				int hit = cs ? sv_charset_has(cs, c) : c == (unsigned char)delim;
+				mask |= (uint64_t)hit << j;
+			}
+		}
+
+		if (mask == 0)
+			continue;
+
+		if (!array_reserve(out, POPCOUNT64(mask)))
+			return 0;
+
+		string_view *tokens = (string_view*)out->data + out->index;
+		size_t n = 0;
+		while (mask) {
+			size_t pos = i + CTZ64(mask);
+			tokens[n].data = sv.data + start;
+			tokens[n].len = pos - start;
+			n++;
+			start = pos + 1;
+			mask &= mask - 1;
+		}
+		out->index += n;
 	}
 
-	return sv_from_parts(sv.data + i, sv.len - i);
+	if (start < sv.len) {
+		if (!array_reserve(out, 1))
+			return 0;
+		string_view *token = (string_view*)out->data + out->index++;
+		token->data = sv.data + start;
+		token->len = sv.len - start;
+	}
+
+	return 1;
 }
 
-SV_DEF string_view sv_trim_right(string_view sv)
+/**
+ * Split the whole of sv on delim and append the tokens to out, which
+ * has to be initialized with an itemsize of sizeof(string_view). The
+ * tokens are the same as calling sv_chop_by_delim() until sv is empty.
+ *
+ * @return {int}: 1 on success, 0 if out could not be grown
+ */
+SV_DEF int sv_split_all(string_view sv, char delim, struct array *out)
+{
+	return sv_split_all_impl(sv, delim, NULL, out);
+}
+
+/**
+ * Same as sv_split_all() but any byte in cs is a delimiter
+ */
+SV_DEF int sv_split_all_any(string_view sv, const sv_charset *cs, struct array *out)
+{
+	return sv_split_all_impl(sv, 0, cs, out);
+}
+
+struct sv_split_job {
+	string_view sv;
+	char delim;
+	const sv_charset *cs;
+	struct array tokens;
+	int ok;
+};
+
+#ifdef _SDX_WINDOWS
+static DWORD WINAPI sv_split_worker(LPVOID arg)
+#else
+static void *sv_split_worker(void *arg)
+#endif
+{
+	struct sv_split_job *job = arg;
+	job->ok = array_init(&job->tokens, sizeof(string_view), job->sv.len / 64 + 1) &&
+		sv_split_all_impl(job->sv, job->delim, job->cs, &job->tokens);
+	return 0;
+}
+
+static int sv_split_all_parallel_impl(string_view sv, char delim, const sv_charset *cs,
+				      struct array *out, int nthreads)
+{
+	if (nthreads <= 0)
+		nthreads = sys_get_num_cpu_core_avail();
+	if ((size_t)nthreads > sv.len / SV_SPLIT_PARALLEL_MIN_CHUNK)
+		nthreads = sv.len / SV_SPLIT_PARALLEL_MIN_CHUNK;
+	if (nthreads <= 1)
+		return sv_split_all_impl(sv, delim, cs, out);
+
+	struct sv_split_job *jobs = calloc(nthreads, sizeof(*jobs));
+	if (jobs == NULL)
+		return 0;
+
+	/*
+	 * Chunks end right after a delimiter so no token crosses two of
+	 * them, which keeps the result identical to the serial split.
+	 */
+	size_t start = 0;
+	for (int t = 0; t < nthreads; t++) {
+		size_t end = sv.len;
+		if (t < nthreads - 1) {
+			end = MAX(start, sv.len / nthreads * (t + 1));
+			string_view rest = sv_from_parts(sv.data + end, sv.len - end);
+			end += cs ? sv_cspan(rest, cs) : sv_index_of(rest, delim);
+			end = MIN(end + 1, sv.len);
+		}
+		jobs[t].sv = sv_from_parts(sv.data + start, end - start);
+		jobs[t].delim = delim;
+		jobs[t].cs = cs;
+		start = end;
+	}
+
+	int started = 0;
+#ifdef _SDX_WINDOWS
+	HANDLE *threads = malloc(nthreads * sizeof(*threads));
+	if (threads != NULL) {
+		for (; started < nthreads; started++) {
+			threads[started] = CreateThread(NULL, 0, sv_split_worker, &jobs[started], 0, NULL);
+			if (threads[started] == NULL)
+				break;
+		}
+	}
+#else
+	pthread_t *threads = malloc(nthreads * sizeof(*threads));
+	if (threads != NULL) {
+		for (; started < nthreads; started++)
+			if (pthread_create(&threads[started], NULL, sv_split_worker, &jobs[started]) != 0)
+				break;
+	}
+#endif
+
+	// Whatever could not be handed to a thread runs here
+	for (int t = started; t < nthreads; t++)
+		sv_split_worker(&jobs[t]);
+
+	for (int t = 0; t < started; t++) {
+#ifdef _SDX_WINDOWS
+		WaitForSingleObject(threads[t], INFINITE);
+		CloseHandle(threads[t]);
+#else
+		pthread_join(threads[t], NULL);
+#endif
+	}
+	free(threads);
+
+	size_t total = 0;
+	int ok = 1;
+	for (int t = 0; t < nthreads; t++) {
+		total += jobs[t].tokens.index;
+		ok &= jobs[t].ok;
+	}
+
+	if (ok && array_reserve(out, total)) {
+		for (int t = 0; t < nthreads; t++) {
+			memcpy((string_view*)out->data + out->index, jobs[t].tokens.data,
+			       jobs[t].tokens.index * sizeof(string_view));
+			out->index += jobs[t].tokens.index;
+		}
+	} else {
+		ok = 0;
+	}
+
+	for (int t = 0; t < nthreads; t++)
+		if (jobs[t].tokens.data != NULL)
+			array_free(&jobs[t].tokens);
+	free(jobs);
+
+	return ok;
+}
+
+/**
+ * Same result as sv_split_all(), the input is cut into nthreads chunks
+ * that are split on their own threads. nthreads 0 uses every available
+ * core, small inputs are split on the calling thread.
+ */
+SV_DEF int sv_split_all_parallel(string_view sv, char delim, struct array *out, int nthreads)
+{
+	return sv_split_all_parallel_impl(sv, delim, NULL, out, nthreads);
+}
+
+SV_DEF int sv_split_all_any_parallel(string_view sv, const sv_charset *cs, struct array *out, int nthreads)
+{
+	return sv_split_all_parallel_impl(sv, 0, cs, out, nthreads);
+}
+
+/*
+ * Length of the well formed UTF-8 sequence at p (Unicode table 3-7),
+ * 0 if it is invalid or truncated.
+ */
+static inline size_t sv_utf8_decode(const unsigned char *p, size_t len, uint32_t *codepoint)
+{
+	unsigned char c = p[0];
+
+	if (c < 0x80) {
+		*codepoint = c;
+		return 1;
+	}
+
+	if (c >= 0xc2 && c <= 0xdf) {
+		if (len < 2 || (p[1] & 0xc0) != 0x80)
+			return 0;
+		*codepoint = ((uint32_t)(c & 0x1f) << 6) | (p[1] & 0x3f);
+		return 2;
+	}
+
+	if (c >= 0xe0 && c <= 0xef) {
+		unsigned char lo = c == 0xe0 ? 0xa0 : 0x80;
+		unsigned char hi = c == 0xed ? 0x9f : 0xbf;
+		if (len < 3 || p[1] < lo || p[1] > hi || (p[2] & 0xc0) != 0x80)
+			return 0;
+		*codepoint = ((uint32_t)(c & 0x0f) << 12) | ((uint32_t)(p[1] & 0x3f) << 6) | (p[2] & 0x3f);
+		return 3;
+	}
+
+	if (c >= 0xf0 && c <= 0xf4) {
+		unsigned char lo = c == 0xf0 ? 0x90 : 0x80;
+		unsigned char hi = c == 0xf4 ? 0x8f : 0xbf;
+		if (len < 4 || p[1] < lo || p[1] > hi || (p[2] & 0xc0) != 0x80 || (p[3] & 0xc0) != 0x80)
+			return 0;
+		*codepoint = ((uint32_t)(c & 0x07) << 18) | ((uint32_t)(p[1] & 0x3f) << 12) |
+			((uint32_t)(p[2] & 0x3f) << 6) | (p[3] & 0x3f);
+		return 4;
+	}
+
+	return 0;
+}
+
+static int sv_utf8_validate_scalar(const unsigned char *p, size_t len)
 {
 	size_t i = 0;
-	while (i < sv.len && isspace(sv.data[sv.len - 1 - i])) {
-		i += 1;
+	uint32_t codepoint;
+
+	while (i < len) {
+		// 8 ascii bytes at a time
+		while (i + 8 <= len) {
+			uint64_t chunk;
+			memcpy(&chunk, p + i, sizeof(chunk));
+			if (chunk & 0x8080808080808080ULL)
+				break;
+			i += 8;
+		}
+		if (i == len)
+			break;
+
+		size_t n = sv_utf8_decode(p + i, len - i, &codepoint);
+		if (n == 0)
+			return 0;
+		i += n;
 	}
 
-	return sv_from_parts(sv.data, sv.len - i);
+	return 1;
 }
 
-SV_DEF string_view sv_trim(string_view sv)
+#if defined(_SDX_SSSE3)
+/*
+ * Keiser-Lemire validation, "Validating UTF-8 In Less Than One
+ * Instruction Per Byte". Three nibble lookups (high and low nibble of
+ * the previous byte, high nibble of the current one) give the errors
+ * that can be seen from two bytes, the 3rd/4th byte continuations are
+ * checked against the lead bytes 2 and 3 positions back.
+ */
+#define SV_UTF8_TOO_SHORT	(1 << 0)	// 11______ 0_______, 11______ 11______
+#define SV_UTF8_TOO_LONG	(1 << 1)	// 0_______ 10______
+#define SV_UTF8_OVERLONG_3	(1 << 2)	// 11100000 100_____
+#define SV_UTF8_TOO_LARGE	(1 << 3)	// 11110100 1001____, 11110100 101_____
+#define SV_UTF8_SURROGATE	(1 << 4)	// 11101101 101_____
+#define SV_UTF8_OVERLONG_2	(1 << 5)	// 1100000_ 10______
+#define SV_UTF8_TOO_LARGE_1000	(1 << 6)	// 11110101 1000____, 1111011_ 1000____, 11111___ 1000____
+#define SV_UTF8_OVERLONG_4	(1 << 6)	// 11110000 1000____
+#define SV_UTF8_TWO_CONTS	(1 << 7)	// 10______ 10______
+#define SV_UTF8_CARRY		(SV_UTF8_TOO_SHORT | SV_UTF8_TOO_LONG | SV_UTF8_TWO_CONTS)
+
+static const unsigned char sv_utf8_byte_1_high[16] = {
+	SV_UTF8_TOO_LONG, SV_UTF8_TOO_LONG, SV_UTF8_TOO_LONG, SV_UTF8_TOO_LONG,
+	SV_UTF8_TOO_LONG, SV_UTF8_TOO_LONG, SV_UTF8_TOO_LONG, SV_UTF8_TOO_LONG,
+	SV_UTF8_TWO_CONTS, SV_UTF8_TWO_CONTS, SV_UTF8_TWO_CONTS, SV_UTF8_TWO_CONTS,
+	SV_UTF8_TOO_SHORT | SV_UTF8_OVERLONG_2,
+	SV_UTF8_TOO_SHORT,
+	SV_UTF8_TOO_SHORT | SV_UTF8_OVERLONG_3 | SV_UTF8_SURROGATE,
+	SV_UTF8_TOO_SHORT | SV_UTF8_TOO_LARGE | SV_UTF8_TOO_LARGE_1000 | SV_UTF8_OVERLONG_4,
+};
+
+static const unsigned char sv_utf8_byte_1_low[16] = {
+	SV_UTF8_CARRY | SV_UTF8_OVERLONG_3 | SV_UTF8_OVERLONG_2 | SV_UTF8_OVERLONG_4,
+	SV_UTF8_CARRY | SV_UTF8_OVERLONG_2,
+	SV_UTF8_CARRY,
+	SV_UTF8_CARRY,
+	SV_UTF8_CARRY | SV_UTF8_TOO_LARGE,
+	SV_UTF8_CARRY | SV_UTF8_TOO_LARGE | SV_UTF8_TOO_LARGE_1000,
+	SV_UTF8_CARRY | SV_UTF8_TOO_LARGE | SV_UTF8_TOO_LARGE_1000,
+	SV_UTF8_CARRY | SV_UTF8_TOO_LARGE | SV_UTF8_TOO_LARGE_1000,
+	SV_UTF8_CARRY | SV_UTF8_TOO_LARGE | SV_UTF8_TOO_LARGE_1000,
+	SV_UTF8_CARRY | SV_UTF8_TOO_LARGE | SV_UTF8_TOO_LARGE_1000,
+	SV_UTF8_CARRY | SV_UTF8_TOO_LARGE | SV_UTF8_TOO_LARGE_1000,
+	SV_UTF8_CARRY | SV_UTF8_TOO_LARGE | SV_UTF8_TOO_LARGE_1000,
+	SV_UTF8_CARRY | SV_UTF8_TOO_LARGE | SV_UTF8_TOO_LARGE_1000,
+	SV_UTF8_CARRY | SV_UTF8_TOO_LARGE | SV_UTF8_TOO_LARGE_1000 | SV_UTF8_SURROGATE,
+	SV_UTF8_CARRY | SV_UTF8_TOO_LARGE | SV_UTF8_TOO_LARGE_1000,
+	SV_UTF8_CARRY | SV_UTF8_TOO_LARGE | SV_UTF8_TOO_LARGE_1000,
+};
+
+static const unsigned char sv_utf8_byte_2_high[16] = {
+	SV_UTF8_TOO_SHORT, SV_UTF8_TOO_SHORT, SV_UTF8_TOO_SHORT, SV_UTF8_TOO_SHORT,
+	SV_UTF8_TOO_SHORT, SV_UTF8_TOO_SHORT, SV_UTF8_TOO_SHORT, SV_UTF8_TOO_SHORT,
+	SV_UTF8_TOO_LONG | SV_UTF8_OVERLONG_2 | SV_UTF8_TWO_CONTS | SV_UTF8_OVERLONG_3 |
+	SV_UTF8_TOO_LARGE_1000 | SV_UTF8_OVERLONG_4,
+	SV_UTF8_TOO_LONG | SV_UTF8_OVERLONG_2 | SV_UTF8_TWO_CONTS | SV_UTF8_OVERLONG_3 | SV_UTF8_TOO_LARGE,
+	SV_UTF8_TOO_LONG | SV_UTF8_OVERLONG_2 | SV_UTF8_TWO_CONTS | SV_UTF8_SURROGATE | SV_UTF8_TOO_LARGE,
+	SV_UTF8_TOO_LONG | SV_UTF8_OVERLONG_2 | SV_UTF8_TWO_CONTS | SV_UTF8_SURROGATE | SV_UTF8_TOO_LARGE,
+	SV_UTF8_TOO_SHORT, SV_UTF8_TOO_SHORT, SV_UTF8_TOO_SHORT, SV_UTF8_TOO_SHORT,
+};
+
+// Bytes above these at the end of a block start a sequence that continues in the next one
+static const unsigned char sv_utf8_max_tail[32] = {
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	0xf0 - 1, 0xe0 - 1, 0xc0 - 1,
+};
+#endif
+
+#if defined(_SDX_AVX2)
+#define SV_UTF8_BLOCK 32
+typedef __m256i sv_utf8_vec;
+#define sv_utf8_load(p) _mm256_loadu_si256((const __m256i*)(p))
+#define sv_utf8_table(t) _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(t)))
+#define sv_utf8_and _mm256_and_si256
+#define sv_utf8_or _mm256_or_si256
+#define sv_utf8_xor _mm256_xor_si256
+#define sv_utf8_shuffle _mm256_shuffle_epi8
+#define sv_utf8_subs _mm256_subs_epu8
+#define sv_utf8_set1 _mm256_set1_epi8
+#define sv_utf8_zero _mm256_setzero_si256
+#define sv_utf8_srli16 _mm256_srli_epi16
+#define sv_utf8_movemask _mm256_movemask_epi8
+#define sv_utf8_testz(x) _mm256_testz_si256(x, x)
+// input shifted right by n bytes, with the last n bytes of prev shifted in
+#define sv_utf8_prev(input, prev, n) \
+	_mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - (n))
+#elif defined(_SDX_SSSE3)
+#define SV_UTF8_BLOCK 16
+typedef __m128i sv_utf8_vec;
+#define sv_utf8_load(p) _mm_loadu_si128((const __m128i*)(p))
+#define sv_utf8_table(t) _mm_loadu_si128((const __m128i*)(t))
+#define sv_utf8_and _mm_and_si128
+#define sv_utf8_or _mm_or_si128
+#define sv_utf8_xor _mm_xor_si128
+#define sv_utf8_shuffle _mm_shuffle_epi8
+#define sv_utf8_subs _mm_subs_epu8
+#define sv_utf8_set1 _mm_set1_epi8
+#define sv_utf8_zero _mm_setzero_si128
+#define sv_utf8_srli16 _mm_srli_epi16
+#define sv_utf8_movemask _mm_movemask_epi8
+#define sv_utf8_testz(x) (_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_setzero_si128())) == 0xffff)
+#define sv_utf8_prev(input, prev, n) _mm_alignr_epi8(input, prev, 16 - (n))
+#endif
+
+#if defined(SV_UTF8_BLOCK)
+struct sv_utf8_checker {
+	sv_utf8_vec error;
+	sv_utf8_vec prev_input;
+	sv_utf8_vec prev_incomplete;
+	sv_utf8_vec byte_1_high;
+	sv_utf8_vec byte_1_low;
+	sv_utf8_vec byte_2_high;
+	sv_utf8_vec max_tail;
+};
+
+static inline void sv_utf8_check_block(struct sv_utf8_checker *c, sv_utf8_vec input)
 {
-	return sv_trim_right(sv_trim_left(sv));
+	// Ascii only, a sequence cut by the previous block is an error
+	if (sv_utf8_movemask(input) == 0) {
+		c->error = sv_utf8_or(c->error, c->prev_incomplete);
+		c->prev_incomplete = sv_utf8_zero();
+		c->prev_input = input;
+		return;
+	}
+
+	sv_utf8_vec nibble = sv_utf8_set1(0x0f);
+	sv_utf8_vec prev1 = sv_utf8_prev(input, c->prev_input, 1);
+	sv_utf8_vec special = sv_utf8_and(sv_utf8_and(
+		sv_utf8_shuffle(c->byte_1_high, sv_utf8_and(sv_utf8_srli16(prev1, 4), nibble)),
+		sv_utf8_shuffle(c->byte_1_low, sv_utf8_and(prev1, nibble))),
+		sv_utf8_shuffle(c->byte_2_high, sv_utf8_and(sv_utf8_srli16(input, 4), nibble)));
+
+	// Only 111_____ two back and 1111____ three back need a continuation here
+	sv_utf8_vec third = sv_utf8_subs(sv_utf8_prev(input, c->prev_input, 2), sv_utf8_set1(0xe0 - 0x80));
+	sv_utf8_vec fourth = sv_utf8_subs(sv_utf8_prev(input, c->prev_input, 3), sv_utf8_set1(0xf0 - 0x80));
+	sv_utf8_vec must_continue = sv_utf8_and(sv_utf8_or(third, fourth), sv_utf8_set1(0x80));
+
+	c->error = sv_utf8_or(c->error, sv_utf8_xor(must_continue, special));
+	c->prev_incomplete = sv_utf8_subs(input, c->max_tail);
+	c->prev_input = input;
 }
+#endif
 
-SV_DEF string_view sv_next_line(string_view sv)
+/**
+ * Check that sv is well formed UTF-8, overlong forms, surrogates and
+ * codepoints above U+10FFFF are rejected.
+ *
+ * @return {int}: 1 if valid, 0 otherwise
+ */
+SV_DEF int sv_utf8_validate(string_view sv)
 {
-	string_view result;
-	result.data = sv.data;
-	result.len = sv.len;
-	while (*result.data != '\n') {
-		result.data++;
-		result.len--;
+	const unsigned char *p = (const unsigned char*)sv.data;
+
+#if defined(SV_UTF8_BLOCK)
+	struct sv_utf8_checker c;
+	size_t i = 0;
+
+	if (sv.len < SV_UTF8_BLOCK)
+		return sv_utf8_validate_scalar(p, sv.len);
+
+	c.error = sv_utf8_zero();
+	c.prev_input = sv_utf8_zero();
+	c.prev_incomplete = sv_utf8_zero();
+	c.byte_1_high = sv_utf8_table(sv_utf8_byte_1_high);
+	c.byte_1_low = sv_utf8_table(sv_utf8_byte_1_low);
+	c.byte_2_high = sv_utf8_table(sv_utf8_byte_2_high);
+	c.max_tail = sv_utf8_load(sv_utf8_max_tail + 32 - SV_UTF8_BLOCK);
+
+	for (; i + SV_UTF8_BLOCK <= sv.len; i += SV_UTF8_BLOCK) {
+		sv_utf8_check_block(&c, sv_utf8_load(p + i));
+		// Bail out early instead of scanning the rest of a bad input
+		if ((i & 1023) == 0 && !sv_utf8_testz(c.error))
+			return 0;
 	}
-	result.data++;
-	result.len--;
 
-	if (result.len <= 0)
-		return sv;
+	// Zero padding is ascii, it ends any sequence left open
+	unsigned char tail[SV_UTF8_BLOCK] = { 0 };
+	memcpy(tail, p + i, sv.len - i);
+	sv_utf8_check_block(&c, sv_utf8_load(tail));
+	c.error = sv_utf8_or(c.error, c.prev_incomplete);
 
-	return result;
+	return sv_utf8_testz(c.error);
+#else
+	return sv_utf8_validate_scalar(p, sv.len);
+#endif
+}
+
+/**
+ * Number of codepoints, every byte that is not a continuation byte
+ * (10______) starts one. Only meaningful for valid UTF-8.
+ */
+SV_DEF size_t sv_utf8_count(string_view sv)
+{
+	const unsigned char *p = (const unsigned char*)sv.data;
+	size_t count = 0;
+	size_t i = 0;
+
+#if defined(_SDX_AVX2)
+	__m256i limit = _mm256_set1_epi8((char)0xbf);
+	for (; i + 32 <= sv.len; i += 32) {
+		__m256i block = _mm256_loadu_si256((const __m256i*)(p + i));
+		count += POPCOUNT64((uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(block, limit)));
+	}
+#elif defined(_SDX_SSE2)
+	__m128i limit = _mm_set1_epi8((char)0xbf);
+	for (; i + 16 <= sv.len; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*)(p + i));
+		count += POPCOUNT64(_mm_movemask_epi8(_mm_cmpgt_epi8(block, limit)));
+	}
+#endif
+
+	for (; i < sv.len; i++)
+		count += (p[i] & 0xc0) != 0x80;
+
+	return count;
+}
+
+/**
+ * Decode the codepoint at the start of sv and advance past it
+ *
+ * @return {int32_t}: the codepoint, -1 if sv is empty or the sequence
+ * is invalid, one byte is skipped then so decoding can go on
+ */
+SV_DEF int32_t sv_utf8_next(string_view *sv)
+{
+	uint32_t codepoint;
+	size_t n;
+
+	if (sv->len == 0)
+		return -1;
+
+	n = sv_utf8_decode((const unsigned char*)sv->data, sv->len, &codepoint);
+	if (n == 0) {
+		sv->data++;
+		sv->len--;
+		return -1;
+	}
+
+	sv->data += n;
+	sv->len -= n;
+	return codepoint;
 }
@@ -46,6 +46,8 @@
 // SOFTWARE.
 
 #include "strvec.h"
+#include "filesystem.h"
+#include <stdint.h>
 
 int strvec_init(struct strvec *arr)
 {
@@ -53,57 +55,890 @@ int strvec_init(struct strvec *arr)
 	if (arr->data == NULL)
 		return 0;
 
-	if (!array_init(&arr->offsets, sizeof(size_t), 0)) {
+	if (!array_init(&arr->offsets, sizeof(struct strvec_entry), STRVEC_INITIAL_STR_COUNT)) {
 		free(arr->data);
 		return 0;
 	}
 
+	for (int i = 0; i < STRVEC_FREE_BUCKETS; i++) {
+		if (!array_init(&arr->free_ranges[i], sizeof(struct strvec_free_range), STRVEC_INITIAL_FREE_COUNT)) {
+			while (i--)
+				array_free(&arr->free_ranges[i]);
+			array_free(&arr->offsets);
+			free(arr->data);
+			return 0;
+		}
+	}
+
 	arr->data_cap = STRVEC_INITIAL_DATA_CAP;
 	arr->data_size = 0;
+	arr->free_size = 0;
+	arr->map_data = NULL;
+	arr->map_size = 0;
 
 	return 1;
 }
 
-int strvec_push(struct strvec *arr, char* str)
+static int strvec_free_bucket(size_t size)
 {
-	int len = strlen(str);
-	len++; /* \0 character */
-	if (arr->data_size >= arr->data_cap) {
-		size_t newcap = (arr->data_cap * 10) + len;
-		char *tmp = malloc(newcap);
-		memcpy(tmp, arr->data, arr->data_size);
-		arr->data_cap = newcap;
+	int bucket = 0;
+	while (size >>= 1)
+		bucket++;
+
+	return bucket < STRVEC_FREE_BUCKETS ? bucket : STRVEC_FREE_BUCKETS - 1;
+}
+
+static int strvec_free_range_add(struct strvec *arr, size_t offset, size_t size)
+{
+	struct strvec_free_range range;
+	range.offset = offset;
+	range.size = size;
+
+	if (!array_reserve(&arr->free_ranges[strvec_free_bucket(size)], 1))
+		return 0;
+
+	array_push(&arr->free_ranges[strvec_free_bucket(size)], &range);
+	arr->free_size += size;
+	return 1;
+}
+
+static void strvec_free_range_remove(struct array *bucket, size_t index)
+{
+	struct strvec_free_range *last = array_get(bucket, bucket->index - 1);
+	array_replace_item(bucket, index, last);
+	bucket->index--;
+}
+
+/*
+ * Look for a cleared range that can hold size bytes. The bucket
+ * of size is searched first since only some of its ranges fit,
+ * every range in the bigger buckets fits so the last one is taken.
+ * Whatever is left from the range goes back into the free list.
+ *
+ * @return {int}: 1 and the offset is written to *offset if found.
+ */
+static int strvec_free_range_take(struct strvec *arr, size_t size, size_t *offset)
+{
+	if (arr->free_size < size)
+		return 0;
+
+	int bucket = strvec_free_bucket(size);
+	for (int i = bucket; i < STRVEC_FREE_BUCKETS; i++) {
+		struct array *ranges = &arr->free_ranges[i];
+		size_t found = ranges->index;
+
+		if (i == bucket || i == STRVEC_FREE_BUCKETS - 1) {
+			for (size_t j = 0; j < ranges->index; j++) {
+				struct strvec_free_range *range = array_get(ranges, j);
+				if (range->size >= size) {
+					found = j;
+					break;
+				}
+			}
+		} else if (ranges->index) {
+			found = ranges->index - 1;
+		}
+
+		if (found == ranges->index)
+			continue;
+
+		struct strvec_free_range range = *(struct strvec_free_range*)array_get(ranges, found);
+		strvec_free_range_remove(ranges, found);
+		arr->free_size -= range.size;
+
+		if (range.size > size)
+			strvec_free_range_add(arr, range.offset + size, range.size - size);
+
+		*offset = range.offset;
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Make room for count more strings that take bytes in total
+ * (including their '\0'), the data buffer grows geometrically
+ * so pushing n strings one by one is amortized O(n).
+ */
+int strvec_reserve(struct strvec *arr, size_t bytes, size_t count)
+{
+	size_t needed = arr->data_size + bytes;
+	if (needed > arr->data_cap) {
+		size_t newcap = arr->data_cap ? arr->data_cap : STRVEC_INITIAL_DATA_CAP;
+		while (newcap < needed)
+			newcap *= 2;
+
+		char *tmp = realloc(arr->data, newcap);
 		if (tmp == NULL)
 			return 0;
 		arr->data = tmp;
+		arr->data_cap = newcap;
 	}
 
+	return array_reserve(&arr->offsets, count);
+}
+
+// Caller has to make sure there is enough space
+static int strvec_append(struct strvec *arr, char *str, size_t len)
+{
+	struct strvec_entry entry;
+	entry.offset = arr->data_size;
+	entry.len = len;
 
 	char *ptr = arr->data + arr->data_size;
 	memcpy(ptr, str, len);
+	ptr[len] = '\0';
+	arr->data_size += len + 1;
+
+	return array_push(&arr->offsets, &entry);
+}
+
+int strvec_push_len(struct strvec *arr, char *str, size_t len)
+{
+	struct strvec_entry entry;
+
+	if (arr->map_data || !array_reserve(&arr->offsets, 1))
+		return -1;
+
+	if (strvec_free_range_take(arr, len + 1, &entry.offset)) {
+		entry.len = len;
+		memcpy(arr->data + entry.offset, str, len);
+		arr->data[entry.offset + len] = '\0';
+		return array_push(&arr->offsets, &entry);
+	}
 
-	int index = array_push(&arr->offsets, &arr->data_size);
+	if (!strvec_reserve(arr, len + 1, 1))
+		return -1;
 
-	arr->data_size += len;
-	return index;
+	return strvec_append(arr, str, len);
+}
+
+int strvec_push(struct strvec *arr, char* str)
+{
+	return strvec_push_len(arr, str, strlen(str));
 }
 
-/* It is not possible to free() a part of memory, so we are clearing it*/
-/* @Refactor: I might add an another array to this to keep track of empty
-* parts of the vecotor and loop though all of them when pushing a string to
-* see if there is any ampty space in cleared parts */
+int strvec_push_sv(struct strvec *arr, string_view sv)
+{
+	return strvec_push_len(arr, sv.data, sv.len);
+}
+
+/*
+ * Push count strings with a single capacity check. Strings are
+ * always appended to the end, cleared space is not reused.
+ *
+ * @return {int}: index of the first pushed string, -1 on fail
+ * in which case nothing is pushed.
+ */
+int strvec_push_many(struct strvec *arr, string_view *svs, size_t count)
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < count; i++)
+		bytes += svs[i].len + 1;
+
+	if (arr->map_data || !strvec_reserve(arr, bytes, count))
+		return -1;
+
+	int first = arr->offsets.index;
+	for (size_t i = 0; i < count; i++)
+		strvec_append(arr, svs[i].data, svs[i].len);
+
+	return first;
+}
+
+/*
+ * It is not possible to free() a part of memory, so the space of the
+ * string is put into the free list and reused by the next push that
+ * fits in it. The index stays valid but strvec_get() returns NULL for
+ * it from now on.
+ *
+ * @return {int}: 1 on success, 0 if the string was already cleared
+ * or the free list could not grow.
+ */
 int strvec_clear(struct strvec *arr, int index)
 {
+	assert((size_t)index < arr->offsets.index);
+	struct strvec_entry *entry = array_get(&arr->offsets, index);
+	if (arr->map_data || entry->offset == STRVEC_REMOVED)
+		return 0;
+
+	if (!strvec_free_range_add(arr, entry->offset, entry->len + 1))
+		return 0;
+
+	entry->offset = STRVEC_REMOVED;
+	entry->len = 0;
+	return 1;
+}
+
+/*
+ * Copy every live string into a new buffer in index order, this fixes
+ * the offsets and drops all the cleared space in a single pass.
+ */
+int strvec_compact(struct strvec *arr)
+{
+	if (arr->map_data)
+		return 0;
+
+	size_t live = arr->data_size - arr->free_size;
+	size_t newcap = STRVEC_INITIAL_DATA_CAP;
+	while (newcap < live)
+		newcap *= 2;
+
+	char *data = malloc(newcap);
+	if (data == NULL)
+		return 0;
+
+	size_t size = 0;
+	for (size_t i = 0; i < arr->offsets.index; i++) {
+		struct strvec_entry *entry = array_get(&arr->offsets, i);
+		if (entry->offset == STRVEC_REMOVED)
+			continue;
+
+		memcpy(data + size, arr->data + entry->offset, entry->len + 1);
+		entry->offset = size;
+		size += entry->len + 1;
+	}
+
+	free(arr->data);
+	arr->data = data;
+	arr->data_cap = newcap;
+	arr->data_size = size;
+	arr->free_size = 0;
+
+	for (int i = 0; i < STRVEC_FREE_BUCKETS; i++)
+		array_overwrite(&arr->free_ranges[i]);
+
+	return 1;
+}
+
+/*
+ * Ratio of cleared bytes to the used part of the data buffer,
+ * 0 means there is no wasted space, strvec_compact() can be
+ * called when it gets too high.
+ */
+double strvec_fragmentation(struct strvec *arr)
+{
+	if (arr->data_size == 0)
+		return 0;
+
+	return (double)arr->free_size / (double)arr->data_size;
 }
 
-// Rewrite
 void strvec_delete_struct(struct strvec* arr)
 {
+	if (arr->map_data) {
+		struct fs_file file = { arr->map_data, arr->map_size };
+		fs_file_unmap(&file);
+		arr->map_data = NULL;
+		arr->map_size = 0;
+	} else {
+		free(arr->data);
+		array_free(&arr->offsets);
+	}
+
+	for (int i = 0; i < STRVEC_FREE_BUCKETS; i++)
+		array_free(&arr->free_ranges[i]);
+
+	arr->data = NULL;
+	arr->data_cap = 0;
+	arr->data_size = 0;
+	arr->free_size = 0;
 }
 
 char *strvec_get(struct strvec *arr, int index)
 {
-	assert(index < arr->offsets.index); /*  */
-	size_t offset = *((size_t*)array_get(&arr->offsets, index));
-	return arr->data + offset;
+	assert((size_t)index < arr->offsets.index);
+	struct strvec_entry *entry = array_get(&arr->offsets, index);
+	if (entry->offset == STRVEC_REMOVED)
+		return NULL;
+
+	return arr->data + entry->offset;
+}
+
+string_view strvec_get_sv(struct strvec *arr, int index)
+{
+	assert((size_t)index < arr->offsets.index);
+	struct strvec_entry *entry = array_get(&arr->offsets, index);
+	if (entry->offset == STRVEC_REMOVED)
+		return sv_from_parts(NULL, 0);
+
+	return sv_from_parts(arr->data + entry->offset, entry->len);
+}
+
+size_t strvec_count(struct strvec *arr)
+{
+	return arr->offsets.index;
+}
+
+/*
+ * Sorting is a multikey quicksort (Bentley & Sedgewick) that works on
+ * 8 byte digits instead of single bytes. The next 8 bytes of every
+ * string are loaded into a big endian key once per level, the keys are
+ * sorted together with the entries and only the runs of equal keys
+ * that still have bytes left go one level deeper. Only the entries are
+ * moved, string bytes stay where they are. Cleared strings are moved
+ * to the end.
+ */
+
+#define STRVEC_INSERTION_SORT_CUTOFF 16
+#define STRVEC_SORT_PREFETCH_DISTANCE 8
+
+static inline uint64_t strvec_key_at(char *data, struct strvec_entry *entry, size_t depth)
+{
+	unsigned char *ptr = (unsigned char*)data + entry->offset + depth;
+	uint64_t key = 0;
+
+	if (entry->len >= depth + 8) {
+		for (int i = 0; i < 8; i++)
+			key = (key << 8) | ptr[i];
+		return key;
+	}
+
+	size_t left = entry->len > depth ? entry->len - depth : 0;
+	for (size_t i = 0; i < 8; i++)
+		key = (key << 8) | (i < left ? ptr[i] : 0);
+	return key;
+}
+
+static inline void strvec_sort_swap(uint64_t *keys, struct strvec_entry *e, size_t a, size_t b)
+{
+	uint64_t key = keys[a];
+	keys[a] = keys[b];
+	keys[b] = key;
+
+	struct strvec_entry tmp = e[a];
+	e[a] = e[b];
+	e[b] = tmp;
+}
+
+static void strvec_key_insertion_sort(uint64_t *keys, struct strvec_entry *e, size_t n)
+{
+	for (size_t i = 1; i < n; i++) {
+		uint64_t key = keys[i];
+		struct strvec_entry tmp = e[i];
+		size_t j = i;
+		while (j > 0 && keys[j - 1] > key) {
+			keys[j] = keys[j - 1];
+			e[j] = e[j - 1];
+			j--;
+		}
+		keys[j] = key;
+		e[j] = tmp;
+	}
+}
+
+// Three way quicksort on the keys, entries follow their keys
+static void strvec_key_sort(uint64_t *keys, struct strvec_entry *e, size_t n)
+{
+	while (n >= STRVEC_INSERTION_SORT_CUTOFF) {
+		uint64_t a = keys[0], b = keys[n / 2], c = keys[n - 1];
+		uint64_t pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (b > c ? b : (a < c ? a : c));
+
+		// keys[0, lt) < pivot, keys[lt, i) == pivot, keys(gt, n) > pivot
+		size_t lt = 0, i = 0, gt = n;
+		while (i < gt) {
+			if (keys[i] < pivot)
+				strvec_sort_swap(keys, e, lt++, i++);
+			else if (keys[i] > pivot)
+				strvec_sort_swap(keys, e, i, --gt);
+			else
+				i++;
+		}
+
+		// Recurse into the smaller side
+		if (lt < n - gt) {
+			strvec_key_sort(keys, e, lt);
+			keys += gt;
+			e += gt;
+			n -= gt;
+		} else {
+			strvec_key_sort(keys + gt, e + gt, n - gt);
+			n = lt;
+		}
+	}
+
+	strvec_key_insertion_sort(keys, e, n);
+}
+
+static void strvec_mkqsort(char *data, struct strvec_entry *e, uint64_t *keys, size_t n, size_t depth)
+{
+	// Below the first level the entries are in random order, the
+	// strings are prefetched a few entries ahead to hide the misses
+	for (size_t i = 0; i < n; i++) {
+		if (i + STRVEC_SORT_PREFETCH_DISTANCE < n)
+			PREFETCH(data + e[i + STRVEC_SORT_PREFETCH_DISTANCE].offset + depth, 0)
+		keys[i] = strvec_key_at(data, &e[i], depth);
+	}
+
+	strvec_key_sort(keys, e, n);
+
+	size_t i = 0;
+	while (i < n) {
+		size_t j = i + 1;
+		while (j < n && keys[j] == keys[i])
+			j++;
+
+		if (j - i > 1) {
+			// Strings that end in this digit come first, ordered by
+			// length since the padding can not tell "a" from "a\0"
+			size_t ended = i;
+			for (size_t k = i; k < j; k++)
+				if (e[k].len <= depth + 8)
+					strvec_sort_swap(keys, e, ended++, k);
+
+			for (size_t k = i + 1; k < ended; k++) {
+				struct strvec_entry tmp = e[k];
+				size_t m = k;
+				while (m > i && e[m - 1].len > tmp.len) {
+					e[m] = e[m - 1];
+					m--;
+				}
+				e[m] = tmp;
+			}
+
+			if (j - ended > 1)
+				strvec_mkqsort(data, e + ended, keys + ended, j - ended, depth + 8);
+		}
+
+		i = j;
+	}
+}
+
+/*
+ * Sort the strings in byte order, indices returned by previous
+ * pushes are no longer valid after this.
+ *
+ * @return {int}: 1 on success, 0 if the temporary key buffer could
+ * not be allocated, in which case the vector is left untouched.
+ */
+int strvec_sort(struct strvec *arr)
+{
+	struct strvec_entry *entries = (struct strvec_entry*)arr->offsets.data;
+	size_t n = arr->offsets.index;
+	size_t live = 0;
+
+	uint64_t *keys = malloc((n ? n : 1) * sizeof(uint64_t));
+	if (keys == NULL)
+		return 0;
+
+	for (size_t i = 0; i < n; i++) {
+		if (entries[i].offset != STRVEC_REMOVED) {
+			struct strvec_entry tmp = entries[live];
+			entries[live++] = entries[i];
+			entries[i] = tmp;
+		}
+	}
+
+	strvec_mkqsort(arr->data, entries, keys, live, 0);
+	free(keys);
+	return 1;
+}
+
+// Cleared strings compare greater than everything, like in strvec_sort()
+static int strvec_cmp_key(struct strvec *arr, struct strvec_entry *entry, string_view key)
+{
+	if (entry->offset == STRVEC_REMOVED)
+		return 1;
+
+	return sv_cmp(sv_from_parts(arr->data + entry->offset, entry->len), key);
+}
+
+/*
+ * Index of the first string that is not less than key, the vector
+ * has to be sorted with strvec_sort().
+ *
+ * @return {size_t}: strvec_count() if every string is less than key.
+ */
+size_t strvec_lower_bound(struct strvec *arr, string_view key)
+{
+	struct strvec_entry *entries = (struct strvec_entry*)arr->offsets.data;
+	size_t lo = 0;
+	size_t n = arr->offsets.index;
+
+	while (n > 0) {
+		size_t half = n / 2;
+		if (strvec_cmp_key(arr, &entries[lo + half], key) < 0) {
+			lo += half + 1;
+			n -= half + 1;
+		} else {
+			n = half;
+		}
+	}
+
+	return lo;
+}
+
+/*
+ * Find key in a vector sorted with strvec_sort().
+ *
+ * @return {int}: index of the string, -1 if not found.
+ */
+int strvec_bsearch(struct strvec *arr, string_view key)
+{
+	size_t index = strvec_lower_bound(arr, key);
+	if (index == arr->offsets.index)
+		return -1;
+
+	struct strvec_entry *entry = array_get(&arr->offsets, index);
+	return strvec_cmp_key(arr, entry, key) == 0 ? (int)index : -1;
+}
+
+/*
+ * Write the vector to path in the layout described in strvec.h,
+ * cleared strings are kept so indices stay the same.
+ *
+ * @return {int}: 1 on success, 0 on failure.
+ */
+int strvec_save(struct strvec *arr, char *path)
+{
+	struct strvec_file_header header = {0};
+	memcpy(header.magic, STRVEC_FILE_MAGIC, sizeof(STRVEC_FILE_MAGIC));
+	header.version = STRVEC_FILE_VERSION;
+	header.word_size = sizeof(size_t);
+	header.byte_order = STRVEC_FILE_BYTE_ORDER;
+	header.count = arr->offsets.index;
+	header.data_size = arr->data_size;
+
+	FILE *file = fopen(path, "wb");
+	if (file == NULL)
+		return 0;
+
+	size_t entries_size = arr->offsets.index * sizeof(struct strvec_entry);
+	int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	if (ok && entries_size)
+		ok = fwrite(arr->offsets.data, entries_size, 1, file) == 1;
+	if (ok && arr->data_size)
+		ok = fwrite(arr->data, arr->data_size, 1, file) == 1;
+
+	if (fclose(file) != 0)
+		ok = 0;
+
+	return ok;
+}
+
+/*
+ * Map a file written by strvec_save() into arr, nothing is copied
+ * and the strings can be used right away. arr does not have to be
+ * initialized, it is released with strvec_delete_struct().
+ *
+ * @return {int}: 1 on success, 0 if the file can not be mapped or
+ * was written by a machine with a different word size or byte order.
+ */
+int strvec_map(struct strvec *arr, char *path)
+{
+	struct fs_file file = fs_file_map(path);
+	if (file.data == NULL)
+		return 0;
+
+	struct strvec_file_header *header = (struct strvec_file_header*)file.data;
+	if (file.size < sizeof(*header) ||
+	    memcmp(header->magic, STRVEC_FILE_MAGIC, sizeof(STRVEC_FILE_MAGIC)) != 0 ||
+	    header->version != STRVEC_FILE_VERSION ||
+	    header->word_size != sizeof(size_t) ||
+	    header->byte_order != STRVEC_FILE_BYTE_ORDER)
+		goto error;
+
+	size_t entries_size = header->count * sizeof(struct strvec_entry);
+	if (header->count > (file.size - sizeof(*header)) / sizeof(struct strvec_entry) ||
+	    header->data_size != file.size - sizeof(*header) - entries_size)
+		goto error;
+
+	// Every string and its terminator has to be inside the data, a
+	// corrupted entry would make strvec_get() read outside the mapping
+	struct strvec_entry *entries = (struct strvec_entry*)(file.data + sizeof(*header));
+	char *data = file.data + sizeof(*header) + entries_size;
+	for (size_t i = 0; i < header->count; i++) {
+		if (entries[i].offset == STRVEC_REMOVED)
+			continue;
+		if (entries[i].offset >= header->data_size ||
+		    entries[i].len >= header->data_size - entries[i].offset ||
+		    data[entries[i].offset + entries[i].len] != '\0')
+			goto error;
+	}
+
+	memset(arr, 0, sizeof(*arr));
+	arr->offsets.itemsize = sizeof(struct strvec_entry);
+	arr->offsets.index = header->count;
+	arr->offsets.data = (unsigned char*)file.data + sizeof(*header);
+	arr->data = data;
+	arr->data_size = header->data_size;
+	arr->data_cap = header->data_size;
+	arr->map_data = file.data;
+	arr->map_size = file.size;
+
+	return 1;
+
+ error:
+	fs_file_unmap(&file);
+	return 0;
+}
+
+/*
+ * Front coding
+ */
+
+static size_t strvec_fc_varint_put(unsigned char *dst, size_t value)
+{
+	size_t n = 0;
+	while (value >= 0x80) {
+		dst[n++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	dst[n++] = (unsigned char)value;
+	return n;
+}
+
+static inline size_t strvec_fc_varint_get(unsigned char *src, size_t *pos)
+{
+	size_t value = 0;
+	int shift = 0;
+	unsigned char byte;
+	do {
+		byte = src[(*pos)++];
+		value |= (size_t)(byte & 0x7f) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+	return value;
+}
+
+/*
+ * Build fc from the strings of sorted in index order, cleared strings
+ * are skipped. Any order works but only a sorted vector compresses well
+ * and can be searched with strvec_fc_lower_bound().
+ *
+ * @param {size_t} block_size: number of strings per block, 0 for the default.
+ * @return {int}: 1 on success, 0 on fail.
+ */
+int strvec_fc_build(struct strvec_fc *fc, struct strvec *sorted, size_t block_size)
+{
+	if (block_size == 0)
+		block_size = STRVEC_FC_DEFAULT_BLOCK_SIZE;
+
+	fc->block_size = block_size;
+	fc->count = 0;
+	fc->data_size = 0;
+
+	// Worst case, nothing is shared and every length takes a 10 byte varint
+	size_t live = 0, cap = 0;
+	for (size_t i = 0; i < sorted->offsets.index; i++) {
+		struct strvec_entry *entry = array_get(&sorted->offsets, i);
+		if (entry->offset == STRVEC_REMOVED)
+			continue;
+		cap += entry->len + 20;
+		live++;
+	}
+
+	fc->data = malloc(cap ? cap : 1);
+	if (fc->data == NULL)
+		return 0;
+
+	if (!array_init(&fc->blocks, sizeof(size_t), live / block_size + 1)) {
+		free(fc->data);
+		return 0;
+	}
+
+	string_view prev = {0};
+	for (size_t i = 0; i < sorted->offsets.index; i++) {
+		string_view cur = strvec_get_sv(sorted, i);
+		if (cur.data == NULL)
+			continue;
+
+		unsigned char *dst = fc->data + fc->data_size;
+		if (fc->count % block_size == 0) {
+			array_push(&fc->blocks, &fc->data_size);
+			dst += strvec_fc_varint_put(dst, cur.len);
+			memcpy(dst, cur.data, cur.len);
+			dst += cur.len;
+		} else {
+			size_t shared = 0;
+			size_t max = MIN(prev.len, cur.len);
+			while (shared < max && prev.data[shared] == cur.data[shared])
+				shared++;
+
+			dst += strvec_fc_varint_put(dst, shared);
+			dst += strvec_fc_varint_put(dst, cur.len - shared);
+			memcpy(dst, cur.data + shared, cur.len - shared);
+			dst += cur.len - shared;
+		}
+
+		fc->data_size = dst - fc->data;
+		fc->count++;
+		prev = cur;
+	}
+
+	// Give back the worst case reservation
+	unsigned char *tmp = realloc(fc->data, fc->data_size ? fc->data_size : 1);
+	if (tmp != NULL)
+		fc->data = tmp;
+
+	return 1;
+}
+
+/*
+ * Decode string index into buf, at most buf_size bytes are written
+ * and the string is not null terminated.
+ *
+ * @return {size_t}: length of the whole string, it is truncated if
+ * this is bigger than buf_size.
+ */
+size_t strvec_fc_get(struct strvec_fc *fc, size_t index, char *buf, size_t buf_size)
+{
+	assert(index < fc->count);
+	size_t pos = *(size_t*)array_get(&fc->blocks, index / fc->block_size);
+	size_t len = strvec_fc_varint_get(fc->data, &pos);
+	memcpy(buf, fc->data + pos, MIN(len, buf_size));
+	pos += len;
+
+	// Shared prefixes keep their position, bytes past buf_size are never needed
+	for (size_t i = index % fc->block_size; i > 0; i--) {
+		size_t shared = strvec_fc_varint_get(fc->data, &pos);
+		size_t suffix = strvec_fc_varint_get(fc->data, &pos);
+		if (shared < buf_size)
+			memcpy(buf + shared, fc->data + pos, MIN(suffix, buf_size - shared));
+		pos += suffix;
+		len = shared + suffix;
+	}
+
+	return len;
+}
+
+/*
+ * Start iterating from string index, strvec_fc_next() returns the
+ * strings in order. Sequential iteration decodes every string once.
+ */
+int strvec_fc_iter_init(struct strvec_fc_iter *it, struct strvec_fc *fc, size_t index)
+{
+	it->fc = fc;
+	it->len = 0;
+	it->cap = 64;
+	it->buf = malloc(it->cap);
+	if (it->buf == NULL)
+		return 0;
+
+	if (index >= fc->count) {
+		it->index = fc->count;
+		it->pos = fc->data_size;
+		return 1;
+	}
+
+	// Position the iterator on the block head, then skip to index
+	it->index = index - index % fc->block_size;
+	it->pos = *(size_t*)array_get(&fc->blocks, index / fc->block_size);
+
+	string_view skipped;
+	while (it->index < index) {
+		if (!strvec_fc_next(it, &skipped)) {
+			strvec_fc_iter_free(it);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * @return {int}: 1 and the next string in *out, which stays valid
+ * until the next call. 0 at the end or if the buffer can not grow.
+ */
+int strvec_fc_next(struct strvec_fc_iter *it, string_view *out)
+{
+	struct strvec_fc *fc = it->fc;
+	if (it->index >= fc->count)
+		return 0;
+
+	size_t shared = 0;
+	if (it->index % fc->block_size != 0)
+		shared = strvec_fc_varint_get(fc->data, &it->pos);
+	size_t suffix = strvec_fc_varint_get(fc->data, &it->pos);
+
+	if (shared + suffix > it->cap) {
+		size_t newcap = it->cap * 2;
+		while (newcap < shared + suffix)
+			newcap *= 2;
+		char *tmp = realloc(it->buf, newcap);
+		if (tmp == NULL)
+			return 0;
+		it->buf = tmp;
+		it->cap = newcap;
+	}
+
+	memcpy(it->buf + shared, fc->data + it->pos, suffix);
+	it->pos += suffix;
+	it->len = shared + suffix;
+	it->index++;
+
+	*out = sv_from_parts(it->buf, it->len);
+	return 1;
+}
+
+void strvec_fc_iter_free(struct strvec_fc_iter *it)
+{
+	free(it->buf);
+	it->buf = NULL;
+	it->cap = 0;
+}
+
+/*
+ * Index of the first string that is not less than key, fc has to be
+ * built from a sorted vector. Block heads are binary searched without
+ * decoding anything, then at most one block is decoded.
+ *
+ * @return {size_t}: count of fc if every string is less than key,
+ * (size_t)-1 if the decode buffer could not be allocated.
+ */
+size_t strvec_fc_lower_bound(struct strvec_fc *fc, string_view key)
+{
+	size_t lo = 0;
+	size_t n = fc->blocks.index;
+
+	// First block whose head is not less than key
+	while (n > 0) {
+		size_t half = n / 2;
+		size_t pos = *(size_t*)array_get(&fc->blocks, lo + half);
+		size_t len = strvec_fc_varint_get(fc->data, &pos);
+		string_view head = sv_from_parts((char*)fc->data + pos, len);
+
+		if (sv_cmp(head, key) < 0) {
+			lo += half + 1;
+			n -= half + 1;
+		} else {
+			n = half;
+		}
+	}
+
+	if (lo == 0)
+		return 0;
+
+	// The answer is inside the block before it or is its head
+	struct strvec_fc_iter it;
+	if (!strvec_fc_iter_init(&it, fc, (lo - 1) * fc->block_size))
+		return (size_t)-1;
+
+	size_t index = lo * fc->block_size;
+	string_view cur;
+	while (it.index < lo * fc->block_size && strvec_fc_next(&it, &cur)) {
+		if (sv_cmp(cur, key) >= 0) {
+			index = it.index - 1;
+			break;
+		}
+	}
+
+	strvec_fc_iter_free(&it);
+	return MIN(index, fc->count);
+}
+
+// Bytes allocated by fc
+size_t strvec_fc_memory(struct strvec_fc *fc)
+{
+	return fc->data_size + fc->blocks.cap;
+}
+
+void strvec_fc_free(struct strvec_fc *fc)
+{
+	free(fc->data);
+	array_free(&fc->blocks);
+	fc->data = NULL;
+	fc->data_size = 0;
+	fc->count = 0;
 }
@@ -7,6 +7,20 @@
 #include "strvec.h"
 #include "string_view.h"
 #include "system.h"
+#include "concurrent_map.h"
+#include "hashmap.h"
+#include "encoding.h"
+#include "glob_pattern.h"
+#include "json.h"
+#include "csv.h"
+#include "line_index.h"
+#include "fmt.h"
+#include "string_builder.h"
+#include "multi_pattern.h"
+#include "hash.h"
+#include "number.h"
+#include "string_operations.h"
+#include "intern.h"
 #define MEM_DEBUG_ENABLE
 #include "mem_debug.h"
 
@@ -21,6 +35,12 @@ typedef struct {
 } test_struct;
 
 #include <stdint.h>
+#include <math.h>
+#ifdef _SDX_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 /*
  * #define STRING_VIEW_IMPLEMENTATION
@@ -129,6 +149,243 @@ void test_string_view()
 	string_view next_line = sv_next_line(view);
 	printf(SV_Fmt, SV_Arg(next_line));
 
+	char buf[300];
+	for (int len = 0; len < (int)sizeof(buf); len++) {
+		for (int pos = 0; pos <= len; pos += 1 + len / 16) {
+			memset(buf, 'a', sizeof(buf));
+			if (pos < len)
+				buf[pos] = ',';
+			buf[len] = ','; // past the end, must not be found
+			assert(sv_index_of(sv_from_parts(buf, len), ',') == (size_t)pos && "sv_index_of is wrong");
+		}
+	}
+
+	char csv[] = "a,bb,,ccc";
+	string_view rest = sv_from_cstr(csv);
+	string_view field;
+	assert(sv_eq(sv_chop_by_delim(&rest, ','), SV("a")) && "sv_chop_by_delim is wrong");
+	assert(sv_try_chop_by_delim(&rest, ',', &field) && sv_eq(field, SV("bb")) && "sv_try_chop_by_delim is wrong");
+	assert(sv_eq(sv_trim_by_delim(&rest, ','), SV("")) && "sv_trim_by_delim is wrong");
+	assert(sv_try_chop_by_delim(&rest, ',', &field) == 0 && sv_eq(rest, SV("ccc")) && "sv_try_chop_by_delim is wrong");
+	assert(sv_eq(sv_chop_by_delim(&rest, ','), SV("ccc")) && rest.len == 0 && "sv_chop_by_delim is wrong");
+
+	srand(7);
+	for (int round = 0; round < 20000; round++) {
+		size_t hlen = rand() % 200;
+		size_t nlen = 1 + rand() % (round % 3 ? 5 : 45);
+		char needle[64];
+		for (size_t i = 0; i < hlen; i++)
+			buf[i] = "ab"[rand() % 2];
+		for (size_t i = 0; i < nlen; i++)
+			needle[i] = "ab"[rand() % 2];
+
+		size_t expected = hlen;
+		for (size_t i = 0; i + nlen <= hlen; i++) {
+			if (memcmp(buf + i, needle, nlen) == 0) {
+				expected = i;
+				break;
+			}
+		}
+		assert(sv_find(sv_from_parts(buf, hlen), sv_from_parts(needle, nlen)) == expected && "sv_find is wrong");
+	}
+
+	char request[] = "GET / HTTP/1.1\r\nHost: a\r\n\r\nbody";
+	rest = sv_from_cstr(request);
+	assert(sv_eq(sv_chop_by_sv(&rest, SV("\r\n\r\n")), SV("GET / HTTP/1.1\r\nHost: a")) && "sv_chop_by_sv is wrong");
+	assert(rest.len == strlen(request) && "sv_chop_by_sv advanced");
+	sv_trim_by_sv(&rest, SV("\r\n\r\n"));
+	assert(sv_eq(rest, SV("body")) && "sv_trim_by_sv did not advance past delim");
+	assert(sv_eq(sv_trim_by_sv(&rest, SV("--boundary")), SV("body")) && rest.len == 0 && "sv_trim_by_sv is wrong");
+
+	sv_charset cs = sv_charset_from_cstr(" ,;\xff\x80");
+	for (int c = 0; c < 256; c++) {
+		int expected = c == ' ' || c == ',' || c == ';' || c == 0xff || c == 0x80;
+		assert(sv_charset_has(&cs, c) == expected && "sv_charset_has is wrong");
+	}
+	sv_charset ws = SV_CHARSET_WHITESPACE, stn = SV_CHARSET_SPACE_TAB_NEWLINE, built;
+	built = sv_charset_from_cstr(" \t\n\v\f\r");
+	assert(!memcmp(&built, &ws, sizeof(built)) && "SV_CHARSET_WHITESPACE is wrong");
+	built = sv_charset_from_cstr(" \t\n\r");
+	assert(!memcmp(&built, &stn, sizeof(built)) && "SV_CHARSET_SPACE_TAB_NEWLINE is wrong");
+	for (int round = 0; round < 20000; round++) {
+		size_t len = rand() % 200;
+		for (size_t i = 0; i < len; i++)
+			buf[i] = "a; \xff\x81"[rand() % 5];
+
+		size_t span = 0, cspan = 0;
+		while (span < len && sv_charset_has(&cs, buf[span]))
+			span++;
+		while (cspan < len && !sv_charset_has(&cs, buf[cspan]))
+			cspan++;
+		assert(sv_span(sv_from_parts(buf, len), &cs) == span && "sv_span is wrong");
+		assert(sv_cspan(sv_from_parts(buf, len), &cs) == cspan && "sv_cspan is wrong");
+	}
+
+	char words[] = "  one,two; three\t\n";
+	rest = sv_trim(sv_from_cstr(words));
+	assert(sv_eq(rest, SV("one,two; three")) && "sv_trim is wrong");
+	assert(sv_eq(sv_chop_by_any(&rest, &cs), SV("one")) && "sv_chop_by_any is wrong");
+	assert(sv_eq(sv_chop_by_any(&rest, &cs), SV("two")) && "sv_chop_by_any is wrong");
+	assert(sv_eq(sv_chop_by_any(&rest, &cs), SV("")) && "sv_chop_by_any is wrong");
+	assert(sv_eq(sv_chop_by_any(&rest, &cs), SV("three")) && rest.len == 0 && "sv_chop_by_any is wrong");
+	assert(sv_eq(sv_trim_any(SV(";;x, "), &cs), SV("x")) && "sv_trim_any is wrong");
+
+	struct array tokens;
+	array_init(&tokens, sizeof(string_view), 0);
+	for (int round = 0; round < 2000; round++) {
+		size_t len = rand() % 300;
+		for (size_t i = 0; i < len; i++)
+			buf[i] = "ab,;"[rand() % 4];
+
+		tokens.index = 0;
+		assert(sv_split_all(sv_from_parts(buf, len), ',', &tokens) && "sv_split_all failed");
+		rest = sv_from_parts(buf, len);
+		for (size_t i = 0; i < tokens.index; i++)
+			assert(sv_eq(*(string_view*)array_get(&tokens, i), sv_chop_by_delim(&rest, ',')) && "sv_split_all is wrong");
+		assert(rest.len == 0 && "sv_split_all missed tokens");
+
+		tokens.index = 0;
+		assert(sv_split_all_any(sv_from_parts(buf, len), &cs, &tokens) && "sv_split_all_any failed");
+		rest = sv_from_parts(buf, len);
+		for (size_t i = 0; i < tokens.index; i++)
+			assert(sv_eq(*(string_view*)array_get(&tokens, i), sv_chop_by_any(&rest, &cs)) && "sv_split_all_any is wrong");
+		assert(rest.len == 0 && "sv_split_all_any missed tokens");
+	}
+
+	size_t big_len = 4 * SV_SPLIT_PARALLEL_MIN_CHUNK + 123;
+	struct array big_buf;
+	array_init(&big_buf, 1, big_len);
+	char *big = (char*)big_buf.data;
+	for (size_t i = 0; i < big_len; i++)
+		big[i] = rand() % 16 ? 'x' : ',';
+	struct array parallel;
+	array_init(&parallel, sizeof(string_view), 0);
+	tokens.index = 0;
+	assert(sv_split_all(sv_from_parts(big, big_len), ',', &tokens) && "sv_split_all failed");
+	assert(sv_split_all_parallel(sv_from_parts(big, big_len), ',', &parallel, 4) && "sv_split_all_parallel failed");
+	assert(parallel.index == tokens.index && "sv_split_all_parallel token count is wrong");
+	assert(memcmp(parallel.data, tokens.data, tokens.index * sizeof(string_view)) == 0 && "sv_split_all_parallel is wrong");
+	array_free(&parallel);
+	array_free(&tokens);
+	array_free(&big_buf);
+
+	const char *valid_utf8[] = { "", "ascii", "\xc2\x80", "\xdf\xbf", "\xe0\xa0\x80", "\xed\x9f\xbf",
+		"\xee\x80\x80", "\xf0\x90\x80\x80", "\xf4\x8f\xbf\xbf", "h\xc3\xa9llo w\xc3\xb6rld \xe2\x82\xac" };
+	const char *invalid_utf8[] = { "\x80", "\xbf", "\xc0\x80", "\xc1\xbf", "\xc2", "\xc2\x41", "\xe0\x80\x80",
+		"\xe0\x9f\xbf", "\xed\xa0\x80", "\xe1\x80", "\xf0\x80\x80\x80", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80",
+		"\xff", "\xf0\x90\x80", "\xc2\x80\x80" };
+	for (size_t k = 0; k < ARRAY_SIZE(valid_utf8); k++) {
+		for (size_t pad = 0; pad < 70; pad++) {
+			// every position relative to the 16/32 byte blocks
+			memset(buf, 'x', pad);
+			size_t len = strlen(valid_utf8[k]);
+			memcpy(buf + pad, valid_utf8[k], len);
+			assert(sv_utf8_validate(sv_from_parts(buf, pad + len)) && "valid utf8 rejected");
+		}
+	}
+	for (size_t k = 0; k < ARRAY_SIZE(invalid_utf8); k++) {
+		for (size_t pad = 0; pad < 70; pad++) {
+			memset(buf, 'x', sizeof(buf));
+			size_t len = strlen(invalid_utf8[k]);
+			memcpy(buf + pad, invalid_utf8[k], len);
+			assert(!sv_utf8_validate(sv_from_parts(buf, pad + len)) && "invalid utf8 accepted");
+			assert(!sv_utf8_validate(sv_from_parts(buf, 100)) && "invalid utf8 accepted");
+		}
+	}
+
+	// Random mostly valid input against decoding one codepoint at a time
+	for (int round = 0; round < 20000; round++) {
+		size_t len = 0;
+		size_t target = rand() % 250;
+		while (len < target) {
+			const char *pick = valid_utf8[rand() % ARRAY_SIZE(valid_utf8)];
+			size_t n = strlen(pick);
+			memcpy(buf + len, pick, n);
+			len += n;
+		}
+		if (round % 2 && len > 0)
+			buf[rand() % len] = rand();
+
+		string_view walk = sv_from_parts(buf, len);
+		int valid = 1;
+		size_t codepoints = 0;
+		while (walk.len > 0) {
+			codepoints++;
+			if (sv_utf8_next(&walk) < 0)
+				valid = 0;
+		}
+		assert(sv_utf8_validate(sv_from_parts(buf, len)) == valid && "sv_utf8_validate disagrees with sv_utf8_next");
+		if (valid)
+			assert(sv_utf8_count(sv_from_parts(buf, len)) == codepoints && "sv_utf8_count is wrong");
+	}
+
+	string_view euro = SV("\xe2\x82\xac!");
+	assert(sv_utf8_next(&euro) == 0x20ac && sv_utf8_next(&euro) == '!' && euro.len == 0 && "sv_utf8_next is wrong");
+
+	assert(sv_eq_icase(SV("Content-Length"), SV("content-LENGTH")) && "sv_eq_icase is wrong");
+	assert(!sv_eq_icase(SV("Content-Length"), SV("Content-Lengti")) && "sv_eq_icase is wrong");
+	assert(!sv_eq_icase(SV("@[`{"), SV("`{@[")) && "sv_eq_icase folded non letters");
+	assert(sv_starts_with_icase(SV("GET /index"), SV("get ")) && !sv_starts_with_icase(SV("GE"), SV("get")) && "sv_starts_with_icase is wrong");
+	assert(sv_cmp(SV("abc"), SV("abd")) < 0 && sv_cmp(SV("ab"), SV("abc")) < 0 && sv_cmp(SV("b"), SV("abc")) > 0 &&
+	       sv_cmp(SV("abc"), SV("abc")) == 0 && "sv_cmp is wrong");
+
+	for (int round = 0; round < 2000; round++) {
+		size_t len = rand() % 100;
+		char lower[128], upper[128];
+		for (size_t i = 0; i < len; i++)
+			buf[i] = rand();
+		memcpy(lower, buf, len);
+		memcpy(upper, buf, len);
+		sv_to_lower(sv_from_parts(lower, len));
+		sv_to_upper(sv_from_parts(upper, len));
+		for (size_t i = 0; i < len; i++) {
+			unsigned char c = buf[i];
+			assert(lower[i] == (char)(c >= 'A' && c <= 'Z' ? c + 32 : c) && "sv_to_lower is wrong");
+			assert(upper[i] == (char)(c >= 'a' && c <= 'z' ? c - 32 : c) && "sv_to_upper is wrong");
+		}
+		assert(sv_eq_icase(sv_from_parts(lower, len), sv_from_parts(upper, len)) && "sv_eq_icase is wrong");
+		assert(sv_eq_icase(sv_from_parts(lower, len), sv_from_parts(buf, len)) && "sv_eq_icase is wrong");
+		if (len > 0) {
+			lower[rand() % len] ^= 0x40;
+			assert(!sv_eq_icase(sv_from_parts(lower, len), sv_from_parts(upper, len)) && "sv_eq_icase is wrong");
+		}
+	}
+
+	char line[] = "  word\tnext\n";
+	assert(so_skip_whitespace(line) == line + 2 && "so_skip_whitespace is wrong");
+	assert(so_skip_untill_whitespace(line + 2) == line + 6 && "so_skip_untill_whitespace is wrong");
+	assert(so_skip_untill_next_word(line + 2) == line + 7 && "so_skip_untill_next_word is wrong");
+	assert(so_skip_untill_x_char(line, 'z') == line + 12 && "so_skip_untill_x_char ran past the end");
+	assert(so_skip_to_nextline(line) == line + 12 && so_skip_to_nextline(line + 12) == line + 12 &&
+	       "so_skip_to_nextline is wrong");
+	assert(so_skip_untill_whitespace(line + 12) == line + 12 && "so_skip_untill_whitespace ran past the end");
+
+	// Bounded versions against a byte loop, the buffer is not terminated
+	// and the bytes after end are the ones being searched for
+	static char skip_buf[300];
+	for (int round = 0; round < 2000; round++) {
+		size_t len = rand() % 200;
+		size_t start = rand() % (len + 1);
+		const char alphabet[] = "ab \t\n\rx";
+		for (size_t i = 0; i < sizeof(skip_buf); i++)
+			skip_buf[i] = i < len ? alphabet[rand() % (round % 2 ? 7 : 3)] : (i % 2 ? ' ' : 'x');
+		char *in = skip_buf + start, *end = skip_buf + len;
+		char *ws = in, *word = in, *x = in;
+		while (ws < end && strchr(" \t\n\r", *ws))
+			ws++;
+		while (word < end && !strchr(" \t\n\r", *word))
+			word++;
+		while (x < end && *x != 'x')
+			x++;
+		assert(so_skip_whitespace_bounded(in, end) == ws && "so_skip_whitespace_bounded is wrong");
+		assert(so_skip_untill_whitespace_bounded(in, end) == word && "so_skip_untill_whitespace_bounded is wrong");
+		assert(so_skip_untill_next_word_bounded(in, end) == so_skip_whitespace_bounded(word, end) &&
+		       "so_skip_untill_next_word_bounded is wrong");
+		assert(so_skip_untill_x_char_bounded(in, end, 'x') == x && "so_skip_untill_x_char_bounded is wrong");
+		char *nl = so_skip_untill_x_char_bounded(in, end, '\n');
+		assert(so_skip_to_nextline_bounded(in, end) == (nl < end ? nl + 1 : end) && "so_skip_to_nextline_bounded is wrong");
+	}
+
 	printf("======= STRING VIEW TEST END\n\n\n");
 
 }
@@ -146,7 +403,10 @@ void test_fs()
 	else
 		printf("CWD: %s\n", cwd);
 
-	char *test_file_path = xasprintf("%s/resources/access_time.txt", cwd);
+	struct string_builder path;
+	sb_init(&path, 0);
+	sb_appendf(&path, "%s/resources/access_time.txt", cwd);
+	char *test_file_path = path.data;
 	printf("test_file_path: %s\n", test_file_path);
 
 	struct tm* current_time;
@@ -164,7 +424,7 @@ void test_fs()
 	struct fs_file build_file = fs_file_read("build.sh", FS_READ_TEXT);
 	printf("BUILD FILE: %s\n", build_file.data);
 
-	free(test_file_path);
+	sb_free(&path);
 	printf("======= FILESYSTEM TEST END\n\n\n");
 }
 
@@ -214,9 +474,1743 @@ void test_strvec()
 	printf("str4: %s\n", str4);
 	printf("str5: %s\n", str5);
 
+	char line[] = "key1,key2,key3";
+	string_view view = sv_from_cstr(line);
+	string_view parts[3];
+	for (int i = 0; i < 3; i++)
+		parts[i] = sv_chop_by_delim(&view, ',');
+
+	int first = strvec_push_many(&vec, parts, 3);
+	assert(first == index5 + 1 && "strvec_push_many returned wrong index");
+	assert(sv_eq(strvec_get_sv(&vec, first + 1), SV("key2")) && "strvec_get_sv returned wrong string");
+	assert(strcmp(strvec_get(&vec, first + 2), "key3") == 0 && "strvec string is not null terminated");
+
+	char big[4096];
+	memset(big, 'x', sizeof(big));
+	int index_big = strvec_push_len(&vec, big, sizeof(big));
+	assert(strvec_get_sv(&vec, index_big).len == sizeof(big) && "strvec_push_len length mismatch");
+	assert(strcmp(strvec_get(&vec, index1), "test string1") == 0 && "strvec lost data while growing");
+	assert(strvec_count(&vec) == (size_t)index_big + 1 && "strvec_count mismatch");
+
+	size_t size_before = vec.data_size;
+	assert(strvec_clear(&vec, index_big) && "strvec_clear failed");
+	assert(strvec_get(&vec, index_big) == NULL && "cleared string is still accessible");
+	assert(strvec_clear(&vec, index_big) == 0 && "string cleared twice");
+	assert(strvec_fragmentation(&vec) > 0 && "strvec_fragmentation did not count cleared space");
+
+	int reused = strvec_push(&vec, "reused string");
+	assert(vec.data_size == size_before && "strvec_push did not reuse cleared space");
+	assert(strcmp(strvec_get(&vec, reused), "reused string") == 0 && "reused string is wrong");
+
+	strvec_clear(&vec, index2);
+	assert(strvec_compact(&vec) && "strvec_compact failed");
+	assert(strvec_fragmentation(&vec) == 0 && "strvec_compact left cleared space");
+	assert(strvec_get(&vec, index2) == NULL && "strvec_compact restored a cleared string");
+	assert(strcmp(strvec_get(&vec, index3), "test string3") == 0 && "strvec_compact broke offsets");
+	assert(sv_eq(strvec_get_sv(&vec, reused), SV("reused string")) && "strvec_compact broke offsets");
+
+	strvec_delete_struct(&vec);
+
 	printf("======= STRVEC TEST END\n\n\n");
 }
 
+void test_intern()
+{
+	printf("======= INTERN TEST START\n");
+	struct intern in;
+	if (!intern_init(&in)) {
+		printf("Unable to initialize intern\n");
+		return;
+	}
+
+	char buf[64];
+	for (int i = 0; i < 10000; i++) {
+		int len = snprintf(buf, sizeof(buf), "host%d.example.com", i % 1000);
+		uint32 id = intern(&in, sv_from_parts(buf, len));
+		assert(id == (uint32)(i % 1000) && "intern returned a new id for a known string");
+	}
+	assert(intern_count(&in) == 1000 && "intern stored duplicates");
+
+	uint32 a = intern(&in, SV("host42.example.com"));
+	uint32 b = intern_find(&in, SV("host42.example.com"));
+	assert(a == b && "intern_find returned a different id");
+	assert(sv_eq(intern_get(&in, a), SV("host42.example.com")) && "intern_get returned wrong string");
+	assert(intern_find(&in, SV("missing")) == INTERN_INVALID_ID && "intern_find found a missing string");
+
+	printf("%zu strings, %zu bytes\n", intern_count(&in), intern_memory(&in));
+	intern_free(&in);
+
+	printf("======= INTERN TEST END\n\n\n");
+}
+
+static int test_cstr_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char**)a, *(char**)b);
+}
+
+void test_strvec_sort()
+{
+	printf("======= STRVEC SORT TEST START\n");
+	struct strvec vec;
+	strvec_init(&vec);
+
+	char buf[32];
+	srand(42);
+	for (int i = 0; i < 20000; i++) {
+		int len = rand() % 12;
+		for (int j = 0; j < len; j++)
+			buf[j] = "abc/"[rand() % 4];
+		strvec_push_len(&vec, buf, len);
+	}
+	strvec_clear(&vec, 7);
+	strvec_sort(&vec);
+
+	size_t count = strvec_count(&vec);
+	assert(strvec_get(&vec, count - 1) == NULL && "cleared string was not sorted to the end");
+	for (size_t i = 1; i < count - 1; i++)
+		assert(strcmp(strvec_get(&vec, i - 1), strvec_get(&vec, i)) <= 0 && "strvec_sort order is wrong");
+
+	char *copy[3] = { "b", "a/", "a" };
+	qsort(copy, 3, sizeof(char*), test_cstr_cmp);
+	struct strvec small;
+	strvec_init(&small);
+	strvec_push(&small, "b");
+	strvec_push(&small, "a/");
+	strvec_push(&small, "a");
+	strvec_sort(&small);
+	for (int i = 0; i < 3; i++)
+		assert(strcmp(strvec_get(&small, i), copy[i]) == 0 && "strvec_sort differs from strcmp");
+
+	int found = strvec_bsearch(&vec, SV("abc"));
+	assert((found == -1 || strcmp(strvec_get(&vec, found), "abc") == 0) && "strvec_bsearch returned wrong string");
+	assert(strvec_bsearch(&small, SV("a/")) == 1 && "strvec_bsearch did not find string");
+	assert(strvec_bsearch(&small, SV("ab")) == -1 && "strvec_bsearch found missing string");
+	assert(strvec_lower_bound(&small, SV("ab")) == 2 && "strvec_lower_bound is wrong");
+	assert(strvec_lower_bound(&small, SV("c")) == 3 && "strvec_lower_bound is wrong");
+
+	strvec_delete_struct(&small);
+	strvec_delete_struct(&vec);
+	printf("======= STRVEC SORT TEST END\n\n\n");
+}
+
+void test_strvec_map()
+{
+	printf("======= STRVEC MAP TEST START\n");
+	struct strvec vec;
+	strvec_init(&vec);
+	strvec_push(&vec, "dictionary");
+	strvec_push(&vec, "words");
+	int removed = strvec_push(&vec, "removed");
+	strvec_push_len(&vec, "with\0zero", 9);
+	strvec_clear(&vec, removed);
+
+	assert(strvec_save(&vec, "strvec_test.bin") && "strvec_save failed");
+
+	struct strvec mapped;
+	assert(strvec_map(&mapped, "strvec_test.bin") && "strvec_map failed");
+	assert(strvec_count(&mapped) == strvec_count(&vec) && "mapped strvec has wrong count");
+	assert(strcmp(strvec_get(&mapped, 1), "words") == 0 && "mapped strvec_get is wrong");
+	assert(strvec_get(&mapped, removed) == NULL && "mapped strvec lost cleared string");
+	assert(sv_eq(strvec_get_sv(&mapped, 3), sv_from_parts("with\0zero", 9)) && "mapped strvec_get_sv is wrong");
+	assert(strvec_push(&mapped, "read only") == -1 && "pushed to a mapped strvec");
+
+	strvec_sort(&mapped);
+	assert(strvec_bsearch(&mapped, SV("words")) == 2 && "strvec_bsearch on mapped strvec failed");
+
+	strvec_delete_struct(&mapped);
+
+	// Entries pointing outside the data are rejected
+	struct strvec_entry *entry = array_get(&vec.offsets, 1);
+	entry->len = vec.data_size;
+	assert(strvec_save(&vec, "strvec_test.bin") && strvec_map(&mapped, "strvec_test.bin") == 0 &&
+	       "mapped a strvec with a string past the data");
+	entry->len = 5;
+	entry->offset = vec.data_size;
+	assert(strvec_save(&vec, "strvec_test.bin") && strvec_map(&mapped, "strvec_test.bin") == 0 &&
+	       "mapped a strvec with an offset past the data");
+	entry->offset = 1;
+	assert(strvec_save(&vec, "strvec_test.bin") && strvec_map(&mapped, "strvec_test.bin") == 0 &&
+	       "mapped a strvec with an unterminated string");
+
+	strvec_delete_struct(&vec);
+	fs_file_delete("strvec_test.bin");
+
+	assert(strvec_map(&mapped, "resources/string_view_file.txt") == 0 && "mapped a file that is not a strvec");
+	printf("======= STRVEC MAP TEST END\n\n\n");
+}
+
+void test_strvec_fc()
+{
+	printf("======= STRVEC FRONT CODING TEST START\n");
+	struct strvec vec;
+	strvec_init(&vec);
+
+	char buf[128];
+	for (int i = 0; i < 5000; i++) {
+		int len = snprintf(buf, sizeof(buf), "/usr/share/doc/package%d/changelog%d.gz", i % 97, i);
+		strvec_push_len(&vec, buf, len);
+	}
+	strvec_push(&vec, "");
+	strvec_sort(&vec);
+
+	struct strvec_fc fc;
+	assert(strvec_fc_build(&fc, &vec, 0) && "strvec_fc_build failed");
+	assert(fc.count == strvec_count(&vec) && "strvec_fc has wrong count");
+	printf("strvec: %zu bytes, front coded: %zu bytes\n", vec.data_size, strvec_fc_memory(&fc));
+	assert(strvec_fc_memory(&fc) < vec.data_size / 2 && "front coding did not compress paths");
+
+	for (size_t i = 0; i < fc.count; i++) {
+		size_t len = strvec_fc_get(&fc, i, buf, sizeof(buf));
+		assert(sv_eq(sv_from_parts(buf, len), strvec_get_sv(&vec, i)) && "strvec_fc_get is wrong");
+	}
+
+	char small[8];
+	size_t len = strvec_fc_get(&fc, 100, small, sizeof(small));
+	assert(len == strvec_get_sv(&vec, 100).len && "strvec_fc_get truncated length is wrong");
+	assert(memcmp(small, strvec_get(&vec, 100), sizeof(small)) == 0 && "strvec_fc_get truncated string is wrong");
+
+	struct strvec_fc_iter it;
+	string_view cur;
+	size_t index = 37;
+	assert(strvec_fc_iter_init(&it, &fc, index) && "strvec_fc_iter_init failed");
+	while (strvec_fc_next(&it, &cur))
+		assert(sv_eq(cur, strvec_get_sv(&vec, index++)) && "strvec_fc_next is wrong");
+	assert(index == fc.count && "strvec_fc_next stopped early");
+	strvec_fc_iter_free(&it);
+
+	for (size_t i = 0; i < fc.count; i += 7) {
+		string_view key = strvec_get_sv(&vec, i);
+		assert(strvec_fc_lower_bound(&fc, key) == strvec_lower_bound(&vec, key) && "strvec_fc_lower_bound is wrong");
+		if (key.len > 0) {
+			key.len--;
+			assert(strvec_fc_lower_bound(&fc, key) == strvec_lower_bound(&vec, key) && "strvec_fc_lower_bound is wrong");
+		}
+	}
+	assert(strvec_fc_lower_bound(&fc, SV("~")) == fc.count && "strvec_fc_lower_bound is wrong");
+
+	strvec_fc_free(&fc);
+	strvec_delete_struct(&vec);
+	printf("======= STRVEC FRONT CODING TEST END\n\n\n");
+}
+
+void test_number()
+{
+	printf("======= NUMBER TEST START\n");
+	uint64 u;
+	int64 i;
+	f64 f;
+
+	assert(sv_to_u64(SV("18446744073709551615,"), &u) == 20 && u == UINT64_MAX && "sv_to_u64 max is wrong");
+	assert(sv_to_u64(SV("18446744073709551616"), &u) == 0 && "sv_to_u64 did not detect overflow");
+	assert(sv_to_u64(SV("000000000000000000000000042x"), &u) == 27 && u == 42 && "sv_to_u64 leading zeros");
+	assert(sv_to_u64(SV("-1"), &u) == 0 && sv_to_u64(SV(""), &u) == 0 && "sv_to_u64 accepted garbage");
+	assert(sv_to_i64(SV("-9223372036854775808"), &i) == 20 && i == INT64_MIN && "sv_to_i64 min is wrong");
+	assert(sv_to_i64(SV("9223372036854775808"), &i) == 0 && "sv_to_i64 did not detect overflow");
+	assert(sv_to_i64(SV("+12345678901234 "), &i) == 15 && i == 12345678901234 && "sv_to_i64 is wrong");
+
+	// Only zeros up to the very end of an exact size buffer
+	struct array zeros;
+	array_init(&zeros, 1, 24);
+	memset(zeros.data, '0', 24);
+	assert(sv_to_u64(sv_from_parts((char*)zeros.data, 24), &u) == 24 && u == 0 && "sv_to_u64 all zeros is wrong");
+	memset(zeros.data, '-', 1);
+	assert(sv_to_i64(sv_from_parts((char*)zeros.data, 24), &i) == 24 && i == 0 && "sv_to_i64 all zeros is wrong");
+	array_free(&zeros);
+	assert(sv_to_hex(SV("0xDeadBeef!"), &u) == 10 && u == 0xdeadbeef && "sv_to_hex is wrong");
+	assert(sv_to_hex(SV("ffffffffffffffff"), &u) == 16 && u == UINT64_MAX && "sv_to_hex max is wrong");
+	assert(sv_to_hex(SV("10000000000000000"), &u) == 0 && "sv_to_hex did not detect overflow");
+	assert(sv_to_hex(SV("0xg"), &u) == 1 && u == 0 && "sv_to_hex prefix without digits");
+
+	srand(11);
+	char buf[128];
+	for (int round = 0; round < 100000; round++) {
+		uint64 value = ((uint64)rand() << 42) ^ ((uint64)rand() << 21) ^ rand();
+		value >>= rand() % 64;
+		int len = snprintf(buf, sizeof(buf), "%llu", (unsigned long long)value);
+		assert(sv_to_u64(sv_from_parts(buf, len), &u) == (size_t)len && u == value && "sv_to_u64 is wrong");
+		len = snprintf(buf, sizeof(buf), "%llx", (unsigned long long)value);
+		assert(sv_to_hex(sv_from_parts(buf, len), &u) == (size_t)len && u == value && "sv_to_hex is wrong");
+		len = snprintf(buf, sizeof(buf), "%lld", -(long long)(value >> 1));
+		assert(sv_to_i64(sv_from_parts(buf, len), &i) == (size_t)len && i == -(int64)(value >> 1) && "sv_to_i64 is wrong");
+	}
+
+	const char *floats[] = {
+		"0", "-0", "1", "1.5e-3", ".5", "5.", "1e", "1e+", "2.2250738585072014e-308",
+		"4.9406564584124654e-324", "2.4703282292062327e-324", "1.7976931348623157e308",
+		"1.7976931348623159e308", "1e400", "1e-400", "9007199254740993",
+		"0.1000000000000000055511151231257827021181583404541015625",
+		"123456789012345678901234567890e-10", "7.3177701707893310e+15",
+		"00000000000000000000000000000001.5", "Infinity", "-inf", "nan",
+	};
+	for (size_t k = 0; k < ARRAY_SIZE(floats); k++) {
+		char *end;
+		f64 expected = strtod(floats[k], &end);
+		size_t len = sv_to_f64(sv_from_cstr((char*)floats[k]), &f);
+		assert(len == (size_t)(end - floats[k]) && "sv_to_f64 consumed the wrong length");
+		assert((isnan(expected) ? isnan(f) : memcmp(&f, &expected, sizeof(f)) == 0) && "sv_to_f64 is wrong");
+	}
+
+	for (int round = 0; round < 200000; round++) {
+		int len;
+		if (round % 2) {
+			uint64 bits = ((uint64)rand() << 42) ^ ((uint64)rand() << 21) ^ rand();
+			memcpy(&f, &bits, sizeof(f));
+			if (isnan(f) || isinf(f))
+				continue;
+			len = snprintf(buf, sizeof(buf), "%.*g", 1 + rand() % 17, f);
+		} else {
+			int digits = 1 + rand() % 25;
+			int dot = rand() % (digits + 1);
+			len = 0;
+			for (int d = 0; d < digits; d++) {
+				if (d == dot)
+					buf[len++] = '.';
+				buf[len++] = '0' + rand() % 10;
+			}
+			len += snprintf(buf + len, sizeof(buf) - len, "e%d", rand() % 700 - 350);
+		}
+
+		char *end;
+		f64 expected = strtod(buf, &end);
+		assert(sv_to_f64(sv_from_parts(buf, len), &f) == (size_t)(end - buf) && "sv_to_f64 consumed the wrong length");
+		assert(memcmp(&f, &expected, sizeof(f)) == 0 && "sv_to_f64 is not correctly rounded");
+	}
+
+	printf("======= NUMBER TEST END\n\n\n");
+}
+
+static int test_hash_cmp(const void *a, const void *b)
+{
+	uint64 x = *(const uint64*)a, y = *(const uint64*)b;
+	return (x > y) - (x < y);
+}
+
+void test_hash()
+{
+	printf("======= HASH TEST START\n");
+	struct array buf_array;
+	size_t buf_len = 3 * 4096 + 17;
+	array_init(&buf_array, 1, buf_len);
+	unsigned char *buf = buf_array.data;
+	srand(3);
+	for (size_t i = 0; i < buf_len; i++)
+		buf[i] = rand();
+
+	// Streaming in random pieces gives the one-shot hash
+	for (size_t len = 0; len < buf_len; len += len < 600 ? 1 : 97) {
+		uint64 seed = len % 3 ? (uint64)rand() << 20 : 0;
+		uint64 expected = hash64(buf, len, seed);
+		struct hash_state state;
+		hash_init(&state, seed);
+		for (size_t done = 0; done < len;) {
+			size_t piece = rand() % (len % 2 ? 70 : 700);
+			piece = MIN(piece, len - done);
+			hash_update(&state, buf + done, piece);
+			done += piece;
+		}
+		assert(hash_final(&state) == expected && "streaming hash differs from hash64");
+	}
+
+	assert(hash64("abc", 3, 0) != hash64("abc", 3, 1) && "seed does not change the hash");
+	assert(sv_hash64(SV("hello"), 5) == hash64("hello", 5, 5) && "sv_hash64 differs from hash64");
+
+	/*
+	 * Avalanche: flipping one input bit flips every output bit with
+	 * probability 1/2, checked per (input bit, output bit) pair.
+	 */
+	const size_t lengths[] = { 3, 4, 8, 13, 16, 33, 64, 100, 256, 257, 1000, 3000 };
+	const int trials = 1000;
+	for (size_t l = 0; l < ARRAY_SIZE(lengths); l++) {
+		size_t len = lengths[l];
+		int in_bits = MIN(len * 8, (size_t)96);
+		static int flips[96][64];
+		memset(flips, 0, sizeof(flips));
+		for (int t = 0; t < trials; t++) {
+			for (size_t i = 0; i < len; i++)
+				buf[i] = rand();
+			uint64 h = hash64(buf, len, 0);
+			for (int b = 0; b < in_bits; b++) {
+				// first and last bytes, then spread over the rest
+				size_t bit = b < 64 ? (b < 32 ? (size_t)b : len * 8 - 64 + b) : (size_t)(b * 7919) % (len * 8);
+				buf[bit / 8] ^= 1 << (bit % 8);
+				uint64 diff = h ^ hash64(buf, len, 0);
+				buf[bit / 8] ^= 1 << (bit % 8);
+				for (int o = 0; o < 64; o++)
+					flips[b][o] += (diff >> o) & 1;
+			}
+		}
+		for (int b = 0; b < in_bits; b++)
+			for (int o = 0; o < 64; o++)
+				assert(flips[b][o] > trials * 0.4 && flips[b][o] < trials * 0.6 && "hash avalanche is biased");
+	}
+
+	// Collisions of sequential and sparse keys, over 64 and 32 bits
+	size_t count = 1 << 20;
+	struct array hashes;
+	array_init(&hashes, sizeof(uint64), count);
+	uint64 *h = (uint64*)hashes.data;
+	for (size_t i = 0; i < count; i++) {
+		char key[32];
+		int len = snprintf(key, sizeof(key), "key%zu", i);
+		h[i] = hash64(key, len, 0);
+	}
+	qsort(h, count, sizeof(uint64), test_hash_cmp);
+	for (size_t i = 1; i < count; i++)
+		assert(h[i] != h[i - 1] && "64 bit collision on sequential keys");
+
+	for (size_t i = 0; i < count; i++)
+		h[i] = (uint32)h[i];
+	qsort(h, count, sizeof(uint64), test_hash_cmp);
+	size_t collisions = 0;
+	for (size_t i = 1; i < count; i++)
+		collisions += h[i] == h[i - 1];
+	// about count^2 / 2^33 = 128 expected
+	assert(collisions < 256 && "too many 32 bit collisions");
+
+	// Every 2 bit key of 256 bits
+	size_t n = 0;
+	memset(buf, 0, 32);
+	for (int a = 0; a < 256; a++) {
+		for (int b = a + 1; b < 256; b++) {
+			buf[a / 8] ^= 1 << (a % 8);
+			buf[b / 8] ^= 1 << (b % 8);
+			h[n++] = hash64(buf, 32, 0);
+			buf[a / 8] ^= 1 << (a % 8);
+			buf[b / 8] ^= 1 << (b % 8);
+		}
+	}
+	qsort(h, n, sizeof(uint64), test_hash_cmp);
+	for (size_t i = 1; i < n; i++)
+		assert(h[i] != h[i - 1] && "64 bit collision on sparse keys");
+
+	array_free(&hashes);
+	array_free(&buf_array);
+	printf("======= HASH TEST END\n\n\n");
+}
+
+struct test_mp_match {
+	size_t pattern;
+	size_t offset;
+};
+
+static int test_mp_collect(void *ctx, size_t pattern, size_t offset)
+{
+	struct test_mp_match match = { pattern, offset };
+	array_push(ctx, &match);
+	return 0;
+}
+
+static int test_mp_stop(void *ctx, size_t pattern, size_t offset)
+{
+	(void)pattern;
+	*(size_t*)ctx = offset;
+	return 1;
+}
+
+static int test_mp_match_cmp(const void *a, const void *b)
+{
+	const struct test_mp_match *x = a, *y = b;
+	if (x->offset != y->offset)
+		return (x->offset > y->offset) - (x->offset < y->offset);
+	return (x->pattern > y->pattern) - (x->pattern < y->pattern);
+}
+
+void test_multi_pattern()
+{
+	printf("======= MULTI PATTERN TEST START\n");
+	struct strvec patterns;
+	struct mp_matcher matcher;
+	struct array found, expected;
+
+	strvec_init(&patterns);
+	strvec_push(&patterns, "he");
+	strvec_push(&patterns, "she");
+	strvec_push(&patterns, "his");
+	strvec_push(&patterns, "hers");
+	assert(mp_build(&matcher, &patterns) && "mp_build failed");
+	array_init(&found, sizeof(struct test_mp_match), 0);
+	assert(mp_scan(&matcher, SV("ushers"), test_mp_collect, &found) == 3 && "mp_scan missed matches");
+	struct test_mp_match *m = (struct test_mp_match*)found.data;
+	assert(m[0].pattern == 1 && m[0].offset == 1 && m[1].pattern == 0 && m[1].offset == 2 &&
+	       m[2].pattern == 3 && m[2].offset == 2 && "mp_scan reported wrong matches");
+	size_t stop_offset = 0;
+	assert(mp_scan(&matcher, SV("xxhis he"), test_mp_stop, &stop_offset) == 1 && stop_offset == 2 && "mp_scan did not stop");
+	mp_free(&matcher);
+	strvec_delete_struct(&patterns);
+
+	// Random patterns over a small alphabet against a naive search
+	srand(5);
+	array_init(&expected, sizeof(struct test_mp_match), 0);
+	char text[2000];
+	for (int round = 0; round < 200; round++) {
+		size_t count = 1 + rand() % 40;
+		strvec_init(&patterns);
+		for (size_t i = 0; i < count; i++) {
+			char pattern[8];
+			size_t len = rand() % 7;
+			for (size_t j = 0; j < len; j++)
+				pattern[j] = "abc\xff"[rand() % 4];
+			strvec_push_len(&patterns, pattern, len);
+		}
+		size_t len = rand() % sizeof(text);
+		for (size_t i = 0; i < len; i++)
+			text[i] = "abcd\xff"[rand() % 5];
+
+		assert(mp_build(&matcher, &patterns) && "mp_build failed");
+		found.index = 0;
+		expected.index = 0;
+		size_t matches = mp_scan(&matcher, sv_from_parts(text, len), test_mp_collect, &found);
+		for (size_t i = 0; i < count; i++) {
+			string_view pattern = strvec_get_sv(&patterns, i);
+			for (size_t j = 0; pattern.len > 0 && j + pattern.len <= len; j++) {
+				if (memcmp(text + j, pattern.data, pattern.len) == 0) {
+					struct test_mp_match match = { i, j };
+					array_push(&expected, &match);
+				}
+			}
+		}
+		assert(matches == found.index && found.index == expected.index && "mp_scan match count is wrong");
+		qsort(found.data, found.index, sizeof(struct test_mp_match), test_mp_match_cmp);
+		qsort(expected.data, expected.index, sizeof(struct test_mp_match), test_mp_match_cmp);
+		assert(memcmp(found.data, expected.data, found.index * sizeof(struct test_mp_match)) == 0 && "mp_scan is wrong");
+
+		mp_free(&matcher);
+		strvec_delete_struct(&patterns);
+	}
+
+	array_free(&found);
+	array_free(&expected);
+	printf("======= MULTI PATTERN TEST END\n\n\n");
+}
+
+void test_string_builder()
+{
+	printf("======= STRING BUILDER TEST START\n");
+	struct string_builder sb;
+	char expected[64];
+
+	assert(sb_init(&sb, 4) && "sb_init failed");
+	assert(sb_append_cstr(&sb, "abc") && sb_append_char(&sb, ' ') &&
+	       sb_append_sv(&sb, SV("def")) && "sb_append failed");
+	assert(sb_append_i64(&sb, -42) && sb_append_u64(&sb, 18446744073709551615ULL) &&
+	       sb_append_i64(&sb, INT64_MIN) && "sb_append_int failed");
+	assert(sb_appendf(&sb, "|%d|%s|", 7, "x") && "sb_appendf failed");
+	string_view result = sb_to_sv(&sb);
+	const char *want = "abc def-4218446744073709551615-9223372036854775808|7|x|";
+	assert(result.len == strlen(want) && !strcmp(result.data, want) && "sb content wrong");
+
+	sb_reset(&sb);
+	assert(sb.len == 0 && sb.data[0] == '\0' && "sb_reset failed");
+	assert(sb_append_f64(&sb, 0.1) && sb_append_char(&sb, ' ') && sb_append_hex64(&sb, 0xbeef) &&
+	       !strcmp(sb.data, "0.1 beef") && "sb_append_f64/hex64 failed");
+
+	// A failed builder takes nothing until sb_reset(), even with room left
+	sb.failed = 1;
+	assert(!sb_append_char(&sb, 'x') && !sb_append_cstr(&sb, "x") && sb.len == 8 &&
+	       !strcmp(sb.data, "0.1 beef") && "failed sb was appended to");
+
+	// Exercise the grow and format again path of sb_appendf
+	sb_reset(&sb);
+	for (int i = 0; i < 1000; i++) {
+		int len = snprintf(expected, sizeof(expected), "%d:%.3f,", i, i * 0.5);
+		size_t before = sb.len;
+		assert(sb_appendf(&sb, "%d:%.3f,", i, i * 0.5) && "sb_appendf failed");
+		assert(sb.len == before + len && !memcmp(sb.data + before, expected, len) &&
+		       "sb_appendf wrote wrong content");
+	}
+	assert(sb.data[sb.len] == '\0' && "sb not terminated");
+	sb_free(&sb);
+
+	struct arena ar;
+	arena_init(&ar);
+	assert(sb_init_arena(&sb, &ar, 0) && "sb_init_arena failed");
+	for (int i = 0; i < 2000; i++)
+		assert(sb_append_u64(&sb, i % 10) && "sb arena append failed");
+	for (int i = 0; i < 2000; i++)
+		assert(sb.data[i] == '0' + i % 10 && "sb arena content wrong");
+	assert(sb.len == 2000 && sb.data[2000] == '\0' && "sb arena length wrong");
+	sb_free(&sb);
+
+	char *sub = so_get_substring_arena(&ar, "hello world", 5);
+	assert(!strcmp(sub, "hello") && "so_get_substring_arena failed");
+	arena_free(&ar);
+	printf("======= STRING BUILDER TEST END\n\n\n");
+}
+
+static uint64 test_rand64()
+{
+	return ((uint64)rand() << 62) ^ ((uint64)rand() << 31) ^ (uint64)rand();
+}
+
+// Significant digits of a fmt_f64 result
+static int test_fmt_digits(const char *s, size_t len)
+{
+	int count = 0, pending_zeros = 0, leading = 1;
+	for (size_t i = 0; i < len && s[i] != 'e'; i++) {
+		if (s[i] < '0' || s[i] > '9')
+			continue;
+		if (s[i] == '0') {
+			if (!leading)
+				pending_zeros++;
+			continue;
+		}
+		leading = 0;
+		count += pending_zeros + 1;
+		pending_zeros = 0;
+	}
+	return count;
+}
+
+void test_fmt()
+{
+	printf("======= FMT TEST START\n");
+	char buf[64], expected[64];
+	size_t len;
+
+	const uint64 edges[] = { 0, 1, 9, 10, 99, 100, 999999999, 1000000000, 9999999999999999999ULL,
+				 10000000000000000000ULL, UINT64_MAX };
+	for (size_t i = 0; i < ARRAY_SIZE(edges); i++) {
+		len = fmt_u64(buf, edges[i]);
+		assert(len == (size_t)snprintf(expected, sizeof(expected), "%llu", (unsigned long long)edges[i]) &&
+		       !memcmp(buf, expected, len) && "fmt_u64 edge failed");
+	}
+	len = fmt_i64(buf, INT64_MIN);
+	assert(len == 20 && !memcmp(buf, "-9223372036854775808", len) && "fmt_i64 INT64_MIN failed");
+	len = fmt_hex64(buf, 0);
+	assert(len == 1 && buf[0] == '0' && "fmt_hex64 zero failed");
+
+	srand(11);
+	for (int i = 0; i < 100000; i++) {
+		uint64 u = test_rand64() >> (rand() % 64);
+		len = fmt_u64(buf, u);
+		assert(len == (size_t)snprintf(expected, sizeof(expected), "%llu", (unsigned long long)u) &&
+		       !memcmp(buf, expected, len) && "fmt_u64 failed");
+		assert(fmt_u64_len(u) == (int)len && "fmt_u64_len failed");
+		len = fmt_i64(buf, (int64)u);
+		assert(len == (size_t)snprintf(expected, sizeof(expected), "%lld", (long long)u) &&
+		       !memcmp(buf, expected, len) && "fmt_i64 failed");
+		len = fmt_hex64(buf, u);
+		assert(len == (size_t)snprintf(expected, sizeof(expected), "%llx", (unsigned long long)u) &&
+		       !memcmp(buf, expected, len) && "fmt_hex64 failed");
+	}
+
+	const struct { f64 value; const char *text; } floats[] = {
+		{ 0.0, "0" }, { -0.0, "-0" }, { 1.0, "1" }, { 0.1, "0.1" }, { -123.456, "-123.456" },
+		{ 1e20, "100000000000000000000" }, { 1e21, "1e+21" }, { 1e-6, "0.000001" },
+		{ 1.5e-7, "1.5e-7" }, { 5e-324, "5e-324" }, { 1.7976931348623157e308, "1.7976931348623157e+308" },
+		{ 9007199254740993.0, "9007199254740992" }, { INFINITY, "inf" }, { -INFINITY, "-inf" }, { NAN, "nan" },
+	};
+	for (size_t i = 0; i < ARRAY_SIZE(floats); i++) {
+		len = fmt_f64(buf, floats[i].value);
+		assert(len == strlen(floats[i].text) && !memcmp(buf, floats[i].text, len) && "fmt_f64 failed");
+	}
+
+	// Random bit patterns read back exactly and have no more digits
+	// than the shortest %.*e that round trips
+	for (int i = 0; i < 100000; i++) {
+		uint64 bits = test_rand64();
+		f64 value, parsed;
+		memcpy(&value, &bits, sizeof(value));
+		if (isnan(value) || isinf(value))
+			continue;
+		len = fmt_f64(buf, value);
+		assert(len <= FMT_F64_MAX && "fmt_f64 too long");
+		string_view sv = { buf, len };
+		assert(sv_to_f64(sv, &parsed) == len && parsed == value && "fmt_f64 does not round trip");
+		int shortest = 1;
+		while (snprintf(expected, sizeof(expected), "%.*e", shortest - 1, value),
+		       strtod(expected, NULL) != value)
+			shortest++;
+		assert(test_fmt_digits(buf, len) == shortest && "fmt_f64 is not shortest");
+	}
+	printf("======= FMT TEST END\n\n\n");
+}
+
+// Checks every query of li against the line starts found byte by byte
+static void test_line_index_check(struct line_index *li, char *data, size_t len)
+{
+	struct array starts;
+	array_init(&starts, sizeof(size_t), 0);
+	for (size_t i = 0; i < len; i++) {
+		if (i == 0 || data[i - 1] == '\n') {
+			size_t *start = array_alloc(&starts);
+			*start = i;
+		}
+	}
+	size_t count = starts.index;
+	size_t *start = (size_t*)starts.data;
+
+	assert(line_count(li) == count && "line_count is wrong");
+	for (size_t line = 0; line < count; line += 1 + (count > 5000 ? rand() % 1024 : 0)) {
+		size_t end = line + 1 < count ? start[line + 1] - 1 : len - (data[len - 1] == '\n');
+		string_view sv = line_at(li, line);
+		assert(sv.data == data + start[line] && sv.len == end - start[line] && "line_at is wrong");
+	}
+	assert(line_at(li, count).len == 0 && "line_at out of range is not empty");
+
+	size_t line = 0;
+	for (size_t off = 0; off <= len; off += 1 + (len > 5000 ? rand() % 4096 : 0)) {
+		while (line + 1 < count && start[line + 1] <= off)
+			line++;
+		size_t expected = off == len && len > 0 && data[len - 1] == '\n' ? count : line;
+		assert(line_of_offset(li, off) == expected && "line_of_offset is wrong");
+	}
+	array_free(&starts);
+}
+
+void test_line_index()
+{
+	printf("======= LINE INDEX TEST START\n");
+	struct line_index li;
+	char text[] = "first\n\nthird line\r\nlast";
+
+	assert(line_index_build(&li, sv_from_cstr(text), 2, 1) && "line_index_build failed");
+	assert(line_count(&li) == 4 && "line_count is wrong");
+	assert(sv_eq(line_at(&li, 2), SV("third line\r")) && sv_eq(line_at(&li, 3), SV("last")) && "line_at is wrong");
+	assert(line_of_offset(&li, 7) == 2 && line_of_offset(&li, 1000) == 3 && "line_of_offset is wrong");
+	line_index_free(&li);
+
+	assert(line_index_build(&li, sv_from_parts(text, 0), 0, 1) && line_count(&li) == 0 &&
+	       line_of_offset(&li, 0) == 0 && "empty line index is wrong");
+	line_index_free(&li);
+
+	size_t big_len = 4 * LINE_INDEX_PARALLEL_MIN_CHUNK + 321;
+	struct array big_buf;
+	array_init(&big_buf, 1, big_len);
+	char *big = (char*)big_buf.data;
+
+	srand(44);
+	const size_t strides[] = { 1, 3, 64, 1000 };
+	for (int round = 0; round < 200; round++) {
+		// Short and long lines, runs of empty lines
+		size_t len = rand() % 3000;
+		int density = 1 + rand() % 200;
+		for (size_t i = 0; i < len; i++)
+			big[i] = rand() % density == 0 ? '\n' : 'a' + i % 26;
+		if (round % 4 == 0 && len > 0)
+			big[len - 1] = '\n';
+		size_t stride = strides[round % ARRAY_SIZE(strides)];
+		assert(line_index_build(&li, sv_from_parts(big, len), stride, 1) && "line_index_build failed");
+		test_line_index_check(&li, big, len);
+		line_index_free(&li);
+	}
+
+	for (size_t i = 0; i < big_len; i++)
+		big[i] = rand() % 40 ? 'x' : '\n';
+	for (size_t s = 0; s < ARRAY_SIZE(strides); s++) {
+		assert(line_index_build(&li, sv_from_parts(big, big_len), strides[s], 4) && "parallel line_index_build failed");
+		test_line_index_check(&li, big, big_len);
+		line_index_free(&li);
+	}
+
+	string_view rest = sv_from_cstr(text);
+	rest = sv_next_line(rest);
+	assert(sv_eq(rest, SV("\nthird line\r\nlast")) && "sv_next_line is wrong");
+	assert(sv_eq(sv_next_line(SV("last")), SV("last")) && sv_eq(sv_next_line(SV("last\n")), SV("last\n")) &&
+	       "sv_next_line ran past the end");
+
+	array_free(&big_buf);
+	printf("======= LINE INDEX TEST END\n\n\n");
+}
+
+// Appends a field as "#:bytes|length" so rows compare as strings
+static void test_csv_put_field(struct string_builder *out, const char *data, size_t len)
+{
+	sb_append_cstr(out, "#:");
+	size_t value = out->len;
+	int in_quote = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (data[i] != '"') {
+			sb_append_char(out, data[i]);
+		} else if (in_quote && i + 1 < len && data[i + 1] == '"') {
+			sb_append_char(out, '"');
+			i++;
+		} else {
+			in_quote = !in_quote;
+		}
+	}
+	sb_appendf(out, "|%zu", out->len - value);
+}
+
+// Byte at a time reference for the same rules as csv.h
+static int test_csv_reference(string_view sv, char delim, struct string_builder *out)
+{
+	size_t field_start = 0, fields = 0;
+	int in_quote = 0, has_quote = 0;
+	for (size_t i = 0; i <= sv.len; i++) {
+		int at_end = i == sv.len;
+		char c = at_end ? '\n' : sv.data[i];
+		if (!at_end && c == '"') {
+			in_quote = !in_quote;
+			has_quote = 1;
+			continue;
+		}
+		if (at_end && in_quote)
+			return 0;
+		if (in_quote || (c != delim && c != '\n'))
+			continue;
+		size_t end = i;
+		if (c == '\n' && end > field_start && sv.data[end - 1] == '\r')
+			end--;
+		if (c != '\n' || fields > 0 || end > field_start || has_quote) {
+			test_csv_put_field(out, sv.data + field_start, end - field_start);
+			fields++;
+			if (c == '\n') {
+				sb_append_char(out, '\n');
+				fields = 0;
+			}
+		}
+		field_start = i + 1;
+		has_quote = 0;
+	}
+	return 1;
+}
+
+static int test_csv_collect(void *ctx, string_view *fields, size_t count)
+{
+	struct string_builder *out = ctx;
+	for (size_t i = 0; i < count; i++) {
+		sb_append_cstr(out, "#:");
+		sb_append_sv(out, fields[i]);
+		sb_appendf(out, "|%zu", fields[i].len);
+	}
+	sb_append_char(out, '\n');
+	return 0;
+}
+
+static int test_csv_stop(void *ctx, string_view *fields, size_t count)
+{
+	(void)fields;
+	(void)count;
+	return ++*(int*)ctx == 2;
+}
+
+static void test_csv_table_dump(struct csv_table *table, struct string_builder *out)
+{
+	for (size_t r = 0; r < csv_row_count(table); r++) {
+		size_t count;
+		string_view *fields = csv_row(table, r, &count);
+		test_csv_collect(out, fields, count);
+	}
+}
+
+void test_csv()
+{
+	printf("======= CSV TEST START\n");
+	struct csv_parser p;
+	struct csv_table table;
+	struct string_builder got, want;
+	sb_init(&got, 0);
+	sb_init(&want, 0);
+
+	char text[] = "a,b\r\n\"c,d\",\"e\"\"f\"\n\n\"multi\nline\",,x\nlast";
+	assert(csv_parse_table(&table, sv_from_cstr(text), ',', 1) && "csv_parse_table failed");
+	size_t count;
+	assert(csv_row_count(&table) == 4 && "csv row count is wrong");
+	string_view *row = csv_row(&table, 1, &count);
+	assert(count == 2 && sv_eq(row[0], SV("c,d")) && sv_eq(row[1], SV("e\"f")) && "quoted csv fields are wrong");
+	assert(row[0].data == text + 6 && "quoted field was copied");
+	row = csv_row(&table, 2, &count);
+	assert(count == 3 && sv_eq(row[0], SV("multi\nline")) && row[1].len == 0 && sv_eq(row[2], SV("x")) &&
+	       "multi line csv field is wrong");
+	row = csv_row(&table, 3, &count);
+	assert(count == 1 && sv_eq(row[0], SV("last")) && "last csv row is wrong");
+	csv_table_free(&table);
+
+	assert(!csv_parse_table(&table, SV("a,\"open\n"), ',', 1) && "unterminated quote accepted");
+	int calls = 0;
+	csv_init(&p, ',', test_csv_stop, &calls);
+	assert(csv_parse(&p, SV("1\n2\n3\n")) && calls == 2 && "csv callback did not stop");
+	csv_free(&p);
+
+	srand(45);
+	static char buf[400];
+	for (int round = 0; round < 3000; round++) {
+		size_t len = rand() % sizeof(buf);
+		const char *alphabet = round % 2 ? "ab,\"\n\r\t" : "aaaaaaaa,\"\n";
+		size_t letters = strlen(alphabet);
+		for (size_t i = 0; i < len; i++)
+			buf[i] = alphabet[rand() % letters];
+		char delim = round % 3 ? ',' : '\t';
+		string_view sv = sv_from_parts(buf, len);
+
+		sb_reset(&want);
+		int ok = test_csv_reference(sv, delim, &want);
+
+		sb_reset(&got);
+		csv_init(&p, delim, test_csv_collect, &got);
+		assert(csv_parse(&p, sv) == ok && "csv_parse result is wrong");
+		assert((!ok || sv_eq(sb_to_sv(&got), sb_to_sv(&want))) && "csv_parse rows are wrong");
+		csv_free(&p);
+
+		sb_reset(&got);
+		csv_init(&p, delim, test_csv_collect, &got);
+		for (size_t i = 0; i < len;) {
+			size_t piece = rand() % 100;
+			piece = MIN(piece, len - i);
+			assert(csv_feed(&p, sv_from_parts(buf + i, piece)) && "csv_feed failed");
+			i += piece;
+		}
+		assert(csv_finish(&p) == ok && "csv_finish result is wrong");
+		assert((!ok || sv_eq(sb_to_sv(&got), sb_to_sv(&want))) && "csv_feed rows are wrong");
+		csv_free(&p);
+
+		sb_reset(&got);
+		assert(csv_parse_table(&table, sv, delim, 1) == ok && "csv_parse_table result is wrong");
+		if (ok) {
+			test_csv_table_dump(&table, &got);
+			assert(sv_eq(sb_to_sv(&got), sb_to_sv(&want)) && "csv_parse_table rows are wrong");
+			csv_table_free(&table);
+		}
+	}
+
+	// Quoted newlines all over, the chunk cuts have to find real row ends
+	size_t big_len = 4 * CSV_PARALLEL_MIN_CHUNK + 77;
+	struct array big_buf;
+	array_init(&big_buf, 1, big_len);
+	char *big = (char*)big_buf.data;
+	size_t quotes = 0;
+	for (size_t i = 0; i < big_len; i++) {
+		big[i] = "abcdefgh,,\n\n\""[rand() % 13];
+		quotes += big[i] == '"';
+	}
+	if (quotes % 2)
+		big[big_len - 1] = '"';
+	string_view sv = sv_from_parts(big, big_len);
+
+	sb_reset(&want);
+	assert(test_csv_reference(sv, ',', &want) && "csv reference failed");
+	sb_reset(&got);
+	assert(csv_parse_table(&table, sv, ',', 4) && "parallel csv_parse_table failed");
+	test_csv_table_dump(&table, &got);
+	assert(sv_eq(sb_to_sv(&got), sb_to_sv(&want)) && "parallel csv_parse_table rows are wrong");
+	csv_table_free(&table);
+
+	array_free(&big_buf);
+	sb_free(&got);
+	sb_free(&want);
+	printf("======= CSV TEST END\n\n\n");
+}
+
+static void test_json_space(struct string_builder *sb)
+{
+	static const char space[] = " \n\r\t";
+	while (rand() % 3 == 0)
+		sb_append_char(sb, space[rand() % 4]);
+}
+
+static void test_json_both(struct string_builder *pretty, struct string_builder *compact, const char *s)
+{
+	sb_append_cstr(pretty, s);
+	sb_append_cstr(compact, s);
+}
+
+// Random document with random whitespace in pretty, same without in compact
+static void test_json_gen(struct string_builder *pretty, struct string_builder *compact, int depth)
+{
+	static const char *pieces[] = { "a", "bc", "\\\"", "\\\\", "\\n", "\\u00e9", "\\ud83d\\ude00", "{[:,]}", "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" };
+	static const char *scalars[] = { "0", "-12", "3.25", "1e9", "-0.5E-3", "true", "false", "null", "123456789012" };
+	int kind = depth > 4 ? rand() % 2 : rand() % 4;
+
+	test_json_space(pretty);
+	if (kind == 0) {
+		test_json_both(pretty, compact, scalars[rand() % 9]);
+	} else if (kind == 1) {
+		test_json_both(pretty, compact, "\"");
+		for (int n = rand() % 5; n > 0; n--)
+			test_json_both(pretty, compact, pieces[rand() % 9]);
+		test_json_both(pretty, compact, "\"");
+	} else {
+		test_json_both(pretty, compact, kind == 2 ? "[" : "{");
+		for (int n = rand() % 5, i = 0; i < n; i++) {
+			if (i > 0) {
+				test_json_space(pretty);
+				test_json_both(pretty, compact, ",");
+			}
+			if (kind == 3) {
+				test_json_space(pretty);
+				test_json_both(pretty, compact, "\"");
+				test_json_both(pretty, compact, pieces[rand() % 9]);
+				test_json_both(pretty, compact, "\"");
+				test_json_space(pretty);
+				test_json_both(pretty, compact, ":");
+			}
+			test_json_gen(pretty, compact, depth + 1);
+		}
+		test_json_space(pretty);
+		test_json_both(pretty, compact, kind == 2 ? "]" : "}");
+	}
+	test_json_space(pretty);
+}
+
+// Writes the tape back out without whitespace
+static void test_json_dump(struct string_builder *sb, json_value v)
+{
+	enum json_type type = json_type(v);
+	if (type == JSON_ARRAY || type == JSON_OBJECT) {
+		struct json_iter it = json_iter(v);
+		json_value key, value;
+		int first = 1;
+		sb_append_char(sb, type == JSON_ARRAY ? '[' : '{');
+		while (json_iter_next(&it, &key, &value)) {
+			if (!first)
+				sb_append_char(sb, ',');
+			first = 0;
+			if (type == JSON_OBJECT) {
+				test_json_dump(sb, key);
+				sb_append_char(sb, ':');
+			}
+			test_json_dump(sb, value);
+		}
+		sb_append_char(sb, type == JSON_ARRAY ? ']' : '}');
+	} else if (type == JSON_STRING) {
+		sb_append_char(sb, '"');
+		sb_append_sv(sb, json_raw(v));
+		sb_append_char(sb, '"');
+	} else {
+		sb_append_sv(sb, json_raw(v));
+	}
+}
+
+void test_json()
+{
+	printf("======= JSON TEST START\n");
+	struct arena arena;
+	struct json_doc doc;
+	string_view s;
+	int64 i;
+	uint64 u;
+	f64 f;
+	int b;
+	arena_init(&arena);
+
+	char text[] = "{\"name\": \"sdx\", \"tags\": [\"a\", \"b\\n\\u00e9\\ud83d\\ude00\"],\n"
+		"\"n\": -42, \"big\": 18446744073709551615, \"pi\": 3.5e0, \"ok\": true,\n"
+		"\"nothing\": null, \"nested\": {\"x\": [[], {}]}, \"k\\u0065y\": 1}";
+	assert(json_parse(&doc, &arena, sv_from_cstr(text)) && "json_parse failed");
+	json_value root = json_root(&doc);
+	assert(json_type(root) == JSON_OBJECT && json_len(root) == 9 && "json root is wrong");
+	assert(json_string(json_get(root, SV("name")), &arena, &s) && sv_eq(s, SV("sdx")) && "json string is wrong");
+	assert(s.data == text + 10 && "plain json string was copied");
+	json_value tags = json_get(root, SV("tags"));
+	assert(json_type(tags) == JSON_ARRAY && json_len(tags) == 2 && "json array is wrong");
+	assert(json_string(json_at(tags, 1), &arena, &s) && sv_eq(s, SV("b\n\xc3\xa9\xf0\x9f\x98\x80")) &&
+	       "json escapes are decoded wrong");
+	assert(json_type(json_at(tags, 2)) == JSON_INVALID && "json_at past the end");
+	assert(json_i64(json_get(root, SV("n")), &i) && i == -42 && "json i64 is wrong");
+	assert(!json_u64(json_get(root, SV("n")), &u) && "negative json number read as u64");
+	assert(json_u64(json_get(root, SV("big")), &u) && u == UINT64_MAX && "json u64 is wrong");
+	assert(!json_i64(json_get(root, SV("pi")), &i) && json_f64(json_get(root, SV("pi")), &f) && f == 3.5 &&
+	       "json f64 is wrong");
+	assert(json_bool(json_get(root, SV("ok")), &b) && b == 1 && "json bool is wrong");
+	assert(json_type(json_get(root, SV("nothing"))) == JSON_NULL && "json null is wrong");
+	json_value x = json_get(json_get(root, SV("nested")), SV("x"));
+	assert(json_len(x) == 2 && json_type(json_at(x, 1)) == JSON_OBJECT && json_len(json_at(x, 0)) == 0 &&
+	       "nested json is wrong");
+	assert(json_i64(json_get(root, SV("key")), &i) && i == 1 && "escaped json key not found");
+	assert(json_type(json_get(root, SV("missing"))) == JSON_INVALID && "missing json key found");
+
+	static char *invalid[] = {
+		"", "   ", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "[1 2]", "\"open", "[\"a\\\"]", "tru", "nul",
+		"01", "1.", "-", "+1", "1e", ".5", "[1]]", "[[1]", "{1:2}", "{\"a\":}", "[]x", "\\", "[,1]",
+	};
+	for (size_t k = 0; k < sizeof(invalid) / sizeof(invalid[0]); k++)
+		assert(!json_parse(&doc, &arena, sv_from_cstr(invalid[k])) && doc.error && "invalid json accepted");
+	assert(!json_parse(&doc, &arena, SV("[1, 2, @]")) && doc.error_offset == 7 && "json error offset is wrong");
+	assert(json_parse(&doc, &arena, SV("\"\\u12\"")) && !json_string(json_root(&doc), &arena, &s) &&
+	       "bad json escape decoded");
+
+	struct array deep;
+	array_init(&deep, 1, 0);
+	for (int k = 0; k < JSON_MAX_DEPTH + 1; k++)
+		array_push(&deep, "[");
+	assert(!json_parse(&doc, &arena, sv_from_parts((char*)deep.data, deep.index)) && "too deep json accepted");
+	array_free(&deep);
+
+	struct string_builder pretty, compact, dumped;
+	sb_init(&pretty, 0);
+	sb_init(&compact, 0);
+	sb_init(&dumped, 0);
+	srand(46);
+	for (int round = 0; round < 2000; round++) {
+		sb_reset(&pretty);
+		sb_reset(&compact);
+		sb_reset(&dumped);
+		test_json_gen(&pretty, &compact, 0);
+		assert(json_parse(&doc, &arena, sb_to_sv(&pretty)) && "random json rejected");
+		test_json_dump(&dumped, json_root(&doc));
+		assert(sv_eq(sb_to_sv(&dumped), sb_to_sv(&compact)) && "random json tape is wrong");
+		char last = compact.data[compact.len - 1];
+		if (last < '0' || last > '9') {
+			compact.len--;
+			assert(!json_parse(&doc, &arena, sb_to_sv(&compact)) && "truncated json accepted");
+		}
+	}
+	sb_free(&pretty);
+	sb_free(&compact);
+	sb_free(&dumped);
+	arena_free(&arena);
+	printf("======= JSON TEST END\n\n\n");
+}
+
+// Backtracking reference for test_glob, same rules as glob_pattern.c
+static int test_glob_ref(const char *start, const char *p, const char *pe, const char *s, const char *se, int pathname)
+{
+	if (p == pe)
+		return s == se;
+
+	if (*p == '*') {
+		const char *q = p;
+		while (q < pe && *q == '*')
+			q++;
+		int globstar = pathname && q - p >= 2 && (p == start || p[-1] == '/') && (q == pe || *q == '/');
+		if (globstar && q < pe) {
+			if (test_glob_ref(start, q + 1, pe, s, se, pathname))
+				return 1;
+			for (const char *t = s; t < se; t++)
+				if (*t == '/' && test_glob_ref(start, q + 1, pe, t + 1, se, pathname))
+					return 1;
+			return 0;
+		}
+		for (const char *t = s;; t++) {
+			if (test_glob_ref(start, q, pe, t, se, pathname))
+				return 1;
+			if (t == se || (pathname && !globstar && *t == '/'))
+				return 0;
+		}
+	}
+
+	if (s == se)
+		return 0;
+	if (*p == '?')
+		return !(pathname && *s == '/') && test_glob_ref(start, p + 1, pe, s + 1, se, pathname);
+	if (*p == '[') {
+		// The random patterns only use well formed [xy] and [!xy]
+		const char *q = p + 1;
+		int negate = *q == '!', in = 0;
+		q += negate;
+		for (; *q != ']'; q++)
+			in |= *q == *s;
+		if (in == negate || (pathname && *s == '/'))
+			return 0;
+		return test_glob_ref(start, q + 1, pe, s + 1, se, pathname);
+	}
+	if (*p == '\\' && p + 1 < pe)
+		p++;
+	return *p == *s && test_glob_ref(start, p + 1, pe, s + 1, se, pathname);
+}
+
+void test_glob()
+{
+	printf("======= GLOB TEST START\n");
+	struct glob_pattern g;
+	static const struct { char *pattern; char *path; int flags; int match; } cases[] = {
+		{ "*.c", "main.c", GLOB_PATHNAME, 1 },
+		{ "*.c", "src/main.c", GLOB_PATHNAME, 0 },
+		{ "*.c", "src/main.c", 0, 1 },
+		{ "src/**/*.c", "src/main.c", GLOB_PATHNAME, 1 },
+		{ "src/**/*.c", "src/a/b/main.c", GLOB_PATHNAME, 1 },
+		{ "src/**/*.c", "srcmain.c", GLOB_PATHNAME, 0 },
+		{ "**/x.c", "x.c", GLOB_PATHNAME, 1 },
+		{ "**/x.c", "ax.c", GLOB_PATHNAME, 0 },
+		{ "a/**", "a/b/c", GLOB_PATHNAME, 1 },
+		{ "a/**", "a", GLOB_PATHNAME, 0 },
+		{ "a**b", "a/b", GLOB_PATHNAME, 0 },
+		{ "file?.[ch]", "file1.h", GLOB_PATHNAME, 1 },
+		{ "file?.[!ch]", "file1.h", GLOB_PATHNAME, 0 },
+		{ "[a-c]x", "bx", 0, 1 },
+		{ "[]]", "]", 0, 1 },
+		{ "[!]]", "]", 0, 0 },
+		{ "[ab", "[ab", 0, 1 },
+		{ "\\*", "*", 0, 1 },
+		{ "\\*", "x", 0, 0 },
+		{ "log.*.error", "log.db.error", 0, 1 },
+		{ "", "", 0, 1 },
+		{ "abc", "abcd", 0, 0 },
+		{ "a*a", "a", 0, 0 },
+		{ "**", "x/y", GLOB_PATHNAME, 1 },
+	};
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		assert(glob_compile(&g, sv_from_cstr(cases[i].pattern), cases[i].flags) && "glob_compile failed");
+		assert(glob_match(&g, sv_from_cstr(cases[i].path)) == cases[i].match && "glob match is wrong");
+		glob_free(&g);
+	}
+
+	// Random patterns over a small alphabet against the reference,
+	// long ones go over one word of NFA state
+	static char *pieces[] = { "a", "b", "/", "*", "**", "?", "[ab]", "[!a]", "\\*", "**/", "/**", "ab" };
+	static char path_chars[] = "ab/*";
+	struct array pattern, path;
+	array_init(&pattern, 1, 0);
+	array_init(&path, 1, 0);
+	srand(47);
+	for (int round = 0; round < 20000; round++) {
+		int flags = rand() % 2 ? GLOB_PATHNAME : 0;
+		pattern.index = 0;
+		int pieces_count = round % 100 == 0 ? 60 + rand() % 40 : rand() % 8;
+		for (int k = 0; k < pieces_count; k++) {
+			char *piece = pieces[rand() % 12];
+			for (char *c = piece; *c; c++)
+				array_push(&pattern, c);
+		}
+		assert(glob_compile(&g, sv_from_parts((char*)pattern.data, pattern.index), flags) && "random glob_compile failed");
+		for (int k = 0; k < 20; k++) {
+			path.index = 0;
+			int len = rand() % (round % 100 == 0 ? 120 : 12);
+			for (int j = 0; j < len; j++)
+				array_push(&path, &path_chars[rand() % 4]);
+			char *pp = (char*)pattern.data, *sp = (char*)path.data;
+			int want = test_glob_ref(pp, pp, pp + pattern.index, sp, sp + path.index, flags & GLOB_PATHNAME);
+			assert(glob_match(&g, sv_from_parts(sp, path.index)) == want && "random glob match is wrong");
+		}
+		glob_free(&g);
+	}
+	array_free(&path);
+
+	struct strvec patterns;
+	struct glob_set set;
+	struct array matches;
+	strvec_init(&patterns);
+	array_init(&matches, sizeof(size_t), 0);
+	strvec_push(&patterns, "*.c");
+	strvec_push(&patterns, "src/**");
+	strvec_push(&patterns, "*");
+	strvec_push(&patterns, "**/test_*.c");
+	strvec_push(&patterns, "docs/*.md");
+	strvec_push(&patterns, "src/x/test_y.c");
+	assert(glob_set_build(&set, &patterns, GLOB_PATHNAME) && "glob_set_build failed");
+	assert(glob_set_matches(&set, SV("src/x/test_y.c"), &matches) && "glob_set_matches failed");
+	size_t *found = (size_t*)matches.data;
+	assert(matches.index == 3 && found[0] == 1 && found[1] == 3 && found[2] == 5 && "glob set matches are wrong");
+	matches.index = 0;
+	assert(glob_set_matches(&set, SV("main.c"), &matches) && matches.index == 2 && found[0] == 0 && found[1] == 2 &&
+	       "glob set matches are wrong");
+	assert(glob_set_any(&set, SV("docs/a.md")) && !glob_set_any(&set, SV("docs/a/b.md")) && "glob_set_any is wrong");
+	glob_set_free(&set);
+
+	// Against every pattern on its own
+	strvec_delete_struct(&patterns);
+	strvec_init(&patterns);
+	for (int k = 0; k < 300; k++) {
+		pattern.index = 0;
+		for (int j = rand() % 6; j >= 0; j--) {
+			char *piece = pieces[rand() % 12];
+			for (char *c = piece; *c; c++)
+				array_push(&pattern, c);
+		}
+		strvec_push_len(&patterns, (char*)pattern.data, pattern.index);
+	}
+	assert(glob_set_build(&set, &patterns, GLOB_PATHNAME) && "random glob_set_build failed");
+	for (int round = 0; round < 500; round++) {
+		char buf[16];
+		int len = rand() % 12;
+		for (int j = 0; j < len; j++)
+			buf[j] = path_chars[rand() % 4];
+		matches.index = 0;
+		assert(glob_set_matches(&set, sv_from_parts(buf, len), &matches) && "glob_set_matches failed");
+		size_t next = 0;
+		found = (size_t*)matches.data;
+		for (size_t k = 0; k < set.count; k++) {
+			if (glob_match(&set.patterns[k], sv_from_parts(buf, len))) {
+				assert(next < matches.index && found[next] == k && "glob set missed a pattern");
+				next++;
+			}
+		}
+		assert(next == matches.index && "glob set matched too much");
+		assert(glob_set_any(&set, sv_from_parts(buf, len)) == (next > 0) && "glob_set_any is wrong");
+	}
+	glob_set_free(&set);
+	strvec_delete_struct(&patterns);
+	array_free(&pattern);
+	array_free(&matches);
+	printf("======= GLOB TEST END\n\n\n");
+}
+
+// Plain references for test_encoding
+static size_t test_b64_encode(char *out, const unsigned char *in, size_t len, const char *alphabet, int pad)
+{
+	size_t o = 0;
+	for (size_t i = 0; i < len; i += 3) {
+		uint32 v = (uint32)in[i] << 16;
+		if (i + 1 < len)
+			v |= (uint32)in[i + 1] << 8;
+		if (i + 2 < len)
+			v |= in[i + 2];
+		for (size_t k = 0; k < 4; k++) {
+			if (k <= len - i)
+				out[o++] = alphabet[(v >> (18 - 6 * k)) & 63];
+			else if (pad)
+				out[o++] = '=';
+		}
+	}
+	return o;
+}
+
+static int test_hex_value(int c)
+{
+	const char *digits = "0123456789abcdef0123456789ABCDEF";
+	const char *at = c ? strchr(digits, c) : NULL;
+	return at ? (at - digits) % 16 : -1;
+}
+
+static const char *test_b64_alphabet(int flags)
+{
+	return flags & BASE64_URL ? "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"
+		: "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+}
+
+void test_encoding()
+{
+	printf("======= ENCODING TEST START\n");
+	static const struct { char *plain; char *encoded; } rfc[] = {
+		{ "", "" }, { "f", "Zg==" }, { "fo", "Zm8=" }, { "foo", "Zm9v" },
+		{ "foob", "Zm9vYg==" }, { "fooba", "Zm9vYmE=" }, { "foobar", "Zm9vYmFy" },
+	};
+	static char out[2048], back[2048], want[2048];
+	static unsigned char data[1024];
+	size_t len, bad;
+	for (size_t i = 0; i < sizeof(rfc) / sizeof(rfc[0]); i++) {
+		len = base64_encode(out, sv_from_cstr(rfc[i].plain), 0);
+		assert(sv_eq(sv_from_parts(out, len), sv_from_cstr(rfc[i].encoded)) && "base64 encoding is wrong");
+		assert(base64_decode(back, sv_from_cstr(rfc[i].encoded), 0, &len, &bad) &&
+		       sv_eq(sv_from_parts(back, len), sv_from_cstr(rfc[i].plain)) && "base64 decoding is wrong");
+	}
+	len = base64_encode(out, SV("\xfb\xff"), BASE64_URL | BASE64_NO_PAD);
+	assert(sv_eq(sv_from_parts(out, len), SV("-_8")) && "url base64 is wrong");
+	assert(!base64_decode(back, SV("-_8"), 0, &len, &bad) && bad == 0 && "url alphabet accepted as standard");
+	assert(base64_decode(back, SV("Zg"), 0, &len, &bad) && len == 1 && "unpadded base64 rejected");
+	assert(!base64_decode(back, SV("Zh=="), 0, &len, &bad) && bad == 1 && "nonzero trailing bits accepted");
+	assert(!base64_decode(back, SV("Zm9vY"), 0, &len, &bad) && bad == 4 && "dangling base64 character accepted");
+	assert(!base64_decode(back, SV("Zg==Zg=="), 0, &len, &bad) && bad == 2 && "padding in the middle accepted");
+	assert(!base64_decode(back, SV("Zm9=v"), 0, &len, &bad) && bad == 3 && "misplaced padding accepted");
+
+	len = hex_encode(out, SV("\x01\xab\xff"));
+	assert(sv_eq(sv_from_parts(out, len), SV("01abff")) && "hex encoding is wrong");
+	assert(hex_decode(back, SV("01ABfF"), &len, &bad) && len == 3 && memcmp(back, "\x01\xab\xff", 3) == 0 &&
+	       "hex decoding is wrong");
+	assert(!hex_decode(back, SV("01a"), &len, &bad) && bad == 2 && "odd hex accepted");
+	assert(!hex_decode(back, SV("0g"), &len, &bad) && bad == 1 && "bad hex digit accepted");
+
+	// Every byte value at many positions of blocks the SIMD loops take
+	char block[96];
+	for (int flags = 0; flags <= BASE64_URL; flags += BASE64_URL) {
+		const char *alphabet = test_b64_alphabet(flags);
+		for (int c = 0; c < 256; c++) {
+			const char *at = c ? memchr(alphabet, c, 64) : NULL;
+			for (int pos = 0; pos < 64; pos += 3) {
+				memset(block, 'A', sizeof(block));
+				block[pos] = c;
+				int ok = base64_decode(back, sv_from_parts(block, sizeof(block)), flags, &len, &bad);
+				assert(ok == (at != NULL) && (ok || bad == (size_t)pos) && "base64 validation is wrong");
+				if (ok) {
+					uint32 v = (uint32)(at - alphabet) << (18 - 6 * (pos % 4));
+					unsigned char *group = (unsigned char*)back + pos / 4 * 3;
+					assert(len == 72 && group[0] == (v >> 16) && group[1] == ((v >> 8) & 255) &&
+					       group[2] == (v & 255) && "base64 value is wrong");
+				}
+			}
+			for (int pos = 0; pos < 64; pos += 3) {
+				memset(block, '0', sizeof(block));
+				block[pos] = c;
+				int ok = hex_decode(back, sv_from_parts(block, 64), &len, &bad);
+				int value = test_hex_value(c);
+				assert(ok == (value >= 0) && (ok || bad == (size_t)pos) && "hex validation is wrong");
+				if (ok)
+					assert((unsigned char)back[pos / 2] == (pos % 2 ? value : value << 4) && "hex value is wrong");
+			}
+		}
+	}
+
+	// Random data in one piece and in random chunks, errors at random places
+	srand(48);
+	for (int round = 0; round < 3000; round++) {
+		int flags = rand() % 4;
+		size_t n = rand() % (round % 10 == 0 ? 1000 : 70);
+		for (size_t i = 0; i < n; i++)
+			data[i] = rand();
+		string_view in = sv_from_parts((char*)data, n);
+		size_t want_len = test_b64_encode(want, data, n, test_b64_alphabet(flags), !(flags & BASE64_NO_PAD));
+		size_t enc_len = base64_encode(out, in, flags);
+		assert(enc_len == want_len && enc_len == base64_encoded_len(n, flags) && memcmp(out, want, enc_len) == 0 &&
+		       "random base64 encoding is wrong");
+		assert(base64_decode(back, sv_from_parts(out, enc_len), flags, &len, &bad) && len == n &&
+		       memcmp(back, data, n) == 0 && "random base64 round trip failed");
+
+		struct base64_stream st;
+		base64_stream_init(&st, flags);
+		size_t o = 0;
+		for (size_t i = 0; i < n;) {
+			size_t piece = rand() % 40;
+			piece = piece < n - i ? piece : n - i;
+			o += base64_encode_update(&st, back + o, sv_from_parts((char*)data + i, piece));
+			i += piece;
+		}
+		o += base64_encode_final(&st, back + o);
+		assert(o == enc_len && memcmp(back, out, o) == 0 && "streamed base64 encoding is wrong");
+
+		base64_stream_init(&st, flags);
+		o = 0;
+		for (size_t i = 0; i < enc_len;) {
+			size_t piece = rand() % 40, got;
+			piece = piece < enc_len - i ? piece : enc_len - i;
+			assert(base64_decode_update(&st, back + o, sv_from_parts(out + i, piece), &got, &bad) &&
+			       "streamed base64 decoding failed");
+			o += got;
+			i += piece;
+		}
+		assert(base64_decode_final(&st, back + o, &len, &bad) && o + len == n && memcmp(back, data, n) == 0 &&
+		       "streamed base64 decoding is wrong");
+
+		size_t data_chars = enc_len;
+		while (data_chars > 0 && out[data_chars - 1] == '=')
+			data_chars--;
+		if (data_chars > 0) {
+			size_t pos = rand() % data_chars;
+			out[pos] = "*. \x80\n"[rand() % 5];
+			assert(!base64_decode(back, sv_from_parts(out, enc_len), flags, &len, &bad) && bad == pos &&
+			       "bad base64 byte not reported");
+			base64_stream_init(&st, flags);
+			int ok = 1;
+			for (size_t i = 0; i < enc_len && ok;) {
+				size_t piece = 1 + rand() % 40, got;
+				piece = piece < enc_len - i ? piece : enc_len - i;
+				ok = base64_decode_update(&st, back, sv_from_parts(out + i, piece), &got, &bad);
+				i += piece;
+			}
+			if (ok)
+				ok = base64_decode_final(&st, back, &len, &bad);
+			assert(!ok && bad == pos && "bad streamed base64 byte not reported");
+		}
+
+		len = hex_encode(out, in);
+		for (size_t i = 0; i < n; i++)
+			assert(out[2 * i] == "0123456789abcdef"[data[i] >> 4] && out[2 * i + 1] == "0123456789abcdef"[data[i] & 15] &&
+			       "random hex encoding is wrong");
+		for (size_t i = 0; i < len; i++)
+			if (rand() % 2 && out[i] >= 'a')
+				out[i] -= 32;
+		assert(hex_decode(back, sv_from_parts(out, len), &o, &bad) && o == n && memcmp(back, data, n) == 0 &&
+		       "random hex round trip failed");
+		struct hex_stream hs;
+		hex_stream_init(&hs);
+		o = 0;
+		for (size_t i = 0; i < len;) {
+			size_t piece = rand() % 40, got;
+			piece = piece < len - i ? piece : len - i;
+			assert(hex_decode_update(&hs, back + o, sv_from_parts(out + i, piece), &got, &bad) &&
+			       "streamed hex decoding failed");
+			o += got;
+			i += piece;
+		}
+		assert(hex_decode_final(&hs, &bad) && o == n && memcmp(back, data, n) == 0 && "streamed hex is wrong");
+		if (len > 0) {
+			size_t pos = rand() % len;
+			out[pos] = "g: \x80"[rand() % 4];
+			assert(!hex_decode(back, sv_from_parts(out, len), &o, &bad) && bad == pos && "bad hex byte not reported");
+			hex_stream_init(&hs);
+			int ok = 1;
+			for (size_t i = 0; i < len && ok;) {
+				size_t piece = 1 + rand() % 40, got;
+				piece = piece < len - i ? piece : len - i;
+				ok = hex_decode_update(&hs, back, sv_from_parts(out + i, piece), &got, &bad);
+				i += piece;
+			}
+			assert(!ok && bad == pos && "bad streamed hex byte not reported");
+		}
+	}
+
+	struct arena arena;
+	string_view sv;
+	arena_init(&arena);
+	assert(base64_encode_arena(&arena, SV("foobar"), 0, &sv) && sv_eq(sv, SV("Zm9vYmFy")) && "arena base64 is wrong");
+	assert(base64_decode_arena(&arena, sv, 0, &sv, &bad) && sv_eq(sv, SV("foobar")) && "arena base64 decode is wrong");
+	assert(hex_encode_arena(&arena, SV("hi"), &sv) && sv_eq(sv, SV("6869")) && "arena hex is wrong");
+	assert(hex_decode_arena(&arena, sv, &sv, &bad) && sv_eq(sv, SV("hi")) && "arena hex decode is wrong");
+	arena_free(&arena);
+	printf("======= ENCODING TEST END\n\n\n");
+}
+
+HASHMAP_DEFINE(test_u64map, uint64, uint64)
+HASHMAP_DEFINE_SV(test_svmap, int)
+
+#define TEST_HASHMAP_KEYS 4096
+
+void test_hashmap()
+{
+	printf("======= HASHMAP TEST START\n");
+	static unsigned char present[TEST_HASHMAP_KEYS];
+	static uint64 values[TEST_HASHMAP_KEYS];
+	struct test_u64map map;
+	uint64 *key, *value;
+	size_t iter, count = 0;
+
+	srand(11);
+	assert(test_u64map_init(&map) && "hashmap init failed");
+	assert(!test_u64map_get(&map, 1) && !test_u64map_remove(&map, 1) && "empty hashmap finds a key");
+	for (int op = 0; op < 200000; op++) {
+		uint64 k = rand() % TEST_HASHMAP_KEYS;
+		int r = rand() % 8;
+		if (r < 3) {
+			assert(test_u64map_put(&map, k, k * 31 + op) && "hashmap put failed");
+			count += !present[k];
+			present[k] = 1;
+			values[k] = k * 31 + op;
+		} else if (r < 6) {
+			assert(test_u64map_remove(&map, k) == present[k] && "hashmap remove is wrong");
+			count -= present[k];
+			present[k] = 0;
+		} else {
+			value = test_u64map_get(&map, k);
+			assert((present[k] ? value && *value == values[k] : !value) && "hashmap lookup is wrong");
+		}
+		assert(test_u64map_count(&map) == count && "hashmap count is wrong");
+	}
+
+	// Churn at full load, the table may not grow and removed slots get reused
+	while (map.map.growth_left)
+		for (uint64 k = 0; k < TEST_HASHMAP_KEYS && map.map.growth_left; k++)
+			if (!present[k]) {
+				test_u64map_put(&map, k, k);
+				present[k] = 1;
+				values[k] = k;
+				count++;
+			}
+	size_t capacity = hashmap_capacity(&map.map);
+	for (int op = 0; op < 100000; op++) {
+		uint64 out = rand() % TEST_HASHMAP_KEYS, in = rand() % TEST_HASHMAP_KEYS;
+		if (!present[out] || present[in])
+			continue;
+		assert(test_u64map_remove(&map, out) && "hashmap remove failed");
+		present[out] = 0;
+		assert(test_u64map_put(&map, in, op) && "hashmap put failed");
+		present[in] = 1;
+		values[in] = op;
+	}
+	assert(hashmap_capacity(&map.map) == capacity && "hashmap grew without new keys");
+	for (uint64 k = 0; k < TEST_HASHMAP_KEYS; k++) {
+		value = test_u64map_get(&map, k);
+		assert((present[k] ? value && *value == values[k] : !value) && "hashmap lookup after churn is wrong");
+	}
+
+	// Iteration sees every key once, removing the current one is fine
+	size_t seen = 0, before = count;
+	iter = 0;
+	while (test_u64map_next(&map, &iter, &key, &value)) {
+		assert(present[*key] == 1 && *value == values[*key] && "hashmap iteration is wrong");
+		present[*key] = 2;
+		seen++;
+		if (*key % 2) {
+			present[*key] = 0;
+			assert(test_u64map_remove(&map, *key) && "hashmap remove while iterating failed");
+			count--;
+		}
+	}
+	assert(seen == before && test_u64map_count(&map) == count && "hashmap iteration count is wrong");
+	for (uint64 k = 0; k < TEST_HASHMAP_KEYS; k++)
+		assert((test_u64map_get(&map, k) != NULL) == (present[k] != 0) && "hashmap removal while iterating is wrong");
+
+	hashmap_clear(&map.map);
+	assert(!test_u64map_count(&map) && !test_u64map_get(&map, 2) && "hashmap clear is wrong");
+	test_u64map_free(&map);
+
+	// Reserve keeps the table from rehashing while filling
+	struct hashmap set;
+	assert(hashmap_init(&set, sizeof(uint32), 0) && hashmap_reserve(&set, 1000) && "hashmap reserve failed");
+	capacity = hashmap_capacity(&set);
+	assert(capacity - capacity / 8 >= 1000 && "hashmap reserve is too small");
+	for (uint32 k = 0; k < 1000; k++) {
+		int inserted;
+		assert(hashmap_insert(&set, &k, &inserted) && inserted && "hashmap set insert failed");
+		assert(hashmap_insert(&set, &k, &inserted) && !inserted && "hashmap set inserted twice");
+	}
+	assert(hashmap_capacity(&set) == capacity && hashmap_count(&set) == 1000 && "hashmap reserve did not hold");
+	hashmap_free(&set);
+
+	// String keys are compared by content, not by pointer
+	static char names[512][16];
+	struct test_svmap svmap;
+	assert(test_svmap_init(&svmap) && "hashmap sv init failed");
+	for (int i = 0; i < 512; i++) {
+		snprintf(names[i], sizeof(names[i]), "key%d", i * 7);
+		test_svmap_put(&svmap, sv_from_cstr(names[i]), i);
+	}
+	test_svmap_put(&svmap, SV(""), -1);
+	char probe[16];
+	for (int i = 0; i < 512; i++) {
+		snprintf(probe, sizeof(probe), "key%d", i * 7);
+		int *v = test_svmap_get(&svmap, sv_from_cstr(probe));
+		assert(v && *v == i && "hashmap sv lookup is wrong");
+	}
+	assert(!test_svmap_get(&svmap, SV("key1")) && !test_svmap_get(&svmap, SV("key")) && "hashmap sv false hit");
+	assert(*test_svmap_get(&svmap, SV("")) == -1 && "hashmap empty sv key is wrong");
+	assert(test_svmap_count(&svmap) == 513 && "hashmap sv count is wrong");
+	test_svmap_free(&svmap);
+
+	printf("======= HASHMAP TEST END\n");
+}
+
+#define TEST_CMAP_STABLE 1024
+#define TEST_CMAP_CHURN 20000
+#define TEST_CMAP_WRITERS 2
+#define TEST_CMAP_READERS 2
+#define TEST_CMAP_MAGIC 0x5555aaaa5555aaaaull
+
+struct test_cmap_value {
+	uint64 a;
+	uint64 b;		// a ^ TEST_CMAP_MAGIC, a torn read breaks it
+};
+
+struct test_cmap_job {
+	struct cmap *map;
+	int id;
+	int *done;
+};
+
+static void test_cmap_check(uint64 key, struct test_cmap_value *v)
+{
+	assert(v->b == (v->a ^ TEST_CMAP_MAGIC) && v->a / 1000 == key && "cmap read a torn value");
+}
+
+#ifdef _SDX_WINDOWS
+static DWORD WINAPI test_cmap_writer(LPVOID arg)
+#else
+static void *test_cmap_writer(void *arg)
+#endif
+{
+	struct test_cmap_job *job = arg;
+	uint64 base = 1000000 * (uint64)(job->id + 1);
+
+	for (uint64 i = 0; i < TEST_CMAP_CHURN; i++) {
+		uint64 key = base + i, stable = (i * 7 + job->id) % TEST_CMAP_STABLE;
+		struct test_cmap_value v = { key * 1000 + job->id, (key * 1000 + job->id) ^ TEST_CMAP_MAGIC };
+		assert(cmap_put(job->map, &key, &v) && "cmap put failed");
+		v.a = stable * 1000 + i % 1000;
+		v.b = v.a ^ TEST_CMAP_MAGIC;
+		assert(cmap_put(job->map, &stable, &v) && "cmap update failed");
+		if (i % 4 == 1) {
+			key = base + i / 2;
+			assert(cmap_remove(job->map, &key) && "cmap remove failed");
+		}
+	}
+	return 0;
+}
+
+#ifdef _SDX_WINDOWS
+static DWORD WINAPI test_cmap_reader(LPVOID arg)
+#else
+static void *test_cmap_reader(void *arg)
+#endif
+{
+	struct test_cmap_job *job = arg;
+	uint64 x = 88172645463325252ull + job->id;
+
+	while (!__atomic_load_n(job->done, __ATOMIC_ACQUIRE)) {
+		for (int n = 0; n < 1000; n++) {
+			struct test_cmap_value v;
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+			uint64 key = x % TEST_CMAP_STABLE;
+			assert(cmap_get(job->map, &key, &v) && "cmap lost a key");
+			test_cmap_check(key, &v);
+			key = 1000000 * (1 + x % TEST_CMAP_WRITERS) + (x >> 32) % TEST_CMAP_CHURN;
+			if (cmap_get(job->map, &key, &v))
+				test_cmap_check(key, &v);
+		}
+	}
+	return 0;
+}
+
+void test_concurrent_map()
+{
+	printf("======= CONCURRENT MAP TEST START\n");
+	static unsigned char present[4096];
+	struct cmap map;
+	size_t count = 0;
+	uint32 value;
+
+	// Single threaded against a reference, through several growths
+	srand(5);
+	assert(cmap_init(&map, sizeof(uint32), sizeof(uint32), 0) && "cmap init failed");
+	for (int op = 0; op < 100000; op++) {
+		uint32 key = rand() % 4096;
+		int r = rand() % 4;
+		if (r < 2) {
+			value = key * 3;
+			assert(cmap_put(&map, &key, &value) && "cmap put failed");
+			count += !present[key];
+			present[key] = 1;
+		} else if (r == 2) {
+			assert(cmap_remove(&map, &key) == present[key] && "cmap remove is wrong");
+			count -= present[key];
+			present[key] = 0;
+		} else {
+			assert(cmap_get(&map, &key, &value) == present[key] && "cmap lookup is wrong");
+			assert((!present[key] || value == key * 3) && "cmap value is wrong");
+		}
+		assert(cmap_count(&map) == count && "cmap count is wrong");
+	}
+	assert(map.retired && "cmap never grew");
+	cmap_free(&map);
+
+	// Freed while growing, only part of the next table is set up
+	assert(cmap_init(&map, sizeof(uint32), sizeof(uint32), 0) && "cmap init failed");
+	for (uint32 key = 0; !map.table->next; key++)
+		cmap_put(&map, &key, &key);
+	assert(map.table->moved <= map.table->mask && "cmap moved everything at once");
+	cmap_free(&map);
+
+	// Readers check every value they see while writers grow the map
+	static struct test_cmap_job jobs[TEST_CMAP_WRITERS + TEST_CMAP_READERS];
+	int done = 0;
+	assert(cmap_init(&map, sizeof(uint64), sizeof(struct test_cmap_value), 0) && "cmap init failed");
+	for (uint64 key = 0; key < TEST_CMAP_STABLE; key++) {
+		struct test_cmap_value v = { key * 1000, (key * 1000) ^ TEST_CMAP_MAGIC };
+		cmap_put(&map, &key, &v);
+	}
+#ifdef _SDX_WINDOWS
+	HANDLE threads[TEST_CMAP_WRITERS + TEST_CMAP_READERS];
+#else
+	pthread_t threads[TEST_CMAP_WRITERS + TEST_CMAP_READERS];
+#endif
+	for (int t = 0; t < TEST_CMAP_WRITERS + TEST_CMAP_READERS; t++) {
+		jobs[t] = (struct test_cmap_job){ &map, t < TEST_CMAP_WRITERS ? t : t - TEST_CMAP_WRITERS, &done };
+#ifdef _SDX_WINDOWS
+		threads[t] = CreateThread(NULL, 0, t < TEST_CMAP_WRITERS ? test_cmap_writer : test_cmap_reader,
+					  &jobs[t], 0, NULL);
+		assert(threads[t] && "CreateThread failed");
+#else
+		assert(pthread_create(&threads[t], NULL, t < TEST_CMAP_WRITERS ? test_cmap_writer : test_cmap_reader,
+				      &jobs[t]) == 0 && "pthread_create failed");
+#endif
+	}
+	for (int t = 0; t < TEST_CMAP_WRITERS + TEST_CMAP_READERS; t++) {
+		if (t == TEST_CMAP_WRITERS)
+			__atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+#ifdef _SDX_WINDOWS
+		WaitForSingleObject(threads[t], INFINITE);
+		CloseHandle(threads[t]);
+#else
+		pthread_join(threads[t], NULL);
+#endif
+	}
+
+	count = TEST_CMAP_STABLE;
+	for (uint64 w = 0; w < TEST_CMAP_WRITERS; w++) {
+		for (uint64 i = 0; i < TEST_CMAP_CHURN; i++) {
+			uint64 key = 1000000 * (w + 1) + i;
+			struct test_cmap_value v;
+			int removed = i % 2 == 0 && 2 * i + 1 < TEST_CMAP_CHURN;
+			assert(cmap_get(&map, &key, &v) == !removed && "cmap lost or kept a churned key");
+			count += !removed;
+		}
+	}
+	assert(cmap_count(&map) == count && "cmap count after threads is wrong");
+	cmap_free(&map);
+
+	printf("======= CONCURRENT MAP TEST END\n");
+}
+
 void test_system()
 {
 	printf("======= SYSTEM TEST START\n");
@@ -254,6 +2248,22 @@ int main()
 	test_system();
 	test_fs();
 	test_strvec();
+	test_intern();
+	test_strvec_sort();
+	test_strvec_map();
+	test_strvec_fc();
+	test_number();
+	test_hash();
+	test_multi_pattern();
+	test_string_builder();
+	test_fmt();
+	test_line_index();
+	test_csv();
+	test_json();
+	test_glob();
+	test_encoding();
+	test_hashmap();
+	test_concurrent_map();
 	test_mem_debug();
 
 	/*